@@ -0,0 +1,161 @@
+#include "availability_bitmap.h"
+#include <algorithm>
+
+namespace
+{
+inline uint64_t popcount64(uint64_t bits)
+{
+#if defined(__POPCNT__)
+    return static_cast<uint64_t>(__builtin_popcountll(bits));
+#else
+    // Without the popcnt instruction the builtin is a library call per word; this SWAR
+    // form stays inline and lets the loop below vectorize
+    bits = bits - ((bits >> 1) & 0x5555555555555555ull);
+    bits = (bits & 0x3333333333333333ull) + ((bits >> 2) & 0x3333333333333333ull);
+    bits = (bits + (bits >> 4)) & 0x0f0f0f0f0f0f0f0full;
+    return (bits * 0x0101010101010101ull) >> 56;
+#endif
+}
+
+size_t popcountRange(const uint64_t *words, size_t count)
+{
+    uint64_t total = 0;
+    for (size_t i = 0; i < count; ++i)
+        total += popcount64(words[i]);
+    return static_cast<size_t>(total);
+}
+} // namespace
+
+AvailabilityBitmap::AvailabilityBitmap() : lane_count_(0) {}
+
+void AvailabilityBitmap::clear()
+{
+    blocks_.clear();
+    lane_count_ = 0;
+}
+
+void AvailabilityBitmap::dropBefore(int64_t day)
+{
+    blocks_.erase(blocks_.begin(), blocks_.lower_bound(blockOf(day)));
+}
+
+const uint64_t *AvailabilityBitmap::dayWords(int64_t day, int lane) const
+{
+    if (lane < 1 || lane > lane_count_)
+        return nullptr;
+    int64_t block = blockOf(day);
+    auto block_it = blocks_.find(block);
+    if (block_it == blocks_.end() || static_cast<int>(block_it->second.size()) < lane)
+        return nullptr;
+    const std::vector<uint64_t> &words = block_it->second[lane - 1];
+    if (words.empty())
+        return nullptr;
+    return words.data() + (day - block * kDaysPerBlock) * kWordsPerDay;
+}
+
+uint64_t *AvailabilityBitmap::ensureDay(int64_t day, int lane)
+{
+    int64_t block = blockOf(day);
+    Block &lanes = blocks_[block];
+    if (static_cast<int>(lanes.size()) < lane)
+        lanes.resize(lane);
+    std::vector<uint64_t> &words = lanes[lane - 1];
+    if (words.empty())
+        words.assign(static_cast<size_t>(kDaysPerBlock) * kWordsPerDay, 0);
+    lane_count_ = std::max(lane_count_, lane);
+    return words.data() + (day - block * kDaysPerBlock) * kWordsPerDay;
+}
+
+void AvailabilityBitmap::set(int64_t start_key, int lane)
+{
+    uint64_t *words = ensureDay(dayOfKey(start_key), lane);
+    int minute = minuteOfKey(start_key);
+    words[minute / 64] |= uint64_t(1) << (minute % 64);
+}
+
+void AvailabilityBitmap::reset(int64_t start_key, int lane)
+{
+    int64_t day = dayOfKey(start_key);
+    auto block_it = blocks_.find(blockOf(day));
+    if (lane < 1 || block_it == blocks_.end() || static_cast<int>(block_it->second.size()) < lane ||
+        block_it->second[lane - 1].empty())
+        return;
+    int minute = minuteOfKey(start_key);
+    block_it->second[lane - 1][(day - block_it->first * kDaysPerBlock) * kWordsPerDay + minute / 64] &=
+        ~(uint64_t(1) << (minute % 64));
+}
+
+bool AvailabilityBitmap::test(int64_t start_key, int lane) const
+{
+    const uint64_t *words = dayWords(dayOfKey(start_key), lane);
+    int minute = minuteOfKey(start_key);
+    return words && (words[minute / 64] >> (minute % 64) & 1);
+}
+
+size_t AvailabilityBitmap::count(int64_t day) const
+{
+    return count(day, day);
+}
+
+size_t AvailabilityBitmap::count(int64_t first_day, int64_t last_day) const
+{
+    if (first_day > last_day)
+        return 0;
+    size_t total = 0;
+    auto last_it = blocks_.upper_bound(blockOf(last_day));
+    for (auto block_it = blocks_.lower_bound(blockOf(first_day)); block_it != last_it; ++block_it)
+    {
+        // The part of [first_day, last_day] inside this block, as day offsets within it
+        int64_t block_first = block_it->first * kDaysPerBlock;
+        int64_t from = std::max(first_day, block_first) - block_first;
+        int64_t to = std::min(last_day, block_first + kDaysPerBlock - 1) - block_first;
+        size_t words = static_cast<size_t>(to - from + 1) * kWordsPerDay;
+        for (const std::vector<uint64_t> &lane : block_it->second)
+        {
+            if (!lane.empty())
+                total += popcountRange(lane.data() + from * kWordsPerDay, words);
+        }
+    }
+    return total;
+}
+int AvailabilityBitmap::findFirst(int64_t day, int lane, int from_minute) const
+{
+    const uint64_t *words = dayWords(day, lane);
+    if (!words || from_minute >= static_cast<int>(kMinutesPerDay))
+        return -1;
+    from_minute = std::max(from_minute, 0);
+    int word = from_minute / 64;
+    uint64_t bits = words[word] & (~uint64_t(0) << (from_minute % 64));
+    while (true)
+    {
+        if (bits)
+            return word * 64 + __builtin_ctzll(bits);
+        if (++word == kWordsPerDay)
+            return -1;
+        bits = words[word];
+    }
+}
+
+uint64_t AvailabilityBitmap::lanesAt(int64_t day, int minute) const
+{
+    uint64_t lanes = 0;
+    for (int lane = 1; lane <= laneCount(); ++lane)
+    {
+        const uint64_t *words = dayWords(day, lane);
+        if (words && (words[minute / 64] >> (minute % 64) & 1))
+            lanes |= uint64_t(1) << (lane - 1);
+    }
+    return lanes;
+}
+
+uint64_t AvailabilityBitmap::unionWord(int64_t day, int word) const
+{
+    uint64_t bits = 0;
+    for (int lane = 1; lane <= laneCount(); ++lane)
+    {
+        const uint64_t *words = dayWords(day, lane);
+        if (words)
+            bits |= words[word];
+    }
+    return bits;
+}
@@ -0,0 +1,59 @@
+#ifndef AVAILABILITY_BITMAP_H
+#define AVAILABILITY_BITMAP_H
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "slot_time.h"
+
+/**
+ * @brief Open-slot bitmap: one bit per lane, day and minute of the day
+ *
+ * Days are grouped into fixed blocks of kDaysPerBlock, kept in a map by
+ * block number, and each lane of a block keeps its days back to back, so a
+ * day is kWordsPerDay contiguous words and a week is a single run of
+ * memory. Memory follows the months that hold slots, not the span between
+ * the earliest and latest one. Counting is a popcount over those runs and
+ * the first open minute from a given time is a count-trailing-zeros scan.
+ * Slots start on any minute and (start key, lane) is unique, so one-minute
+ * bits are exact.
+ */
+class AvailabilityBitmap
+{
+public:
+    static constexpr int kWordsPerDay = static_cast<int>((kMinutesPerDay + 63) / 64);
+    static constexpr int kDaysPerBlock = 32;
+
+    AvailabilityBitmap();
+
+    void set(int64_t start_key, int lane);
+    void reset(int64_t start_key, int lane);
+    bool test(int64_t start_key, int lane) const;
+    void clear();
+    // Frees the blocks that end before day; bits on earlier days of day's block stay
+    void dropBefore(int64_t day);
+
+    size_t count(int64_t day) const;
+    size_t count(int64_t first_day, int64_t last_day) const; // inclusive
+    // Minute of the first open slot at or after from_minute on day in lane, or -1
+    int findFirst(int64_t day, int lane, int from_minute) const;
+    // Lanes with an open slot at the minute, bit lane - 1 per lane
+    uint64_t lanesAt(int64_t day, int minute) const;
+    // Every lane's bits for one word of a day OR-ed together, for ordered scans across lanes
+    uint64_t unionWord(int64_t day, int word) const;
+    int laneCount() const { return lane_count_; }
+    size_t blockCount() const { return blocks_.size(); }
+
+private:
+    // lane - 1 -> kDaysPerBlock * kWordsPerDay words, empty until the lane has a slot in the block
+    typedef std::vector<std::vector<uint64_t>> Block;
+
+    static int64_t blockOf(int64_t day) { return day >= 0 ? day / kDaysPerBlock : (day + 1) / kDaysPerBlock - 1; }
+    const uint64_t *dayWords(int64_t day, int lane) const; // nullptr where the lane has no slots
+    uint64_t *ensureDay(int64_t day, int lane);
+
+    std::map<int64_t, Block> blocks_;
+    int lane_count_;
+};
+
+#endif // AVAILABILITY_BITMAP_H
@@ -0,0 +1,68 @@
+#include "availability_totals.h"
+#include "slot_time.h"
+
+void AvailabilityAggregates::apply(int64_t day, const AvailabilityTotals &delta)
+{
+    add(&days_, day, delta);
+    add(&weeks_, weekOf(day), delta);
+    add(&months_, monthOf(day), delta);
+}
+
+void AvailabilityAggregates::clear()
+{
+    days_.clear();
+    weeks_.clear();
+    months_.clear();
+}
+
+void AvailabilityAggregates::dropDay(int64_t day)
+{
+    days_.erase(day);
+    if (weekOf(day + 1) != weekOf(day))
+        weeks_.erase(weekOf(day));
+    if (monthOf(day + 1) != monthOf(day))
+        months_.erase(monthOf(day));
+}
+
+int64_t AvailabilityAggregates::weekOf(int64_t day)
+{
+    // 1970-01-01 was a Thursday; floor division keeps earlier dates in the right week
+    int64_t shifted = day + 3;
+    return shifted >= 0 ? shifted / 7 : (shifted - 6) / 7;
+}
+
+int64_t AvailabilityAggregates::monthOf(int64_t day)
+{
+    int year, month, day_of_month;
+    civilFromDays(day, &year, &month, &day_of_month);
+    return static_cast<int64_t>(year) * 12 + (month - 1);
+}
+
+int64_t AvailabilityAggregates::firstDayOfWeek(int64_t week)
+{
+    return week * 7 - 3;
+}
+
+int64_t AvailabilityAggregates::firstDayOfMonth(int64_t month)
+{
+    int64_t year = month >= 0 ? month / 12 : (month - 11) / 12;
+    return daysFromCivil(static_cast<int>(year), static_cast<int>(month - year * 12) + 1, 1);
+}
+
+AvailabilityTotals AvailabilityAggregates::find(const Totals &totals, int64_t key)
+{
+    auto it = totals.find(key);
+    return it == totals.end() ? AvailabilityTotals() : it->second;
+}
+
+void AvailabilityAggregates::add(Totals *totals, int64_t key, const AvailabilityTotals &delta)
+{
+    AvailabilityTotals &entry = (*totals)[key];
+    entry.slots += delta.slots;
+    entry.open_slots += delta.open_slots;
+    entry.seats += delta.seats;
+    entry.booked_seats += delta.booked_seats;
+    // Drop emptied keys so the maps only hold dates that have slots
+    if (entry.slots == 0 && entry.open_slots == 0 && entry.seats == 0 && entry.booked_seats == 0)
+        totals->erase(key);
+}
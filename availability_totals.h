@@ -0,0 +1,54 @@
+#ifndef AVAILABILITY_TOTALS_H
+#define AVAILABILITY_TOTALS_H
+
+#include <cstdint>
+#include <unordered_map>
+
+/**
+ * @brief Slot and seat counts for one date, week or month
+ */
+struct AvailabilityTotals
+{
+    int64_t slots = 0;
+    int64_t open_slots = 0; // with at least one seat left
+    int64_t seats = 0;
+    int64_t booked_seats = 0;
+};
+
+/**
+ * @brief Per-date, per-week and per-month availability counters
+ *
+ * SchedulerCore applies a signed delta for every slot it creates and every
+ * seat booked or released, which updates the date, its Monday-based week
+ * and its month in O(1). Calendar views read whole months from here without
+ * touching individual slots.
+ */
+class AvailabilityAggregates
+{
+public:
+    void apply(int64_t day, const AvailabilityTotals &delta);
+    void clear();
+    // Forgets a date that has passed, and its week and month when it is their last date
+    void dropDay(int64_t day);
+
+    AvailabilityTotals day(int64_t day) const { return find(days_, day); }
+    AvailabilityTotals week(int64_t week) const { return find(weeks_, week); }
+    AvailabilityTotals month(int64_t month) const { return find(months_, month); }
+
+    static int64_t weekOf(int64_t day);  // weeks since the Monday before 1970-01-01
+    static int64_t monthOf(int64_t day); // year * 12 + month - 1
+    static int64_t firstDayOfWeek(int64_t week);
+    static int64_t firstDayOfMonth(int64_t month);
+
+private:
+    using Totals = std::unordered_map<int64_t, AvailabilityTotals>;
+
+    static AvailabilityTotals find(const Totals &totals, int64_t key);
+    static void add(Totals *totals, int64_t key, const AvailabilityTotals &delta);
+
+    Totals days_;
+    Totals weeks_;
+    Totals months_;
+};
+
+#endif // AVAILABILITY_TOTALS_H
@@ -0,0 +1,263 @@
+#include "booking_archive.h"
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+const char kArchiveMagic[4] = {'C', 'T', 'B', 'A'};
+const uint32_t kArchiveVersion = 1;
+const size_t kRecordHeadSize = 4 + 4 + 8 + 1 + 4 + 8 + 4; // booking, slot, start key, lane, age, booked at, name size
+
+template <typename T>
+void put(std::string *out, T value)
+{
+    out->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T>
+T get(const char *data)
+{
+    T value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// Length of an archive of file_size bytes up to the end of its last complete record, reading
+// record by record; false when the file is not a booking archive. A torn header counts as empty
+bool completeLength(FILE *file, uint64_t file_size, uint64_t *length)
+{
+    *length = 0;
+    char header[8];
+    if (file_size < sizeof(header))
+        return true;
+    if (std::fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        std::memcmp(header, kArchiveMagic, 4) != 0 || get<uint32_t>(header + 4) != kArchiveVersion)
+        return false;
+
+    uint64_t offset = sizeof(header);
+    char head[kRecordHeadSize];
+    std::string name;
+    while (file_size - offset >= kRecordHeadSize && std::fread(head, 1, kRecordHeadSize, file) == kRecordHeadSize)
+    {
+        uint32_t name_size = get<uint32_t>(head + kRecordHeadSize - 4);
+        if (file_size - offset - kRecordHeadSize < name_size)
+            break; // torn write at the tail
+        name.resize(name_size);
+        if (std::fread(&name[0], 1, name_size, file) != name_size)
+            break;
+        offset += kRecordHeadSize + name_size;
+    }
+    *length = offset;
+    return true;
+}
+} // namespace
+
+BookingArchive::BookingArchive(const SchedulerCore *core)
+    : core_(core), file_(nullptr), length_(0), appended_(0), unsynced_(false), append_failed_(false) {}
+
+BookingArchive::~BookingArchive()
+{
+    close();
+}
+
+bool BookingArchive::open(const std::string &path, std::string *error)
+{
+    std::string ignored;
+    if (!error)
+        error = &ignored;
+    close();
+
+    // Drop a record torn by a crash mid-append, as the journal does, so appends follow the last complete one
+    std::error_code ec;
+    uint64_t file_size = std::filesystem::file_size(path, ec);
+    if (!ec && file_size > 0)
+    {
+        FILE *existing = std::fopen(path.c_str(), "rb");
+        if (!existing)
+        {
+            *error = "cannot open " + path;
+            return false;
+        }
+        uint64_t length;
+        bool recognised = completeLength(existing, file_size, &length);
+        std::fclose(existing);
+        if (!recognised)
+        {
+            *error = "unrecognised booking archive " + path;
+            return false;
+        }
+        if (length != file_size)
+        {
+            std::filesystem::resize_file(path, length, ec);
+            if (ec)
+            {
+                *error = "cannot truncate damaged booking archive tail: " + ec.message();
+                return false;
+            }
+        }
+    }
+
+    file_ = std::fopen(path.c_str(), "ab");
+    if (!file_)
+    {
+        *error = "cannot open " + path;
+        return false;
+    }
+    if (std::fseek(file_, 0, SEEK_END) == 0 && std::ftell(file_) == 0)
+    {
+        std::string header(kArchiveMagic, 4);
+        put<uint32_t>(&header, kArchiveVersion);
+        if (std::fwrite(header.data(), 1, header.size(), file_) != header.size() || std::fflush(file_) != 0)
+        {
+            *error = "cannot write " + path;
+            close();
+            return false;
+        }
+        unsynced_ = true;
+    }
+    path_ = path;
+    length_ = static_cast<uint64_t>(std::ftell(file_));
+    append_failed_ = false;
+    return true;
+}
+
+void BookingArchive::close()
+{
+    if (!file_)
+        return;
+    sync();
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+bool BookingArchive::append(const ArchivedBooking &booking)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_)
+        return false;
+    std::string record;
+    record.reserve(kRecordHeadSize + booking.patient_name.size());
+    put<int32_t>(&record, booking.booking_id);
+    put<int32_t>(&record, booking.slot_id);
+    put<int64_t>(&record, booking.start_key);
+    put<uint8_t>(&record, static_cast<uint8_t>(booking.lane));
+    put<int32_t>(&record, booking.patient_age);
+    put<int64_t>(&record, booking.booked_at);
+    put<uint32_t>(&record, static_cast<uint32_t>(booking.patient_name.size()));
+    record.append(booking.patient_name);
+    unsynced_ = true;
+    if (std::fwrite(record.data(), 1, record.size(), file_) != record.size() || std::fflush(file_) != 0)
+    {
+        // Cut off whatever part made it out, so the next record follows the last complete one
+        std::clearerr(file_);
+        std::error_code ec;
+        std::filesystem::resize_file(path_, length_, ec);
+        std::fseek(file_, 0, SEEK_END);
+        append_failed_ = true;
+        return false;
+    }
+    length_ += record.size();
+    ++appended_;
+    append_failed_ = false;
+    return true;
+}
+
+bool BookingArchive::storeArchived(const Patient &booking)
+{
+    if (!file_)
+        return true; // journal replay: the archive already holds it
+    ArchivedBooking archived;
+    archived.booking_id = booking.getBookingId();
+    archived.slot_id = booking.getSlotId();
+    if (std::optional<TimeSlot> slot = core_->findSlot(booking.getSlotId()))
+    {
+        archived.start_key = slot->getStartKey();
+        archived.lane = slot->getLane();
+    }
+    archived.patient_age = booking.getAge();
+    archived.booked_at = booking.getBookedAt();
+    archived.patient_name = booking.getName();
+    return append(archived);
+}
+
+size_t BookingArchive::appendedCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return appended_;
+}
+
+bool BookingArchive::appendFailed() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return append_failed_;
+}
+
+bool BookingArchive::sync()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_ || std::fflush(file_) != 0)
+        return false;
+    if (!unsynced_)
+        return true;
+#ifdef _WIN32
+    bool synced = _commit(_fileno(file_)) == 0;
+#elif defined(__linux__)
+    bool synced = fdatasync(fileno(file_)) == 0;
+#else
+    bool synced = fsync(fileno(file_)) == 0;
+#endif
+    unsynced_ = !synced;
+    return synced;
+}
+
+bool BookingArchive::read(const std::string &path, std::vector<ArchivedBooking> *bookings, std::string *error)
+{
+    std::string ignored;
+    if (!error)
+        error = &ignored;
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        *error = "cannot open " + path;
+        return false;
+    }
+    std::string contents;
+    char buffer[1 << 16];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        contents.append(buffer, count);
+    std::fclose(file);
+
+    if (contents.size() < 8 || std::memcmp(contents.data(), kArchiveMagic, 4) != 0 ||
+        get<uint32_t>(contents.data() + 4) != kArchiveVersion)
+    {
+        *error = "unrecognised booking archive " + path;
+        return false;
+    }
+
+    size_t offset = 8;
+    while (contents.size() - offset >= kRecordHeadSize)
+    {
+        const char *head = contents.data() + offset;
+        uint32_t name_size = get<uint32_t>(head + kRecordHeadSize - 4);
+        if (contents.size() - offset - kRecordHeadSize < name_size)
+            break; // torn write at the tail
+        ArchivedBooking booking;
+        booking.booking_id = get<int32_t>(head);
+        booking.slot_id = get<int32_t>(head + 4);
+        booking.start_key = get<int64_t>(head + 8);
+        booking.lane = get<uint8_t>(head + 16);
+        booking.patient_age = get<int32_t>(head + 17);
+        booking.booked_at = get<int64_t>(head + 21);
+        booking.patient_name.assign(head + kRecordHeadSize, name_size);
+        bookings->push_back(std::move(booking));
+        offset += kRecordHeadSize + name_size;
+    }
+    return true;
+}
@@ -0,0 +1,73 @@
+#ifndef BOOKING_ARCHIVE_H
+#define BOOKING_ARCHIVE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "scheduler_core.h"
+
+/**
+ * @brief One completed booking as stored in a BookingArchive
+ */
+struct ArchivedBooking
+{
+    int booking_id = 0;
+    int slot_id = 0;
+    int64_t start_key = 0;
+    int lane = 0;
+    int patient_age = 0;
+    int64_t booked_at = 0;
+    std::string patient_name;
+};
+
+/**
+ * @brief Append-only file of bookings whose slots have passed
+ *
+ * Listens to a SchedulerCore and stores every booking it is about to archive
+ * (see SchedulerCore::pruneStep) while open; a booking it cannot store is
+ * refused and stays live, and the failed record is cut off again. Register
+ * it before the journal opens and open it afterwards: replayed archivals are
+ * then skipped, and live ones reach this file before the journal's record of
+ * them. Each record is a fixed 33-byte head plus the patient name, handed to
+ * the OS immediately, so a process crash cannot lose a booking the journal
+ * already lists as archived; sync() makes them durable across power loss and
+ * must run before the journal syncs those records (see
+ * SchedulerJournal::setSyncBefore), possibly on a thread other than the one
+ * archiving. open() truncates a torn last record, as the journal does, and
+ * read() skips one.
+ */
+class BookingArchive : public SchedulerListener
+{
+public:
+    explicit BookingArchive(const SchedulerCore *core);
+    ~BookingArchive();
+    BookingArchive(const BookingArchive &) = delete;
+    BookingArchive &operator=(const BookingArchive &) = delete;
+
+    bool open(const std::string &path, std::string *error = nullptr);
+    void close();
+    bool isOpen() const { return file_ != nullptr; }
+
+    bool append(const ArchivedBooking &booking);
+    bool sync(); // no-op once every appended record is synced
+    size_t appendedCount() const;
+    bool appendFailed() const; // the last append did not reach the file
+
+    bool storeArchived(const Patient &booking) override;
+
+    static bool read(const std::string &path, std::vector<ArchivedBooking> *bookings, std::string *error = nullptr);
+
+private:
+    const SchedulerCore *core_;
+    mutable std::mutex mutex_; // appends and syncs; open() and close() run while no one else uses the archive
+    FILE *file_;
+    std::string path_;
+    uint64_t length_; // end of the last complete record
+    size_t appended_;
+    bool unsynced_;
+    bool append_failed_;
+};
+
+#endif // BOOKING_ARCHIVE_H
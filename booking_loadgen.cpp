@@ -0,0 +1,248 @@
+// Load generator for the kiosk booking protocol (see booking_protocol.h).
+//
+//   booking_loadgen --unix /tmp/covid-scheduler --connections 8 --depth 32 --mix next
+//   booking_loadgen --tcp 7300 --requests 50000 --mix avail --date 2024-05-01
+//
+// Each connection runs on its own thread and keeps --depth requests in flight.
+// The "next" mix books the earliest slot and cancels every booking it gets
+// back, so the calendar is not used up during long runs. Prints throughput
+// and latency percentiles over all connections. POSIX sockets only.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+    std::string unix_path;
+    int tcp_port = 0;
+    int connections = 4;
+    long requests = 10000; // per connection
+    int depth = 16;
+    std::string mix = "next"; // next, avail or ping
+    std::string date;
+};
+
+struct ConnectionStats
+{
+    std::vector<uint32_t> latencies_us;
+    long errors = 0;
+    bool failed = false;
+};
+
+int connectSocket(const Options &options)
+{
+    int fd;
+    if (!options.unix_path.empty())
+    {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        std::strncpy(address.sun_path, options.unix_path.c_str(), sizeof(address.sun_path) - 1);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+            return -1;
+    }
+    else
+    {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<uint16_t>(options.tcp_port));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0)
+            return -1;
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+bool sendAll(int fd, const std::string &data)
+{
+    size_t sent = 0;
+    while (sent < data.size())
+    {
+        ssize_t count = send(fd, data.data() + sent, data.size() - sent, 0);
+        if (count <= 0)
+            return false;
+        sent += static_cast<size_t>(count);
+    }
+    return true;
+}
+
+void runConnection(const Options &options, int index, ConnectionStats *stats)
+{
+    int fd = connectSocket(options);
+    if (fd < 0)
+    {
+        stats->failed = true;
+        return;
+    }
+
+    const std::string name = " 30 Load Test " + std::to_string(index);
+    std::deque<Clock::time_point> in_flight;
+    std::deque<std::string> cancels; // booking ids returned by NEXT
+    std::string input;
+    char buffer[1 << 16];
+    long issued = 0, answered = 0;
+    stats->latencies_us.reserve(options.requests);
+
+    while (answered < options.requests)
+    {
+        // Top up the pipeline, then read whatever has arrived
+        std::string out;
+        while (static_cast<int>(in_flight.size()) < options.depth && issued < options.requests)
+        {
+            if (options.mix == "avail")
+                out += "AVAIL " + options.date + "\n";
+            else if (options.mix == "ping")
+                out += "PING\n";
+            else if (!cancels.empty())
+            {
+                out += "CANCEL " + cancels.front() + "\n";
+                cancels.pop_front();
+            }
+            else
+                out += "NEXT " + options.date + name + "\n";
+            in_flight.push_back(Clock::now());
+            ++issued;
+        }
+        if (!out.empty() && !sendAll(fd, out))
+        {
+            stats->failed = true;
+            break;
+        }
+
+        ssize_t count = recv(fd, buffer, sizeof(buffer), 0);
+        if (count <= 0)
+        {
+            stats->failed = true;
+            break;
+        }
+        input.append(buffer, static_cast<size_t>(count));
+
+        size_t start = 0, newline;
+        while ((newline = input.find('\n', start)) != std::string::npos)
+        {
+            Clock::time_point now = Clock::now();
+            stats->latencies_us.push_back(static_cast<uint32_t>(
+                std::chrono::duration_cast<std::chrono::microseconds>(now - in_flight.front()).count()));
+            in_flight.pop_front();
+            ++answered;
+
+            if (input.compare(start, 3, "ERR") == 0)
+                ++stats->errors;
+            else if (options.mix == "next" && newline - start > 3)
+            {
+                // "OK <booking id> <slot id> ..." from NEXT; "OK <booking id>" from CANCEL has no slot
+                size_t id_end = input.find(' ', start + 3);
+                if (id_end != std::string::npos && id_end < newline)
+                    cancels.push_back(input.substr(start + 3, id_end - start - 3));
+            }
+            start = newline + 1;
+        }
+        input.erase(0, start);
+    }
+    close(fd);
+}
+
+std::string today()
+{
+    std::time_t now = std::time(nullptr);
+    char text[16];
+    std::strftime(text, sizeof(text), "%Y-%m-%d", std::localtime(&now));
+    return text;
+}
+
+void usage()
+{
+    std::fprintf(stderr, "usage: booking_loadgen (--unix PATH | --tcp PORT) [--connections N] [--requests N]\n"
+                         "                       [--depth N] [--mix next|avail|ping] [--date yyyy-MM-dd]\n");
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--unix")
+            options.unix_path = value;
+        else if (flag == "--tcp")
+            options.tcp_port = std::atoi(value);
+        else if (flag == "--connections")
+            options.connections = std::max(1, std::atoi(value));
+        else if (flag == "--requests")
+            options.requests = std::max(1L, std::atol(value));
+        else if (flag == "--depth")
+            options.depth = std::max(1, std::atoi(value));
+        else if (flag == "--mix")
+            options.mix = value;
+        else if (flag == "--date")
+            options.date = value;
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (options.unix_path.empty() == (options.tcp_port == 0) || argc % 2 == 0)
+    {
+        usage();
+        return 2;
+    }
+    if (options.date.empty())
+        options.date = today();
+
+    std::vector<ConnectionStats> stats(options.connections);
+    std::vector<std::thread> threads;
+    Clock::time_point started = Clock::now();
+    for (int i = 0; i < options.connections; ++i)
+        threads.emplace_back(runConnection, std::cref(options), i, &stats[i]);
+    for (std::thread &thread : threads)
+        thread.join();
+    double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+
+    std::vector<uint32_t> latencies;
+    long errors = 0;
+    int failed = 0;
+    for (const ConnectionStats &connection : stats)
+    {
+        latencies.insert(latencies.end(), connection.latencies_us.begin(), connection.latencies_us.end());
+        errors += connection.errors;
+        failed += connection.failed ? 1 : 0;
+    }
+    if (latencies.empty())
+    {
+        std::fprintf(stderr, "no responses (%d of %d connections failed)\n", failed, options.connections);
+        return 1;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p)
+    { return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * latencies.size()))]; };
+    std::printf("%zu responses in %.3f s: %.0f requests/s, %ld errors, %d failed connections\n",
+                latencies.size(), seconds, latencies.size() / seconds, errors, failed);
+    std::printf("latency us: p50 %u  p90 %u  p99 %u  p99.9 %u  max %u\n",
+                percentile(0.50), percentile(0.90), percentile(0.99), percentile(0.999), latencies.back());
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,419 @@
+#include "booking_pipeline.h"
+#include <algorithm>
+#include <chrono>
+
+BookingPipeline::BookingPipeline(SchedulerCore *core, SchedulerJournal *journal, QObject *parent)
+    : QObject(parent), core_(core), journal_(journal), metrics_(nullptr), trace_(nullptr), applied_batches_(0),
+      stripe_count_(kDefaultStripes), stripes_(new Stripe[kDefaultStripes]), next_ticket_(1), stopping_(false),
+      storage_failed_(false), started_(false), committed_batches_(0) {}
+
+BookingPipeline::~BookingPipeline()
+{
+    stop();
+}
+
+void BookingPipeline::setStripeCount(size_t count)
+{
+    if (started_)
+        return;
+    stripe_count_ = std::max<size_t>(count, 1);
+    stripes_.reset(new Stripe[stripe_count_]);
+}
+
+void BookingPipeline::start()
+{
+    if (started_)
+        return;
+    core_->addListener(this);
+    stopping_ = false;
+    for (size_t stripe = 0; stripe < stripe_count_; ++stripe)
+        stripes_[stripe].worker = std::thread(&BookingPipeline::run, this, stripe);
+    started_ = true;
+}
+
+void BookingPipeline::stop()
+{
+    if (!started_)
+        return;
+    for (size_t stripe = 0; stripe < stripe_count_; ++stripe)
+    {
+        {
+            std::lock_guard<std::mutex> lock(stripes_[stripe].mutex);
+            stopping_ = true;
+        }
+        stripes_[stripe].ready.notify_one();
+    }
+    for (size_t stripe = 0; stripe < stripe_count_; ++stripe)
+        stripes_[stripe].worker.join();
+    started_ = false;
+
+    std::unique_lock<std::shared_mutex> lock(core_mutex_);
+    core_->removeListener(this);
+    events_.clear();
+}
+
+uint64_t BookingPipeline::submitBooking(int slot_id, const std::string &patient_name, int patient_age)
+{
+    int64_t day = 0; // unknown slots are refused on any stripe
+    read([&](const SchedulerCore &core)
+         {
+        if (std::optional<TimeSlot> slot = core.findSlot(slot_id))
+            day = dayOfKey(slot->getStartKey()); });
+    return submit({0, BookingOutcome::Book, slot_id, 0, patient_name, patient_age}, day);
+}
+
+uint64_t BookingPipeline::submitEarliest(int64_t day, const std::string &patient_name, int patient_age)
+{
+    return submit({0, BookingOutcome::BookEarliest, 0, day, patient_name, patient_age}, day);
+}
+
+uint64_t BookingPipeline::submitNextAvailable(int64_t start_key, const std::string &patient_name, int patient_age)
+{
+    // The pick may land on a later date's stripe; the exclusive lock keeps that booking safe
+    return submit({0, BookingOutcome::BookNext, 0, start_key, patient_name, patient_age}, dayOfKey(start_key));
+}
+
+uint64_t BookingPipeline::submitCancel(int booking_id)
+{
+    int64_t day = 0;
+    read([&](const SchedulerCore &core)
+         {
+        const Patient *booking = core.findBooking(booking_id);
+        std::optional<TimeSlot> slot = booking ? core.findSlot(booking->getSlotId()) : std::nullopt;
+        if (slot)
+            day = dayOfKey(slot->getStartKey()); });
+    return submit({0, BookingOutcome::Cancel, booking_id, 0, std::string(), 0}, day);
+}
+
+uint64_t BookingPipeline::submit(Request request, int64_t day)
+{
+    int64_t count = static_cast<int64_t>(stripe_count_);
+    Stripe &stripe = stripes_[static_cast<size_t>(((day % count) + count) % count)];
+    uint64_t ticket = request.ticket = next_ticket_++;
+    bool was_empty;
+    {
+        std::lock_guard<std::mutex> lock(stripe.mutex);
+        was_empty = stripe.queue.empty();
+        stripe.queue.push_back(std::move(request));
+    }
+    // Producers only wake the worker for the first request of a batch
+    if (was_empty)
+        stripe.ready.notify_one();
+    return ticket;
+}
+
+void BookingPipeline::run(size_t stripe_index)
+{
+    const auto poll_interval = std::chrono::milliseconds(JournalOptions().group_commit_ms);
+    Stripe &stripe = stripes_[stripe_index];
+    std::vector<Request> batch;
+    for (;;)
+    {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(stripe.mutex);
+            stripe.ready.wait_for(lock, poll_interval, [&]()
+                                  { return stopping_ || !stripe.queue.empty(); });
+            batch.swap(stripe.queue);
+            stopping = stopping_;
+        }
+
+        if (!batch.empty())
+        {
+            std::vector<BookingOutcome> outcomes;
+            outcomes.reserve(batch.size());
+            uint64_t order;
+            {
+                std::unique_lock<std::shared_mutex> lock(core_mutex_);
+                for (const Request &request : batch)
+                {
+                    if (storage_failed_)
+                    {
+                        outcomes.push_back(refuse(request));
+                        continue;
+                    }
+                    {
+                        ScopedLatency latency(metrics_, request.kind == BookingOutcome::Cancel ? SchedulerOperation::Cancel
+                                                                                               : SchedulerOperation::Book);
+                        outcomes.push_back(apply(request));
+                    }
+                    if (trace_ && trace_->isOpen())
+                        trace(request, outcomes.back());
+                }
+                order = applied_batches_++;
+                if (!events_.empty())
+                    postEvents();
+            }
+            batch.clear();
+            commit(order, std::move(outcomes));
+        }
+        if (stripe_index == 0)
+            pollJournal();
+
+        if (stopping)
+        {
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            if (stripe.queue.empty())
+                return;
+        }
+    }
+}
+
+void BookingPipeline::commit(uint64_t order, std::vector<BookingOutcome> outcomes)
+{
+    std::unique_lock<std::mutex> lock(commit_mutex_);
+    commit_turn_.wait(lock, [&]()
+                      { return committed_batches_ == order; });
+    // A batch applied while an earlier commit was failing cannot be confirmed either
+    bool durable = !storage_failed_;
+    if (journal_ && durable)
+    {
+        // One sync covers the batch, and any applied after it, before an outcome is reported
+        ScopedLatency latency(metrics_, SchedulerOperation::Commit);
+        durable = journal_->flush();
+    }
+    if (!durable)
+    {
+        storage_failed_ = true;
+        // Refused requests changed nothing, so only the changes lost their durability
+        for (BookingOutcome &outcome : outcomes)
+        {
+            if (outcome.result == SchedulerResult::Ok)
+                outcome.result = SchedulerResult::StorageFailed;
+        }
+    }
+    // Posting in turn keeps outcomes in the order the batches were applied
+    QMetaObject::invokeMethod(
+        this, [this, outcomes = std::move(outcomes)]()
+        { emit requestsCompleted(outcomes); },
+        Qt::QueuedConnection);
+    ++committed_batches_;
+    lock.unlock();
+    commit_turn_.notify_all();
+}
+
+bool BookingPipeline::commitWrites()
+{
+    if (storage_failed_)
+        return false;
+    if (journal_ && !journal_->flush())
+        storage_failed_ = true;
+    return !storage_failed_;
+}
+
+void BookingPipeline::pollJournal()
+{
+    if (!journal_)
+        return;
+    journal_->poll();
+    // Snapshots run here rather than inside a booking so compaction never stalls one
+    if (journal_->snapshotDue())
+    {
+        std::unique_lock<std::shared_mutex> lock(core_mutex_);
+        journal_->writeSnapshot();
+    }
+}
+
+BookingOutcome BookingPipeline::refuse(const Request &request)
+{
+    BookingOutcome outcome;
+    outcome.ticket = request.ticket;
+    outcome.kind = request.kind;
+    outcome.result = SchedulerResult::StorageFailed;
+    outcome.patient_name = request.patient_name;
+    if (request.kind == BookingOutcome::Cancel)
+        outcome.booking_id = request.id;
+    else if (request.kind == BookingOutcome::Book)
+        outcome.slot_id = request.id;
+    return outcome;
+}
+
+BookingOutcome BookingPipeline::apply(const Request &request)
+{
+    BookingOutcome outcome;
+    outcome.ticket = request.ticket;
+    outcome.kind = request.kind;
+    outcome.patient_name = request.patient_name;
+
+    switch (request.kind)
+    {
+    case BookingOutcome::Book:
+        outcome.slot_id = request.id;
+        outcome.result = core_->bookSlot(request.id, request.patient_name, request.patient_age, &outcome.booking_id);
+        break;
+    case BookingOutcome::BookEarliest:
+    case BookingOutcome::BookNext:
+    {
+        std::optional<TimeSlot> earliest = request.kind == BookingOutcome::BookEarliest
+                                               ? core_->earliestSlot(request.when)
+                                               : core_->earliestSlotAfter(request.when);
+        if (!earliest)
+        {
+            outcome.result = SchedulerResult::SlotUnavailable;
+            return outcome;
+        }
+        outcome.slot_id = earliest->getId();
+        outcome.result = core_->bookSlot(outcome.slot_id, request.patient_name, request.patient_age, &outcome.booking_id);
+        break;
+    }
+    case BookingOutcome::Cancel:
+    {
+        outcome.booking_id = request.id;
+        const Patient *booking = core_->findBooking(request.id);
+        if (booking)
+        {
+            outcome.slot_id = booking->getSlotId();
+            outcome.patient_name = booking->getName();
+        }
+        outcome.result = core_->cancelBooking(request.id, &outcome.reassigned_booking_id);
+        if (const Patient *reassigned = core_->findBooking(outcome.reassigned_booking_id))
+            outcome.reassigned_name = reassigned->getName();
+        break;
+    }
+    }
+
+    if (outcome.result == SchedulerResult::Ok)
+    {
+        std::optional<TimeSlot> slot = core_->findSlot(outcome.slot_id);
+        if (slot)
+        {
+            outcome.start_key = slot->getStartKey();
+            outcome.lane = slot->getLane();
+        }
+    }
+    return outcome;
+}
+
+void BookingPipeline::trace(const Request &request, const BookingOutcome &outcome)
+{
+    TraceOperation operation;
+    switch (request.kind)
+    {
+    case BookingOutcome::Book:
+        operation.kind = TraceOperation::Book;
+        break;
+    case BookingOutcome::BookEarliest:
+        operation.kind = TraceOperation::BookEarliest;
+        break;
+    case BookingOutcome::BookNext:
+        operation.kind = TraceOperation::BookNext;
+        break;
+    case BookingOutcome::Cancel:
+        operation.kind = TraceOperation::Cancel;
+        break;
+    }
+    operation.result = outcome.result;
+    operation.booking_id = outcome.booking_id;
+    operation.reassigned_booking_id = outcome.reassigned_booking_id;
+    if (request.kind != BookingOutcome::Cancel)
+    {
+        operation.slot_id = outcome.slot_id;
+        operation.when = request.when;
+        operation.patient_name = request.patient_name;
+        operation.patient_age = request.patient_age;
+    }
+    trace_->record(std::move(operation));
+}
+
+void BookingPipeline::postEvents()
+{
+    // Posting under the lock keeps deliveries in the order the changes were applied
+    std::vector<RecordedEvent> events;
+    events.swap(events_);
+    QMetaObject::invokeMethod(
+        this, [this, events = std::move(events)]()
+        { deliver(events); },
+        Qt::QueuedConnection);
+}
+
+void BookingPipeline::deliver(const std::vector<RecordedEvent> &events)
+{
+    for (const RecordedEvent &event : events)
+    {
+        for (SchedulerListener *listener : view_listeners_)
+        {
+            switch (event.type)
+            {
+            case RecordedEvent::SlotAdded:
+                listener->slotAdded(*event.slot);
+                break;
+            case RecordedEvent::SlotBooked:
+                listener->slotBooked(*event.slot, *event.booking);
+                break;
+            case RecordedEvent::SlotReleased:
+                listener->slotReleased(*event.slot);
+                break;
+            case RecordedEvent::BookingRemoved:
+                listener->bookingRemoved(*event.booking, event.position);
+                break;
+            case RecordedEvent::BookingArchived:
+                listener->bookingArchived(*event.booking, event.position);
+                break;
+            case RecordedEvent::SlotsAdded:
+                listener->slotsAdded(event.spec);
+                break;
+            case RecordedEvent::SlotsImported:
+                listener->slotsImported(event.first_slot_id, event.position);
+                break;
+            }
+        }
+    }
+}
+
+void BookingPipeline::addViewListener(SchedulerListener *listener)
+{
+    view_listeners_.push_back(listener);
+}
+
+void BookingPipeline::slotAdded(const TimeSlot &slot)
+{
+    RecordedEvent event(RecordedEvent::SlotAdded);
+    event.slot = slot;
+    events_.push_back(std::move(event));
+}
+
+void BookingPipeline::slotBooked(const TimeSlot &slot, const Patient &booking)
+{
+    RecordedEvent event(RecordedEvent::SlotBooked);
+    event.slot = slot;
+    event.booking = booking;
+    events_.push_back(std::move(event));
+}
+
+void BookingPipeline::slotReleased(const TimeSlot &slot)
+{
+    RecordedEvent event(RecordedEvent::SlotReleased);
+    event.slot = slot;
+    events_.push_back(std::move(event));
+}
+
+void BookingPipeline::bookingRemoved(const Patient &booking, size_t position)
+{
+    RecordedEvent event(RecordedEvent::BookingRemoved);
+    event.booking = booking;
+    event.position = position;
+    events_.push_back(std::move(event));
+}
+
+void BookingPipeline::bookingArchived(const Patient &booking, size_t position)
+{
+    RecordedEvent event(RecordedEvent::BookingArchived);
+    event.booking = booking;
+    event.position = position;
+    events_.push_back(std::move(event));
+}
+
+void BookingPipeline::slotsAdded(const RecurringSlotSpec &spec)
+{
+    RecordedEvent event(RecordedEvent::SlotsAdded);
+    event.spec = spec;
+    events_.push_back(std::move(event));
+}
+
+void BookingPipeline::slotsImported(int first_slot_id, size_t count)
+{
+    RecordedEvent event(RecordedEvent::SlotsImported);
+    event.first_slot_id = first_slot_id;
+    event.position = count;
+    events_.push_back(std::move(event));
+}
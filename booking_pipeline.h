@@ -0,0 +1,209 @@
+#ifndef BOOKING_PIPELINE_H
+#define BOOKING_PIPELINE_H
+
+#include <QtCore/QObject>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "scheduler_core.h"
+#include "scheduler_journal.h"
+#include "scheduler_metrics.h"
+#include "scheduler_trace.h"
+
+/**
+ * @brief Result of one queued booking or cancellation
+ */
+struct BookingOutcome
+{
+    enum Kind
+    {
+        Book,
+        BookEarliest,
+        BookNext,
+        Cancel
+    };
+
+    uint64_t ticket = 0; // as returned by the submit call
+    Kind kind = Book;
+    SchedulerResult result = SchedulerResult::Ok;
+    int slot_id = 0;
+    int booking_id = 0;
+    std::string patient_name;
+    int64_t start_key = 0; // slot time and lane, filled in when result is Ok
+    int lane = 0;
+    int reassigned_booking_id = 0; // Cancel: the waitlisted patient's booking for the freed seat
+    std::string reassigned_name;
+};
+
+/**
+ * @brief Applies bookings and cancellations on date-striped worker threads in batches
+ *
+ * Any thread may submit requests. Each lands in the queue of its date's
+ * stripe (day mod stripe count; the slot's or booking's date for Book and
+ * Cancel), so requests for one date are applied in the order they arrived.
+ * A stripe's worker drains its queue as a whole, applies it to the
+ * SchedulerCore under the exclusive lock, which is held only for the
+ * in-memory changes, and then commits the batch to the journal with a single
+ * flush outside that lock: while one stripe waits for its sync, the others
+ * apply their batches and readers keep reading. Commits take turns in apply
+ * order, one flush covering every batch applied before it, and outcomes are
+ * reported only after their commit, so every reported outcome is already
+ * durable. When a commit fails, that batch's changes are reported as
+ * StorageFailed and later requests are refused with StorageFailed without
+ * being applied, until a restart recovers from the journal. The first stripe
+ * also runs the journal's timed group commit and snapshots.
+ *
+ * Core change events are recorded while the lock is held and replayed on the
+ * pipeline's thread to the view listeners (see addViewListener), followed by
+ * requestsCompleted, so models are only touched from the GUI thread. Once
+ * started, all other access to the core must go through read() and write(),
+ * and models reading it must lock coreLock() shared.
+ */
+class BookingPipeline : public QObject, public SchedulerListener
+{
+    Q_OBJECT
+
+public:
+    BookingPipeline(SchedulerCore *core, SchedulerJournal *journal, QObject *parent = nullptr);
+    ~BookingPipeline();
+
+    void setMetrics(SchedulerMetrics *metrics) { metrics_ = metrics; } // before start(); times apply and commit
+    void setTrace(SchedulerTrace *trace) { trace_ = trace; } // before start(); records each request while it is open
+    void setStripeCount(size_t count); // before start(); one worker thread each, kDefaultStripes by default
+    size_t stripeCount() const { return stripe_count_; }
+    void start();
+    void stop(); // finishes the queued requests, then joins the worker
+
+    // Thread-safe; each returns a ticket that identifies the BookingOutcome
+    uint64_t submitBooking(int slot_id, const std::string &patient_name, int patient_age);
+    uint64_t submitEarliest(int64_t day, const std::string &patient_name, int patient_age);
+    // Books the earliest open slot starting at or after start_key, on any date
+    uint64_t submitNextAvailable(int64_t start_key, const std::string &patient_name, int patient_age);
+    uint64_t submitCancel(int booking_id);
+
+    // Syncs what earlier write() calls journaled; false, suspending bookings as a failed batch
+    // commit does, when the journal cannot
+    bool commitWrites();
+    bool storageFailed() const { return storage_failed_; }
+
+    // Runs function(const SchedulerCore &) under the shared lock
+    template <typename Function>
+    void read(Function &&function) const
+    {
+        std::shared_lock<std::shared_mutex> lock(core_mutex_);
+        function(static_cast<const SchedulerCore &>(*core_));
+    }
+
+    // Runs function(SchedulerCore &) under the exclusive lock; its events reach the views later
+    template <typename Function>
+    void write(Function &&function)
+    {
+        std::unique_lock<std::shared_mutex> lock(core_mutex_);
+        function(*core_);
+        if (!events_.empty())
+            postEvents();
+    }
+
+    std::shared_mutex *coreLock() { return &core_mutex_; }
+
+    // Listeners that receive core events on the pipeline's thread instead of the mutating one
+    void addViewListener(SchedulerListener *listener);
+
+    void slotAdded(const TimeSlot &slot) override;
+    void slotBooked(const TimeSlot &slot, const Patient &booking) override;
+    void slotReleased(const TimeSlot &slot) override;
+    void bookingRemoved(const Patient &booking, size_t position) override;
+    void bookingArchived(const Patient &booking, size_t position) override;
+    void slotsAdded(const RecurringSlotSpec &spec) override;
+    void slotsImported(int first_slot_id, size_t count) override;
+
+    static constexpr size_t kDefaultStripes = 4;
+
+signals:
+    void requestsCompleted(const std::vector<BookingOutcome> &outcomes);
+
+private:
+    struct Request
+    {
+        uint64_t ticket;
+        BookingOutcome::Kind kind;
+        int id; // slot id, or booking id for cancellations
+        int64_t when; // day for BookEarliest, start key for BookNext
+        std::string patient_name;
+        int patient_age;
+    };
+
+    // A core change captured under the lock, replayed to the view listeners later
+    struct RecordedEvent
+    {
+        enum Type
+        {
+            SlotAdded,
+            SlotBooked,
+            SlotReleased,
+            BookingRemoved,
+            BookingArchived,
+            SlotsAdded,
+            SlotsImported
+        };
+
+        explicit RecordedEvent(Type event_type) : type(event_type) {}
+
+        Type type;
+        std::optional<TimeSlot> slot;
+        std::optional<Patient> booking;
+        size_t position = 0; // bookingRemoved/bookingArchived position, or slotsImported count
+        int first_slot_id = 0;
+        RecurringSlotSpec spec;
+    };
+
+    // Each stripe starts on its own cache line, so neighbouring queues do not false-share
+    struct alignas(64) Stripe
+    {
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::vector<Request> queue;
+        std::thread worker;
+    };
+
+    uint64_t submit(Request request, int64_t day);
+    int64_t dayOfSlot(int slot_id) const; // 0 for unknown slots; takes the shared lock
+    void run(size_t stripe);
+    BookingOutcome apply(const Request &request);
+    BookingOutcome refuse(const Request &request); // once storage has failed
+    void trace(const Request &request, const BookingOutcome &outcome); // caller holds the exclusive lock
+    // Flushes the journal once the batches applied before order are committed, then reports outcomes
+    void commit(uint64_t order, std::vector<BookingOutcome> outcomes);
+    void pollJournal();
+    void postEvents(); // caller holds the exclusive lock
+    void deliver(const std::vector<RecordedEvent> &events);
+
+    SchedulerCore *core_;
+    SchedulerJournal *journal_;
+    SchedulerMetrics *metrics_;
+    SchedulerTrace *trace_;
+    mutable std::shared_mutex core_mutex_;
+    std::vector<RecordedEvent> events_; // guarded by core_mutex_
+    uint64_t applied_batches_;          // guarded by core_mutex_
+    std::vector<SchedulerListener *> view_listeners_;
+
+    size_t stripe_count_;
+    std::unique_ptr<Stripe[]> stripes_;
+    std::atomic<uint64_t> next_ticket_;
+    std::atomic<bool> stopping_;
+    std::atomic<bool> storage_failed_;
+    bool started_;
+
+    std::mutex commit_mutex_;
+    std::condition_variable commit_turn_;
+    uint64_t committed_batches_; // guarded by commit_mutex_
+};
+
+#endif // BOOKING_PIPELINE_H
@@ -0,0 +1,123 @@
+#include "booking_protocol.h"
+
+namespace
+{
+// Splits off the next space-separated token; returns false at the end of the line
+bool nextToken(const char **p, const char *end, std::string *token)
+{
+    while (*p < end && **p == ' ')
+        ++*p;
+    const char *start = *p;
+    while (*p < end && **p != ' ')
+        ++*p;
+    token->assign(start, *p);
+    return !token->empty();
+}
+
+bool parseNumber(const std::string &text, int *value)
+{
+    if (text.empty() || text.size() > 9)
+        return false;
+    int result = 0;
+    for (char c : text)
+    {
+        if (c < '0' || c > '9')
+            return false;
+        result = result * 10 + (c - '0');
+    }
+    *value = result;
+    return true;
+}
+
+// The rest of the line, without surrounding blanks
+std::string remainder(const char *p, const char *end)
+{
+    while (p < end && *p == ' ')
+        ++p;
+    while (end > p && end[-1] == ' ')
+        --end;
+    return std::string(p, end);
+}
+} // namespace
+
+ProtocolRequest parseProtocolRequest(const char *data, size_t size)
+{
+    ProtocolRequest request;
+    const char *p = data;
+    const char *end = data + size;
+    if (end > p && end[-1] == '\r')
+        --end;
+
+    std::string command, token;
+    if (!nextToken(&p, end, &command))
+        return request;
+
+    if (command == "PING")
+    {
+        request.type = ProtocolRequest::Ping;
+    }
+    else if (command == "AVAIL")
+    {
+        if (nextToken(&p, end, &token) && parseSlotDate(token, &request.day))
+            request.type = ProtocolRequest::Available;
+    }
+    else if (command == "BOOK" || command == "NEXT")
+    {
+        bool target_ok = command == "BOOK" ? nextToken(&p, end, &token) && parseNumber(token, &request.id)
+                                           : nextToken(&p, end, &token) && parseSlotDate(token, &request.day);
+        if (target_ok && nextToken(&p, end, &token) && parseNumber(token, &request.age))
+        {
+            request.name = remainder(p, end);
+            request.type = command == "BOOK" ? ProtocolRequest::Book : ProtocolRequest::Next;
+        }
+    }
+    else if (command == "CANCEL")
+    {
+        if (nextToken(&p, end, &token) && parseNumber(token, &request.id))
+            request.type = ProtocolRequest::Cancel;
+    }
+    return request;
+}
+
+std::string formatProtocolOk()
+{
+    return "OK\n";
+}
+
+std::string formatProtocolAvailable(const std::vector<TimeSlot> &slots)
+{
+    std::string line = "OK " + std::to_string(slots.size());
+    line.reserve(line.size() + slots.size() * 20 + 1);
+    for (const TimeSlot &slot : slots)
+    {
+        line.push_back(' ');
+        line.append(std::to_string(slot.getId())).push_back(',');
+        line.append(slot.getTime()).push_back(',');
+        line.append(std::to_string(slot.getLane())).push_back(',');
+        line.append(std::to_string(slot.getSeatsLeft()));
+    }
+    line.push_back('\n');
+    return line;
+}
+
+std::string formatProtocolBooked(int booking_id, int slot_id, int64_t start_key, int lane)
+{
+    return "OK " + std::to_string(booking_id) + " " + std::to_string(slot_id) + " " +
+           formatSlotDate(dayOfKey(start_key)) + " " + formatSlotTime(minuteOfKey(start_key)) + " " +
+           std::to_string(lane) + "\n";
+}
+
+std::string formatProtocolCancelled(int booking_id)
+{
+    return "OK " + std::to_string(booking_id) + "\n";
+}
+
+std::string formatProtocolError(SchedulerResult result)
+{
+    return "ERR " + std::to_string(static_cast<int>(result)) + " " + schedulerResultText(result) + "\n";
+}
+
+std::string formatProtocolMalformed()
+{
+    return "ERR " + std::to_string(kProtocolMalformedCode) + " Malformed request.\n";
+}
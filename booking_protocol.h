@@ -0,0 +1,56 @@
+#ifndef BOOKING_PROTOCOL_H
+#define BOOKING_PROTOCOL_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "scheduler_core.h"
+
+/**
+ * @brief Parsed request of the kiosk line protocol
+ *
+ * One request per '\n'-terminated line; clients may send many lines without
+ * waiting and receive exactly one response line per request, in order.
+ *
+ *   PING                          -> OK
+ *   AVAIL yyyy-MM-dd              -> OK <count> [<slot id>,<hh:mm>,<lane>,<seats left> ...]
+ *   BOOK <slot id> <age> <name>   -> OK <booking id> <slot id> <yyyy-MM-dd> <hh:mm> <lane>
+ *   NEXT yyyy-MM-dd <age> <name>  -> same as BOOK, for the earliest open slot on that date or later
+ *   CANCEL <booking id>           -> OK <booking id>
+ *
+ * Failures answer "ERR <code> <message>", where code is the SchedulerResult
+ * value, or 100 for a malformed request.
+ */
+struct ProtocolRequest
+{
+    enum Type
+    {
+        Ping,
+        Available,
+        Book,
+        Next,
+        Cancel,
+        Invalid
+    };
+
+    Type type = Invalid;
+    int64_t day = 0;
+    int id = 0; // slot id for BOOK, booking id for CANCEL
+    int age = 0;
+    std::string name;
+};
+
+const int kProtocolMalformedCode = 100;
+const size_t kProtocolMaxLine = 4096;
+
+// Parses one line without its terminator (a trailing '\r' is ignored)
+ProtocolRequest parseProtocolRequest(const char *data, size_t size);
+
+std::string formatProtocolOk();
+std::string formatProtocolAvailable(const std::vector<TimeSlot> &slots);
+std::string formatProtocolBooked(int booking_id, int slot_id, int64_t start_key, int lane);
+std::string formatProtocolCancelled(int booking_id);
+std::string formatProtocolError(SchedulerResult result);
+std::string formatProtocolMalformed();
+
+#endif // BOOKING_PROTOCOL_H
@@ -0,0 +1,223 @@
+#include "booking_server.h"
+#include "booking_protocol.h"
+#include <QtNetwork/QLocalSocket>
+#include <QtNetwork/QTcpSocket>
+#include <unordered_set>
+#include "slot_time.h"
+
+BookingServer::BookingServer(BookingPipeline *pipeline, QObject *parent)
+    : QObject(parent), pipeline_(pipeline), local_server_(nullptr), tcp_server_(nullptr), next_connection_id_(1)
+{
+    connect(pipeline_, &BookingPipeline::requestsCompleted, this, &BookingServer::completeRequests);
+}
+
+BookingServer::~BookingServer()
+{
+    for (auto &entry : connections_)
+    {
+        entry.second->socket->disconnect(this);
+        entry.second->socket->deleteLater();
+    }
+}
+
+bool BookingServer::listenLocal(const QString &name, QString *error)
+{
+    if (!local_server_)
+    {
+        local_server_ = new QLocalServer(this);
+        connect(local_server_, &QLocalServer::newConnection, this, [this]()
+                {
+            while (QLocalSocket *socket = local_server_->nextPendingConnection())
+            {
+                connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+                addConnection(socket);
+            } });
+    }
+    // A socket file left by a crashed instance would make listen() fail
+    QLocalServer::removeServer(name);
+    if (!local_server_->listen(name))
+    {
+        if (error)
+            *error = local_server_->errorString();
+        return false;
+    }
+    return true;
+}
+
+bool BookingServer::listenTcp(quint16 port, QString *error)
+{
+    if (!tcp_server_)
+    {
+        tcp_server_ = new QTcpServer(this);
+        connect(tcp_server_, &QTcpServer::newConnection, this, [this]()
+                {
+            while (QTcpSocket *socket = tcp_server_->nextPendingConnection())
+            {
+                socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+                connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+                addConnection(socket);
+            } });
+    }
+    if (!tcp_server_->listen(QHostAddress::LocalHost, port))
+    {
+        if (error)
+            *error = tcp_server_->errorString();
+        return false;
+    }
+    return true;
+}
+
+void BookingServer::addConnection(QIODevice *socket)
+{
+    uint64_t connection_id = next_connection_id_++;
+    if (auto *tcp_socket = qobject_cast<QAbstractSocket *>(socket))
+        tcp_socket->setReadBufferSize(kReadBufferSize);
+    else if (auto *local_socket = qobject_cast<QLocalSocket *>(socket))
+        local_socket->setReadBufferSize(kReadBufferSize);
+    connections_.emplace(connection_id, std::unique_ptr<Connection>(new Connection{socket, QByteArray(), {}}));
+    connect(socket, &QIODevice::readyRead, this, [this, connection_id]()
+            { readRequests(connection_id); });
+    // deleteLater is already connected; destroyed covers both socket kinds
+    connect(socket, &QObject::destroyed, this, [this, connection_id]()
+            { removeConnection(connection_id); });
+    readRequests(connection_id);
+}
+
+void BookingServer::readRequests(uint64_t connection_id)
+{
+    auto it = connections_.find(connection_id);
+    if (it == connections_.end())
+        return;
+    Connection *connection = it->second.get();
+    // The socket is read only once every buffered line is handled, so input holds at most one
+    // read buffer; at the cap the rest waits in the socket until completeRequests makes room
+    if (connection->input.indexOf('\n') < 0 && connection->socket->isOpen())
+        connection->input.append(connection->socket->readAll());
+
+    int start = 0;
+    for (;;)
+    {
+        int newline = connection->input.indexOf('\n', start);
+        if (newline < 0)
+            break;
+        if (connection->responses.size() >= kMaxInFlight)
+        {
+            // Answers that are already final free their places for the lines still waiting
+            writeReady(connection);
+            if (connection->responses.size() >= kMaxInFlight)
+                break;
+        }
+        handleLine(connection_id, connection, connection->input.constData() + start, static_cast<size_t>(newline - start));
+        start = newline + 1;
+    }
+    connection->input.remove(0, start);
+
+    if (connection->input.indexOf('\n') < 0 && static_cast<size_t>(connection->input.size()) > kProtocolMaxLine)
+    {
+        // Answer what is already queued, then drop a client that never ends its line
+        connection->responses.push_back({0, QByteArray::fromStdString(formatProtocolMalformed()), std::nullopt});
+        writeReady(connection);
+        connection->input.clear();
+        connection->socket->close();
+        return;
+    }
+    writeReady(connection);
+    // readyRead only fires for new data, so bytes left in the socket are picked up from the event loop
+    if (connection->responses.size() < kMaxInFlight && connection->socket->isOpen() &&
+        connection->socket->bytesAvailable() > 0)
+        QMetaObject::invokeMethod(this, [this, connection_id]()
+                                  { readRequests(connection_id); }, Qt::QueuedConnection);
+}
+
+void BookingServer::handleLine(uint64_t connection_id, Connection *connection, const char *data, size_t size)
+{
+    ProtocolRequest request = parseProtocolRequest(data, size);
+    uint64_t ticket = 0;
+    std::string text;
+    std::optional<int64_t> available_day;
+    switch (request.type)
+    {
+    case ProtocolRequest::Ping:
+        text = formatProtocolOk();
+        break;
+    case ProtocolRequest::Available:
+        // Reading now would answer ahead of this connection's bookings still in the pipeline
+        available_day = request.day;
+        break;
+    case ProtocolRequest::Book:
+        ticket = pipeline_->submitBooking(request.id, request.name, request.age);
+        break;
+    case ProtocolRequest::Next:
+        ticket = pipeline_->submitNextAvailable(makeStartKey(request.day, 0), request.name, request.age);
+        break;
+    case ProtocolRequest::Cancel:
+        ticket = pipeline_->submitCancel(request.id);
+        break;
+    case ProtocolRequest::Invalid:
+        text = formatProtocolMalformed();
+        break;
+    }
+
+    connection->responses.push_back({ticket, QByteArray::fromStdString(text), available_day});
+    if (ticket)
+        ticket_connections_.emplace(ticket, connection_id);
+}
+
+void BookingServer::writeReady(Connection *connection)
+{
+    // Only the completed prefix goes out, which keeps responses in request order
+    QByteArray out;
+    while (!connection->responses.empty() && connection->responses.front().ticket == 0)
+    {
+        Response &response = connection->responses.front();
+        if (response.available_day)
+            pipeline_->read([&](const SchedulerCore &core)
+                            { response.text = QByteArray::fromStdString(formatProtocolAvailable(core.availableSlots(*response.available_day))); });
+        out.append(response.text);
+        connection->responses.pop_front();
+    }
+    if (!out.isEmpty() && connection->socket->isOpen())
+        connection->socket->write(out);
+}
+
+void BookingServer::removeConnection(uint64_t connection_id)
+{
+    // Outstanding tickets stay in ticket_connections_ and are dropped when their outcome arrives
+    connections_.erase(connection_id);
+}
+
+void BookingServer::completeRequests(const std::vector<BookingOutcome> &outcomes)
+{
+    std::unordered_set<uint64_t> touched;
+    for (const BookingOutcome &outcome : outcomes)
+    {
+        auto ticket_it = ticket_connections_.find(outcome.ticket);
+        if (ticket_it == ticket_connections_.end())
+            continue; // submitted by the window, not by a client
+        auto connection_it = connections_.find(ticket_it->second);
+        ticket_connections_.erase(ticket_it);
+        if (connection_it == connections_.end())
+            continue;
+
+        Connection *connection = connection_it->second.get();
+        for (Response &response : connection->responses)
+        {
+            if (response.ticket != outcome.ticket)
+                continue;
+            std::string text;
+            if (outcome.result != SchedulerResult::Ok)
+                text = formatProtocolError(outcome.result);
+            else if (outcome.kind == BookingOutcome::Cancel)
+                text = formatProtocolCancelled(outcome.booking_id);
+            else
+                text = formatProtocolBooked(outcome.booking_id, outcome.slot_id, outcome.start_key, outcome.lane);
+            response.text = QByteArray::fromStdString(text);
+            response.ticket = 0;
+            break;
+        }
+        touched.insert(connection_it->first);
+    }
+    // Sends the answers now in order and reads on from a connection that was at its cap
+    for (uint64_t connection_id : touched)
+        readRequests(connection_id);
+}
@@ -0,0 +1,75 @@
+#ifndef BOOKING_SERVER_H
+#define BOOKING_SERVER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QObject>
+#include <QtCore/QString>
+#include <QtNetwork/QLocalServer>
+#include <QtNetwork/QTcpServer>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include "booking_pipeline.h"
+
+/**
+ * @brief Event-driven endpoint serving the kiosk line protocol
+ *
+ * Listens on a local socket (Unix domain socket or named pipe) and/or TCP on
+ * loopback. Each connection's input is split into lines as it arrives and
+ * every request is handled without blocking: book, next and cancel are
+ * queued on the BookingPipeline and answered from requestsCompleted, while
+ * availability is read under the pipeline's shared lock once every earlier
+ * request on the connection has been answered, so it reflects them.
+ * Responses are held per connection and released strictly in request order,
+ * so clients can pipeline freely. A connection with kMaxInFlight unanswered
+ * requests is not read further until some are answered; the socket's bounded
+ * read buffer then pushes back on the client. See booking_protocol.h for the wire format.
+ */
+class BookingServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit BookingServer(BookingPipeline *pipeline, QObject *parent = nullptr);
+    ~BookingServer();
+
+    bool listenLocal(const QString &name, QString *error = nullptr);
+    bool listenTcp(quint16 port, QString *error = nullptr); // loopback only
+    size_t connectionCount() const { return connections_.size(); }
+
+    static constexpr size_t kMaxInFlight = 256;          // unanswered requests per connection
+    static constexpr qint64 kReadBufferSize = 64 * 1024; // bytes a paused socket holds before the client waits
+
+private:
+    struct Response
+    {
+        uint64_t ticket; // 0 once text is final
+        QByteArray text;
+        std::optional<int64_t> available_day; // AVAIL: read when it reaches the front
+    };
+
+    struct Connection
+    {
+        QIODevice *socket;
+        QByteArray input;
+        std::deque<Response> responses;
+    };
+
+    void addConnection(QIODevice *socket);
+    void readRequests(uint64_t connection_id);
+    void handleLine(uint64_t connection_id, Connection *connection, const char *data, size_t size);
+    void writeReady(Connection *connection);
+    void removeConnection(uint64_t connection_id);
+    void completeRequests(const std::vector<BookingOutcome> &outcomes);
+
+    BookingPipeline *pipeline_;
+    QLocalServer *local_server_;
+    QTcpServer *tcp_server_;
+    uint64_t next_connection_id_;
+    std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections_;
+    std::unordered_map<uint64_t, uint64_t> ticket_connections_; // pipeline ticket -> connection id
+};
+
+#endif // BOOKING_SERVER_H
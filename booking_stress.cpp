@@ -0,0 +1,213 @@
+// Multi-threaded double-booking stress test for BookingPipeline.
+//
+//   booking_stress [--threads 8] [--requests 50000] [--days 30] [--lanes 4] [--capacity 2] [--stripes 4]
+//
+// Every intake desk and kiosk in the process books through one
+// BookingPipeline, so this is the path that must never hand out a seat
+// twice. --threads producer threads each submit --requests random requests
+// (earliest slot of a day, a given slot, or a cancellation of some booking
+// id) while also reading availability through the pipeline's shared lock.
+// The pipeline spreads the dates over --stripes worker threads. Outcomes
+// arrive in the order the workers applied them; replaying them
+// against a per-slot seat counter flags any booking past a slot's capacity,
+// any booking id handed out twice and any cancellation of a booking that was
+// not live. Once the queue drains, the counters must equal the core's booked
+// counts and live bookings. Exits with 1 on any violation. Qt Core only.
+
+#include <QtCore/QCoreApplication>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "booking_pipeline.h"
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+    int threads = 8;
+    long requests = 50000; // per thread
+    int days = 30;
+    int lanes = 4;
+    int capacity = 2;
+    int stripes = static_cast<int>(BookingPipeline::kDefaultStripes);
+};
+
+const int64_t kFirstDay = 20000;
+
+void usage()
+{
+    std::fprintf(stderr, "usage: booking_stress [--threads N] [--requests N] [--days N] [--lanes N] [--capacity N] [--stripes N]\n");
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--threads")
+            options.threads = std::max(1, std::atoi(value));
+        else if (flag == "--requests")
+            options.requests = std::max(1L, std::atol(value));
+        else if (flag == "--days")
+            options.days = std::max(1, std::atoi(value));
+        else if (flag == "--lanes")
+            options.lanes = std::max(1, std::atoi(value));
+        else if (flag == "--capacity")
+            options.capacity = std::max(1, std::atoi(value));
+        else if (flag == "--stripes")
+            options.stripes = std::max(1, std::atoi(value));
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (argc % 2 == 0)
+    {
+        usage();
+        return 2;
+    }
+
+    SchedulerCore core;
+    RecurringSlotSpec spec;
+    spec.first_day = kFirstDay;
+    spec.last_day = kFirstDay + options.days - 1;
+    spec.windows = {{8 * 60, 18 * 60}};
+    spec.interval_minutes = 10;
+    spec.lanes = options.lanes;
+    spec.capacity = options.capacity;
+    if (core.addRecurringSlots(spec) != SchedulerResult::Ok)
+    {
+        std::fprintf(stderr, "cannot create the calendar\n");
+        return 1;
+    }
+    const int slot_count = static_cast<int>(core.slotCount());
+
+    // Only touched on this thread, where the outcomes are delivered
+    std::vector<int> seats_taken(slot_count + 1, 0);
+    std::unordered_map<int, int> live; // booking id -> slot id
+    long booked = 0, cancelled = 0, refused = 0, violations = 0;
+    auto violation = [&](const char *what, int booking_id, int slot_id)
+    {
+        if (violations++ < 10)
+            std::printf("violation: %s (booking %d, slot %d)\n", what, booking_id, slot_id);
+    };
+
+    BookingPipeline pipeline(&core, nullptr);
+    pipeline.setStripeCount(static_cast<size_t>(options.stripes));
+    QObject::connect(&pipeline, &BookingPipeline::requestsCompleted, [&](const std::vector<BookingOutcome> &outcomes)
+                     {
+        for (const BookingOutcome &outcome : outcomes)
+        {
+            if (outcome.result != SchedulerResult::Ok)
+            {
+                ++refused;
+                continue;
+            }
+            if (outcome.kind == BookingOutcome::Cancel)
+            {
+                auto live_it = live.find(outcome.booking_id);
+                if (live_it == live.end() || live_it->second != outcome.slot_id)
+                {
+                    violation("cancelled a booking that was not live", outcome.booking_id, outcome.slot_id);
+                    continue;
+                }
+                --seats_taken[live_it->second];
+                live.erase(live_it);
+                ++cancelled;
+                continue;
+            }
+            if (outcome.slot_id < 1 || outcome.slot_id > slot_count)
+            {
+                violation("booked a slot that does not exist", outcome.booking_id, outcome.slot_id);
+                continue;
+            }
+            if (!live.emplace(outcome.booking_id, outcome.slot_id).second)
+                violation("booking id handed out twice", outcome.booking_id, outcome.slot_id);
+            if (++seats_taken[outcome.slot_id] > options.capacity)
+                violation("slot booked past its capacity", outcome.booking_id, outcome.slot_id);
+            ++booked;
+        } });
+    pipeline.start();
+
+    // Cancellations aim at ids up to the number of booking requests so far, so many hit live bookings
+    std::atomic<long> booking_requests(0);
+    Clock::time_point started = Clock::now();
+    std::vector<std::thread> producers;
+    for (int t = 0; t < options.threads; ++t)
+    {
+        producers.emplace_back([&, t]()
+                               {
+            std::mt19937 random(static_cast<unsigned>(t + 1));
+            for (long i = 0; i < options.requests; ++i)
+            {
+                int64_t day = kFirstDay + static_cast<int64_t>(random() % options.days);
+                unsigned pick = random() % 10;
+                if (pick < 4)
+                {
+                    pipeline.submitEarliest(day, "desk " + std::to_string(t), 30);
+                    ++booking_requests;
+                }
+                else if (pick < 7)
+                {
+                    pipeline.submitBooking(1 + static_cast<int>(random() % slot_count), "kiosk " + std::to_string(t), 40);
+                    ++booking_requests;
+                }
+                else if (pick < 9)
+                {
+                    long issued = std::max(1L, booking_requests.load());
+                    pipeline.submitCancel(1 + static_cast<int>(random() % issued));
+                }
+                else
+                {
+                    pipeline.read([&](const SchedulerCore &reader)
+                                  { reader.availableCount(day); });
+                }
+            } });
+    }
+    for (std::thread &producer : producers)
+        producer.join();
+    pipeline.stop();
+    double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+
+    // stop() has applied everything; deliver the outcomes still queued for this thread
+    QCoreApplication::sendPostedEvents();
+    QCoreApplication::processEvents();
+
+    pipeline.read([&](const SchedulerCore &reader)
+                  {
+        for (int slot_id = 1; slot_id <= slot_count; ++slot_id)
+        {
+            std::optional<TimeSlot> slot = reader.findSlot(slot_id);
+            if (!slot || slot->getBookedCount() != seats_taken[slot_id])
+                violation("core's booked count differs from the outcomes", 0, slot_id);
+        }
+        if (reader.bookings().size() != live.size())
+            violation("core's live bookings differ from the outcomes", 0, 0);
+        for (const Patient &booking : reader.bookings())
+        {
+            auto live_it = live.find(booking.getBookingId());
+            if (live_it == live.end() || live_it->second != booking.getSlotId())
+                violation("core holds a booking no outcome reported", booking.getBookingId(), booking.getSlotId());
+        } });
+
+    long requests = options.threads * options.requests;
+    std::printf("%ld requests from %d threads over %d stripes on %d slots x %d seats in %.3f s: %.0f requests/s\n",
+                requests, options.threads, options.stripes, slot_count, options.capacity, seconds, requests / seconds);
+    std::printf("%ld booked, %ld cancelled, %ld refused, %zu live; %ld violations\n", booked, cancelled, refused,
+                live.size(), violations);
+    return violations ? 1 : 0;
+}
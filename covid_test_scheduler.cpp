@@ -1,4 +1,5 @@
 #include "covid_test_scheduler.h"
+#include "recurring_slots_dialog.h"
 #include <QApplication>
 #include <QDateTime>
 #include <QDebug>
@@ -13,48 +14,44 @@
 #include <QHBoxLayout>
 #include <QGridLayout>
 #include <algorithm>
+#include <limits>
 #include <QDateEdit>
-
-// TimeSlot Implementation
-TimeSlot::TimeSlot(int id, const QString &time, const QString &date)
-    : id_(id), time_(time), date_(date), is_booked_(false) {}
-
-bool TimeSlot::operator>(const TimeSlot &other) const
-{
-    QDateTime this_datetime = QDateTime::fromString(getDateTime(), "yyyy-MM-dd hh:mm");
-    QDateTime other_datetime = QDateTime::fromString(other.getDateTime(), "yyyy-MM-dd hh:mm");
-    return this_datetime > other_datetime;
-}
-
-bool TimeSlot::operator<(const TimeSlot &other) const
-{
-    QDateTime this_datetime = QDateTime::fromString(getDateTime(), "yyyy-MM-dd hh:mm");
-    QDateTime other_datetime = QDateTime::fromString(other.getDateTime(), "yyyy-MM-dd hh:mm");
-    return this_datetime < other_datetime;
-}
-
-bool TimeSlot::operator==(const TimeSlot &other) const
-{
-    return id_ == other.id_;
-}
-
-// Patient Implementation
-Patient::Patient(const QString &name, int age, std::shared_ptr<TimeSlot> assignedSlot)
-    : name_(name), age_(age), assigned_slot_(assignedSlot)
-{
-    booking_time_ = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-}
+#include <QCalendarWidget>
+#include <QTextCharFormat>
+#include <QStandardPaths>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileDialog>
+#include <QPlainTextEdit>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QFontDatabase>
 
 // CovidTestScheduler Implementation
 CovidTestScheduler::CovidTestScheduler(QWidget *parent)
-    : QMainWindow(parent), next_slot_id_(1)
+    : QMainWindow(parent), server_(nullptr), swept_floor_(std::numeric_limits<int64_t>::min()), archive_(&core_),
+      trace_(&core_), pipeline_(&core_, &journal_)
 {
+    // Recover before the views subscribe, so replay does not emit row-by-row updates
+    QString journal_status = restoreSchedule();
+
     setupUI();
+    setupPerformancePanel(); // before the menu bar, which holds its toggle action
     setupMenuBar();
     setupStatusBar();
+    status_label_->setText(journal_status);
+
+    // Initialize with some sample slots on first start
+    if (core_.slotCount() == 0)
+        addSampleSlots();
 
-    // Initialize with some sample slots
-    addSampleSlots();
+    // From here on bookings run on the pipeline's worker, which also drives the journal's group commit
+    connect(&pipeline_, &BookingPipeline::requestsCompleted, this, &CovidTestScheduler::showOutcomes);
+    pipeline_.setMetrics(&metrics_);
+    core_.addListener(&trace_);
+    pipeline_.setTrace(&trace_);
+    pipeline_.start();
 
     // Setup timer for datetime updates
     datetime_timer_ = new QTimer(this);
@@ -67,7 +64,72 @@ CovidTestScheduler::CovidTestScheduler(QWidget *parent)
 
 CovidTestScheduler::~CovidTestScheduler()
 {
-    // Qt handles cleanup automatically
+    // Qt handles cleanup automatically; queued requests finish and the journal flushes its last group here
+    delete server_;
+    pipeline_.stop();
+    trace_.close();
+    core_.removeListener(&trace_);
+    journal_.close();
+    core_.removeListener(&archive_);
+    archive_.close();
+}
+
+bool CovidTestScheduler::startServer(const QString &local_name, quint16 tcp_port, QString *error)
+{
+    if (!server_)
+        server_ = new BookingServer(&pipeline_, this);
+    if (!local_name.isEmpty() && !server_->listenLocal(local_name, error))
+        return false;
+    if (tcp_port != 0 && !server_->listenTcp(tcp_port, error))
+        return false;
+    QStringList endpoints;
+    if (!local_name.isEmpty())
+        endpoints << local_name;
+    if (tcp_port != 0)
+        endpoints << QString("127.0.0.1:%1").arg(tcp_port);
+    status_label_->setText(QString("Serving bookings on %1").arg(endpoints.join(" and ")));
+    return true;
+}
+
+bool CovidTestScheduler::startTrace(const QString &path, QString *error)
+{
+    // Opening under the exclusive lock puts the baseline and the first record in order with the worker
+    bool opened = false;
+    std::string open_error;
+    pipeline_.write([&](SchedulerCore &)
+                    { opened = trace_.open(path.toStdString(), &open_error); });
+    if (!opened)
+    {
+        if (error)
+            *error = QString::fromStdString(open_error);
+        return false;
+    }
+    status_label_->setText(QString("Recording operations to %1").arg(path));
+    return true;
+}
+
+QString CovidTestScheduler::restoreSchedule()
+{
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    std::string error;
+
+    // A published calendar image is mapped, not loaded, so startup cost does not grow with it
+    QString image_path = QDir(directory).filePath("calendar.img");
+    if (QFile::exists(image_path) && image_.open(image_path.toStdString(), &error))
+        core_.attachImage(&image_);
+
+    // The archive hears archivals before the journal records them, but only opens once replay is over
+    core_.addListener(&archive_);
+    if (!journal_.open(directory.toStdString(), &core_, &error))
+        return QString("Journal unavailable, changes will not be saved: %1").arg(QString::fromStdString(error));
+    if (!archive_.open(QDir(directory).filePath("bookings.archive").toStdString(), &error))
+        return QString("Booking archive unavailable, past dates are kept: %1").arg(QString::fromStdString(error));
+    // Archived bookings must be on disk before the journal records that drop them
+    journal_.setSyncBefore([this]()
+                           { return archive_.sync(); });
+    if (core_.slotCount() == 0)
+        return "Ready";
+    return QString("Restored %1 slots and %2 bookings").arg(core_.slotCount()).arg(core_.bookings().size());
 }
 
 void CovidTestScheduler::setupUI()
@@ -87,8 +149,20 @@ void CovidTestScheduler::setupUI()
     date_select_edit_->setDisplayFormat("yyyy-MM-dd");
     date_select_edit_->setCalendarPopup(true);
     date_select_layout->addWidget(date_select_edit_);
+    period_totals_label_ = new QLabel();
+    date_select_layout->addWidget(period_totals_label_, 1);
     main_layout_->addLayout(date_select_layout);
-    connect(date_select_edit_, &QDateEdit::dateChanged, this, &CovidTestScheduler::refreshDisplay);
+    // Only the slot list depends on the selected date
+    connect(date_select_edit_, &QDateEdit::dateChanged, this, &CovidTestScheduler::updateAvailableSlotsForSelectedDate);
+    // The popup shades each date by its open capacity; paging to another month repaints from the counters
+    connect(date_select_edit_->calendarWidget(), &QCalendarWidget::currentPageChanged, this,
+            [this](int, int)
+            { updateCalendarHeatmap(); });
+    // Outcomes arrive in bursts, so count updates only arm a single-shot repaint
+    heatmap_timer_ = new QTimer(this);
+    heatmap_timer_->setSingleShot(true);
+    heatmap_timer_->setInterval(250);
+    connect(heatmap_timer_, &QTimer::timeout, this, &CovidTestScheduler::updateCalendarHeatmap);
 
     // Create splitter for better layout management
     QSplitter *main_splitter = new QSplitter(Qt::Horizontal, this);
@@ -114,9 +188,18 @@ void CovidTestScheduler::setupUI()
     time_input_->setPlaceholderText("09:00");
     add_slot_layout->addWidget(time_input_, 1, 1);
 
+    add_slot_layout->addWidget(new QLabel("Seats:"), 2, 0);
+    capacity_input_ = new QSpinBox();
+    capacity_input_->setRange(1, SchedulerCore::kMaxCapacity);
+    capacity_input_->setValue(1);
+    add_slot_layout->addWidget(capacity_input_, 2, 1);
+
     add_slot_button_ = new QPushButton("Add Slot");
     add_slot_button_->setStyleSheet("QPushButton { background-color: #4CAF50; color: white; font-weight: bold; }");
-    add_slot_layout->addWidget(add_slot_button_, 2, 0, 1, 2);
+    add_slot_layout->addWidget(add_slot_button_, 3, 0, 1, 2);
+
+    generate_slots_button_ = new QPushButton("Generate Recurring Slots...");
+    add_slot_layout->addWidget(generate_slots_button_, 4, 0, 1, 2);
 
     left_layout->addWidget(add_slot_group_);
 
@@ -136,13 +219,25 @@ void CovidTestScheduler::setupUI()
     book_layout->addWidget(patient_age_input_, 1, 1);
 
     book_layout->addWidget(new QLabel("Available Slots:"), 2, 0);
+    slots_model_ = new AvailableSlotsModel(&core_, this);
+    slots_model_->setCoreLock(pipeline_.coreLock());
+    pipeline_.addViewListener(slots_model_);
     available_slots_combo_ = new QComboBox();
+    available_slots_combo_->setModel(slots_model_);
+    // Size from a fixed character count instead of measuring every row
+    available_slots_combo_->setSizeAdjustPolicy(QComboBox::AdjustToMinimumContentsLengthWithIcon);
+    available_slots_combo_->setMinimumContentsLength(28);
     book_layout->addWidget(available_slots_combo_, 2, 1);
 
     book_slot_button_ = new QPushButton("Book Appointment");
     book_slot_button_->setStyleSheet("QPushButton { background-color: #2196F3; color: white; font-weight: bold; }");
     book_layout->addWidget(book_slot_button_, 3, 0, 1, 2);
 
+    book_next_button_ = new QPushButton("Book Next Available");
+    book_next_button_->setToolTip("Book the earliest open slot from now on, on any date");
+    book_next_button_->setStyleSheet("QPushButton { background-color: #1976D2; color: white; }");
+    book_layout->addWidget(book_next_button_, 4, 0, 1, 2);
+
     left_layout->addWidget(book_patient_group_);
 
     // Action buttons
@@ -180,8 +275,10 @@ void CovidTestScheduler::setupUI()
     slots_group_ = new QGroupBox("Available Time Slots (Min-Heap Order)");
     QVBoxLayout *slots_layout = new QVBoxLayout(slots_group_);
 
-    available_slots_list_ = new QListWidget();
-    available_slots_list_->setStyleSheet("QListWidget { background-color: #222; color: #fff; }");
+    available_slots_list_ = new QListView();
+    available_slots_list_->setModel(slots_model_);
+    available_slots_list_->setUniformItemSizes(true);
+    available_slots_list_->setStyleSheet("QListView { background-color: #222; color: #fff; }");
     slots_layout->addWidget(available_slots_list_);
 
     right_layout->addWidget(slots_group_);
@@ -190,11 +287,20 @@ void CovidTestScheduler::setupUI()
     bookings_group_ = new QGroupBox("Patient Bookings");
     QVBoxLayout *bookings_layout = new QVBoxLayout(bookings_group_);
 
-    bookings_table_ = new QTableWidget();
-    bookings_table_->setColumnCount(5);
-    QStringList headers;
-    headers << "Slot ID" << "Patient Name" << "Age" << "Date & Time" << "Booking Time";
-    bookings_table_->setHorizontalHeaderLabels(headers);
+    // As-you-type search over names, booking ids and dates narrows the table to its matches
+    booking_search_input_ = new QLineEdit();
+    booking_search_input_->setPlaceholderText("Search name, booking id or date");
+    booking_search_input_->setClearButtonEnabled(true);
+    bookings_layout->addWidget(booking_search_input_);
+    search_index_.reload(core_);
+    pipeline_.addViewListener(&search_index_);
+
+    bookings_model_ = new BookingsTableModel(&core_, this);
+    bookings_model_->setCoreLock(pipeline_.coreLock());
+    pipeline_.addViewListener(bookings_model_);
+    bookings_table_ = new QTableView();
+    bookings_table_->setModel(bookings_model_);
+    bookings_table_->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
     bookings_table_->horizontalHeader()->setStretchLastSection(true);
     bookings_table_->setAlternatingRowColors(true);
     bookings_table_->setSelectionBehavior(QAbstractItemView::SelectRows);
@@ -202,15 +308,28 @@ void CovidTestScheduler::setupUI()
 
     right_layout->addWidget(bookings_group_);
 
+    // Booking confirmations and failures, newest last; replaces the per-booking message boxes
+    QGroupBox *feed_group = new QGroupBox("Confirmations");
+    QVBoxLayout *feed_layout = new QVBoxLayout(feed_group);
+    confirmation_feed_ = new QPlainTextEdit();
+    confirmation_feed_->setReadOnly(true);
+    confirmation_feed_->setMaximumBlockCount(500);
+    confirmation_feed_->setMaximumHeight(140);
+    feed_layout->addWidget(confirmation_feed_);
+    right_layout->addWidget(feed_group);
+
     main_splitter->addWidget(right_panel);
     main_splitter->setStretchFactor(0, 0);
     main_splitter->setStretchFactor(1, 1);
 
     // Connect signals
     connect(add_slot_button_, &QPushButton::clicked, this, &CovidTestScheduler::addSlot);
+    connect(generate_slots_button_, &QPushButton::clicked, this, &CovidTestScheduler::generateRecurringSlots);
     connect(book_slot_button_, &QPushButton::clicked, this, &CovidTestScheduler::bookSlot);
+    connect(book_next_button_, &QPushButton::clicked, this, &CovidTestScheduler::bookNextAvailable);
     connect(view_bookings_button_, &QPushButton::clicked, this, &CovidTestScheduler::viewBookings);
     connect(cancel_slot_button_, &QPushButton::clicked, this, &CovidTestScheduler::cancelSlot);
+    connect(booking_search_input_, &QLineEdit::textChanged, this, &CovidTestScheduler::filterBookings);
     connect(refresh_button_, &QPushButton::clicked, this, &CovidTestScheduler::refreshDisplay);
 }
 
@@ -221,11 +340,40 @@ void CovidTestScheduler::setupMenuBar()
     // File menu
     QMenu *fileMenu = menuBar->addMenu("&File");
 
+    QAction *importSlotsAction = new QAction("&Import Slots from CSV...", this);
+    connect(importSlotsAction, &QAction::triggered, this, &CovidTestScheduler::importSlotsCsv);
+    fileMenu->addAction(importSlotsAction);
+
+    QAction *exportBookingsAction = new QAction("Export &Bookings to CSV...", this);
+    connect(exportBookingsAction, &QAction::triggered, this, &CovidTestScheduler::exportBookingsCsv);
+    fileMenu->addAction(exportBookingsAction);
+    fileMenu->addSeparator();
+
+    QAction *exportImageAction = new QAction("Export Calendar &Image...", this);
+    connect(exportImageAction, &QAction::triggered, this, &CovidTestScheduler::exportCalendarImage);
+    fileMenu->addAction(exportImageAction);
+
+    QAction *dumpMetricsAction = new QAction("Dump &Metrics...", this);
+    connect(dumpMetricsAction, &QAction::triggered, this, &CovidTestScheduler::dumpMetrics);
+    fileMenu->addAction(dumpMetricsAction);
+    fileMenu->addSeparator();
+
     QAction *exitAction = new QAction("E&xit", this);
     exitAction->setShortcut(QKeySequence::Quit);
     connect(exitAction, &QAction::triggered, this, &QWidget::close);
     fileMenu->addAction(exitAction);
 
+    // View menu
+    QMenu *viewMenu = menuBar->addMenu("&View");
+    viewMenu->addAction(performance_dock_->toggleViewAction());
+
+    QAction *resetMetricsAction = new QAction("&Reset Performance Counters", this);
+    connect(resetMetricsAction, &QAction::triggered, [this]()
+            {
+        metrics_.reset();
+        updatePerformancePanel(); });
+    viewMenu->addAction(resetMetricsAction);
+
     // Help menu
     QMenu *helpMenu = menuBar->addMenu("&Help");
 
@@ -253,22 +401,44 @@ void CovidTestScheduler::setupStatusBar()
     statusBar()->addPermanentWidget(datetime_label_);
 }
 
+void CovidTestScheduler::setupPerformancePanel()
+{
+    // Latency percentiles and core counters, refreshed by the one-second clock while visible
+    performance_dock_ = new QDockWidget("Performance", this);
+    performance_dock_->setObjectName("performance_dock");
+    performance_view_ = new QPlainTextEdit();
+    performance_view_->setReadOnly(true);
+    performance_view_->setLineWrapMode(QPlainTextEdit::NoWrap);
+    performance_view_->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    performance_dock_->setWidget(performance_view_);
+    addDockWidget(Qt::BottomDockWidgetArea, performance_dock_);
+    performance_dock_->hide();
+    connect(performance_dock_, &QDockWidget::visibilityChanged, this, [this](bool visible)
+            {
+        if (visible)
+            updatePerformancePanel(); });
+}
+
+void CovidTestScheduler::updatePerformancePanel()
+{
+    if (!performance_dock_->isVisible())
+        return;
+    SchedulerCounters counters;
+    pipeline_.read([&](const SchedulerCore &core)
+                   { counters = core.counters(); });
+    performance_view_->setPlainText(QString::fromStdString(metrics_.report(counters)));
+}
+
 void CovidTestScheduler::addSampleSlots()
 {
-    // Add some sample slots for demonstration
+    // Add some sample slots for demonstration: 09:00-11:30 and 14:00-15:30 every half hour
     QDate today = QDate::currentDate();
-    QStringList times = {"09:00", "09:30", "10:00", "10:30", "11:00", "11:30", "14:00", "14:30", "15:00", "15:30"};
-
-    for (int day = 0; day < 3; ++day)
-    {
-        QString date = today.addDays(day).toString("yyyy-MM-dd");
-        for (const QString &time : times)
-        {
-            auto slot = std::make_shared<TimeSlot>(next_slot_id_++, time, date);
-            all_slots_.push_back(slot);
-            slotsByDate_[date].push(slot);
-        }
-    }
+    RecurringSlotSpec spec;
+    spec.first_day = daysFromCivil(today.year(), today.month(), today.day());
+    spec.last_day = spec.first_day + 2;
+    spec.windows = {{9 * 60, 12 * 60}, {14 * 60, 16 * 60}};
+    spec.interval_minutes = 30;
+    core_.addRecurringSlots(spec);
 }
 
 void CovidTestScheduler::addSlot()
@@ -282,50 +452,75 @@ void CovidTestScheduler::addSlot()
         return;
     }
 
-    // Validate date format
-    QDate qdate = QDate::fromString(date, "yyyy-MM-dd");
-    if (!qdate.isValid())
+    SchedulerResult result;
+    pipeline_.write([&](SchedulerCore &core)
+                    {
+        ScopedLatency latency(&metrics_, SchedulerOperation::Add);
+        result = core.addSlot(date.toStdString(), time.toStdString(), capacity_input_->value(), nullptr); });
+    switch (result)
     {
-        QMessageBox::warning(this, "Date Error", "Please enter date in YYYY-MM-DD format.");
+    case SchedulerResult::Ok:
+        break;
+    case SchedulerResult::InvalidDate:
+        QMessageBox::warning(this, "Date Error", schedulerResultText(result));
+        return;
+    case SchedulerResult::InvalidTime:
+        QMessageBox::warning(this, "Time Error", schedulerResultText(result));
+        return;
+    case SchedulerResult::DuplicateSlot:
+        QMessageBox::warning(this, "Duplicate Slot", schedulerResultText(result));
+        return;
+    case SchedulerResult::InvalidCapacity:
+        QMessageBox::warning(this, "Seat Error", schedulerResultText(result));
+        return;
+    default:
+        QMessageBox::warning(this, "Input Error", schedulerResultText(result));
         return;
     }
 
-    // Validate time format
-    QTime qtime = QTime::fromString(time, "hh:mm");
-    if (!qtime.isValid())
+    // Clear input fields
+    time_input_->clear();
+    date_input_->setText(QDate::currentDate().toString("yyyy-MM-dd"));
+
+    status_label_->setText(QString("Added slot: %1 %2").arg(date, time));
+    updateAvailableSlotsCount();
+}
+
+void CovidTestScheduler::generateRecurringSlots()
+{
+    RecurringSlotsDialog dialog(this);
+    if (dialog.exec() != QDialog::Accepted)
+        return;
+
+    RecurringSlotSpec spec;
+    QString error;
+    if (!dialog.spec(&spec, &error))
     {
-        QMessageBox::warning(this, "Time Error", "Please enter time in HH:MM format.");
+        QMessageBox::warning(this, "Input Error", error);
         return;
     }
 
-    // Check if slot already exists
-    for (const auto &slot : all_slots_)
+    size_t added = 0;
+    size_t duplicates = 0;
+    SchedulerResult result;
+    pipeline_.write([&](SchedulerCore &core)
+                    {
+        ScopedLatency latency(&metrics_, SchedulerOperation::Add);
+        result = core.addRecurringSlots(spec, &added, &duplicates); });
+    if (result != SchedulerResult::Ok)
     {
-        if (slot->getDate() == date && slot->getTime() == time)
-        {
-            QMessageBox::warning(this, "Duplicate Slot", "This time slot already exists.");
-            return;
-        }
+        QMessageBox::warning(this, "Input Error", schedulerResultText(result));
+        return;
     }
 
-    // Create new slot
-    auto new_slot = std::make_shared<TimeSlot>(next_slot_id_++, time, date);
-    all_slots_.push_back(new_slot);
-    slotsByDate_[date].push(new_slot);
-
-    // Clear input fields
-    time_input_->clear();
-    date_input_->setText(QDate::currentDate().toString("yyyy-MM-dd"));
-
-    status_label_->setText(QString("Added slot: %1 %2").arg(date, time));
-    refreshDisplay();
+    status_label_->setText(QString("Generated %1 slots (%2 already existed)").arg(added).arg(duplicates));
+    updateAvailableSlotsCount();
 }
 
 void CovidTestScheduler::bookSlot()
 {
     QString patient_name = patient_name_input_->text().trimmed();
     int patient_age = patient_age_input_->value();
-    QString selected_date = date_select_edit_->date().toString("yyyy-MM-dd");
 
     if (patient_name.isEmpty())
     {
@@ -333,10 +528,37 @@ void CovidTestScheduler::bookSlot()
         return;
     }
 
-    if (slotsByDate_.count(selected_date) == 0 || slotsByDate_[selected_date].empty())
+    size_t available = 0;
+    pipeline_.read([&](const SchedulerCore &core)
+                   { available = core.availableCount(selectedDay()); });
+    if (available == 0)
     {
-        QMessageBox::information(this, "No Slots Available",
-                                 "Sorry, no time slots are currently available for the selected date.");
+        // Keep the demand: a cancellation in the coming week books the patient automatically
+        int64_t first_day = selectedDay();
+        int64_t last_day = first_day + 6;
+        QString question = QString("Sorry, no time slots are currently available for the selected date.\n\n"
+                                   "Add %1 to the waitlist for %2 to %3? A cancelled seat on those dates "
+                                   "is booked for them automatically.")
+                               .arg(patient_name)
+                               .arg(QString::fromStdString(formatSlotDate(first_day)))
+                               .arg(QString::fromStdString(formatSlotDate(last_day)));
+        if (QMessageBox::question(this, "No Slots Available", question) != QMessageBox::Yes)
+            return;
+
+        SchedulerResult result = SchedulerResult::Ok;
+        int waitlist_id = 0;
+        pipeline_.write([&](SchedulerCore &core)
+                        { result = core.addToWaitlist(patient_name.toStdString(), patient_age, first_day, last_day, 0,
+                                                      &waitlist_id); });
+        if (result != SchedulerResult::Ok)
+        {
+            QMessageBox::warning(this, "Waitlist Error", schedulerResultText(result));
+            return;
+        }
+        patient_name_input_->clear();
+        patient_age_input_->setValue(25);
+        status_label_->setText(QString("%1 added to the waitlist (#%2)").arg(patient_name).arg(waitlist_id));
+        updateAvailableSlotsCount();
         return;
     }
 
@@ -354,70 +576,76 @@ void CovidTestScheduler::bookSlot()
         QMessageBox::warning(this, "Selection Error", "Invalid slot selection.");
         return;
     }
-    int selected_slot_id = slot_id_var.toInt();
 
-    // Find the slot in the heap for the selected date
-    std::vector<std::shared_ptr<TimeSlot>> temp_slots;
-    std::shared_ptr<TimeSlot> selected_slot = nullptr;
-    while (!slotsByDate_[selected_date].empty())
-    {
-        auto slot = slotsByDate_[selected_date].top();
-        slotsByDate_[selected_date].pop();
-        if (slot->getId() == selected_slot_id && !slot->isBooked())
-        {
-            selected_slot = slot;
-            // Do not push back, this is the one to book
-        }
-        else
-        {
-            temp_slots.push_back(slot);
-        }
-    }
-    // Push the rest back into the heap
-    for (auto &slot : temp_slots)
-    {
-        slotsByDate_[selected_date].push(slot);
-    }
+    // The worker confirms through showOutcomes, so the desk can take the next patient right away
+    pipeline_.submitBooking(slot_id_var.toInt(), patient_name.toStdString(), patient_age);
+
+    // Clear input fields
+    patient_name_input_->clear();
+    patient_age_input_->setValue(25);
+    status_label_->setText(QString("Booking queued for %1").arg(patient_name));
+}
 
-    if (!selected_slot)
+void CovidTestScheduler::bookNextAvailable()
+{
+    QString patient_name = patient_name_input_->text().trimmed();
+    if (patient_name.isEmpty())
     {
-        QMessageBox::warning(this, "Slot Error", "The selected slot is no longer available.");
-        refreshDisplay();
+        QMessageBox::warning(this, "Input Error", "Please enter patient name.");
         return;
     }
 
-    // Mark slot as booked
-    selected_slot->setBooked(true);
-
-    // Create patient booking
-    auto patient = std::make_shared<Patient>(patient_name, patient_age, selected_slot);
-    patient_bookings_.push_back(patient);
+    // Walk-ins take whatever opens first from now, regardless of the selected date
+    QDateTime now = QDateTime::currentDateTime();
+    int64_t after_key = makeStartKey(daysFromCivil(now.date().year(), now.date().month(), now.date().day()),
+                                     now.time().hour() * 60 + now.time().minute());
+    pipeline_.submitNextAvailable(after_key, patient_name.toStdString(), patient_age_input_->value());
 
-    // Clear input fields
     patient_name_input_->clear();
     patient_age_input_->setValue(25);
+    status_label_->setText(QString("Next available slot requested for %1").arg(patient_name));
+}
 
-    status_label_->setText(QString("Booked slot for %1 on %2 at %3")
-                               .arg(patient_name)
-                               .arg(selected_slot->getDate())
-                               .arg(selected_slot->getTime()));
-
-    QMessageBox::information(this, "Booking Confirmed",
-                             QString("Appointment booked for %1\n"
-                                     "Date: %2\n"
-                                     "Time: %3\n"
-                                     "Slot ID: %4")
-                                 .arg(patient_name)
-                                 .arg(selected_slot->getDate())
-                                 .arg(selected_slot->getTime())
-                                 .arg(selected_slot->getId()));
-
-    refreshDisplay();
+void CovidTestScheduler::showOutcomes(const std::vector<BookingOutcome> &outcomes)
+{
+    for (const BookingOutcome &outcome : outcomes)
+    {
+        QString name = QString::fromStdString(outcome.patient_name);
+        QString when = QString("%1 %2 lane %3")
+                           .arg(QString::fromStdString(formatSlotDate(dayOfKey(outcome.start_key))))
+                           .arg(QString::fromStdString(formatSlotTime(minuteOfKey(outcome.start_key))))
+                           .arg(outcome.lane);
+        QString line;
+        if (outcome.result != SchedulerResult::Ok)
+            line = QString("FAILED %1 for %2: %3")
+                       .arg(outcome.kind == BookingOutcome::Cancel ? "cancellation" : "booking")
+                       .arg(name.isEmpty() ? QString("#%1").arg(outcome.booking_id) : name)
+                       .arg(schedulerResultText(outcome.result));
+        else if (outcome.kind == BookingOutcome::Cancel)
+        {
+            line = QString("Cancelled #%1 for %2 (%3)").arg(outcome.booking_id).arg(name).arg(when);
+            if (outcome.reassigned_booking_id)
+                line += QString("; seat given to waitlisted %1 as #%2")
+                            .arg(QString::fromStdString(outcome.reassigned_name))
+                            .arg(outcome.reassigned_booking_id);
+        }
+        else
+            line = QString("Booked #%1 for %2: %3, slot %4").arg(outcome.booking_id).arg(name).arg(when).arg(outcome.slot_id);
+        confirmation_feed_->appendPlainText(line);
+    }
+    status_label_->setText(confirmation_feed_->document()->lastBlock().text());
+    updateAvailableSlotsCount();
+    // A filtered table skips new bookings, so the search runs again over the updated index
+    if (bookings_model_->isFiltered())
+        filterBookings();
 }
 
 void CovidTestScheduler::viewBookings()
 {
-    if (patient_bookings_.empty())
+    bool empty = true;
+    pipeline_.read([&](const SchedulerCore &core)
+                   { empty = core.bookings().empty(); });
+    if (empty)
     {
         QMessageBox::information(this, "No Bookings", "No patient bookings found.");
         return;
@@ -429,26 +657,46 @@ void CovidTestScheduler::viewBookings()
 
 void CovidTestScheduler::cancelSlot()
 {
-    if (patient_bookings_.empty())
+    // A booking picked in the table, for instance after a search, is cancelled without the full list
+    QModelIndexList selected_rows = bookings_table_->selectionModel()->selectedRows();
+    if (!selected_rows.isEmpty())
     {
-        QMessageBox::information(this, "No Bookings", "No bookings to cancel.");
+        // selectedRows() gives each row's first column, the patient name
+        int booking_id = bookings_model_->data(selected_rows.first(), Qt::UserRole).toInt();
+        QString name = bookings_model_->data(selected_rows.first()).toString();
+        if (QMessageBox::question(this, "Cancel Booking", QString("Cancel booking #%1 for %2?").arg(booking_id).arg(name)) ==
+            QMessageBox::Yes)
+        {
+            pipeline_.submitCancel(booking_id);
+            status_label_->setText(QString("Cancellation queued for booking #%1").arg(booking_id));
+        }
         return;
     }
 
     // Get list of booked slots for selection
     QStringList booking_list;
-    for (size_t i = 0; i < patient_bookings_.size(); ++i)
-    {
-        auto patient = patient_bookings_[i];
-        auto slot = patient->getAssignedSlot();
-        if (slot)
+    std::vector<int> booking_ids;
+    pipeline_.read([&](const SchedulerCore &core)
+                   {
+        for (const Patient &patient : core.bookings())
         {
-            booking_list << QString("%1 - %2 (%3 %4)")
-                                .arg(patient->getName())
-                                .arg(patient->getAge())
-                                .arg(slot->getDate())
-                                .arg(slot->getTime());
-        }
+            auto slot = core.findSlot(patient.getSlotId());
+            if (slot)
+            {
+                // The booking id keeps identical-looking entries distinguishable
+                booking_list << QString("#%1 %2 - %3 (%4 %5)")
+                                    .arg(patient.getBookingId())
+                                    .arg(QString::fromStdString(patient.getName()))
+                                    .arg(patient.getAge())
+                                    .arg(QString::fromStdString(slot->getDate()))
+                                    .arg(QString::fromStdString(slot->getTime()));
+                booking_ids.push_back(patient.getBookingId());
+            }
+        } });
+    if (booking_ids.empty())
+    {
+        QMessageBox::information(this, "No Bookings", "No bookings to cancel.");
+        return;
     }
 
     bool ok;
@@ -459,27 +707,10 @@ void CovidTestScheduler::cancelSlot()
     if (ok && !selected.isEmpty())
     {
         int index = booking_list.indexOf(selected);
-        if (index >= 0 && index < static_cast<int>(patient_bookings_.size()))
+        if (index >= 0 && index < static_cast<int>(booking_ids.size()))
         {
-            auto patient = patient_bookings_[index];
-
-            // Find and unbook the slot
-            auto slot = patient->getAssignedSlot();
-            if (slot)
-            {
-                slot->setBooked(false);
-                slotsByDate_[slot->getDate()].push(slot);
-
-                status_label_->setText(QString("Cancelled booking for %1").arg(patient->getName()));
-
-                // Remove patient from bookings
-                patient_bookings_.erase(patient_bookings_.begin() + index);
-
-                QMessageBox::information(this, "Booking Cancelled",
-                                         QString("Booking cancelled for %1").arg(patient->getName()));
-
-                refreshDisplay();
-            }
+            pipeline_.submitCancel(booking_ids[index]);
+            status_label_->setText(QString("Cancellation queued for booking #%1").arg(booking_ids[index]));
         }
     }
 }
@@ -492,63 +723,284 @@ void CovidTestScheduler::refreshDisplay()
 
 void CovidTestScheduler::updateAvailableSlotsForSelectedDate()
 {
-    available_slots_list_->clear();
-    available_slots_combo_->clear();
-    QString selected_date = date_select_edit_->date().toString("yyyy-MM-dd");
-    int available_count = 0;
-    if (slotsByDate_.count(selected_date) && !slotsByDate_[selected_date].empty())
+    int64_t day = selectedDay();
     {
-        // Create a copy of the priority queue to display all available slots for the selected date
-        auto temp_queue = slotsByDate_[selected_date];
-        int position = 1;
-        while (!temp_queue.empty())
+        ScopedLatency latency(&metrics_, SchedulerOperation::Refresh);
+        slots_model_->setDay(day);
+        available_slots_combo_->setCurrentIndex(0);
+    }
+    updateAvailableSlotsCount();
+}
+
+void CovidTestScheduler::updateAvailableSlotsCount()
+{
+    // The models follow SchedulerCore events; only the count label is recomputed, over the day's open slots
+    size_t available = 0;
+    size_t seats = 0;
+    size_t waiting = 0;
+    size_t week = 0;
+    pipeline_.read([&](const SchedulerCore &core)
+                   {
+        available = core.availableCount(slots_model_->day());
+        week = core.availableCount(slots_model_->day(), slots_model_->day() + 6);
+        seats = core.availableSeats(slots_model_->day());
+        waiting = core.waitlist().size(); });
+    QString text = QString("Available Slots: %1 (%2 seats), %3 over 7 days").arg(available).arg(seats).arg(week);
+    if (waiting > 0)
+        text += QString(" | %1 waitlisted").arg(waiting);
+    available_slots_count_label_->setText(text);
+
+    AvailabilityTotals week_totals;
+    AvailabilityTotals month_totals;
+    pipeline_.read([&](const SchedulerCore &core)
+                   {
+        week_totals = core.aggregates().week(AvailabilityAggregates::weekOf(slots_model_->day()));
+        month_totals = core.aggregates().month(AvailabilityAggregates::monthOf(slots_model_->day())); });
+    period_totals_label_->setText(QString("Week: %1 of %2 slots open, %3 seats booked | Month: %4 of %5 slots open, %6 seats booked")
+                                      .arg(week_totals.open_slots)
+                                      .arg(week_totals.slots)
+                                      .arg(week_totals.booked_seats)
+                                      .arg(month_totals.open_slots)
+                                      .arg(month_totals.slots)
+                                      .arg(month_totals.booked_seats));
+    if (!heatmap_timer_->isActive())
+        heatmap_timer_->start();
+}
+
+void CovidTestScheduler::updateCalendarHeatmap()
+{
+    QCalendarWidget *calendar = date_select_edit_->calendarWidget();
+    if (!calendar)
+        return;
+
+    // The month grid shows up to six weeks around the page's month; one counter lookup per date
+    QDate first_shown = QDate(calendar->yearShown(), calendar->monthShown(), 1).addDays(-7);
+    int64_t first_day = daysFromCivil(first_shown.year(), first_shown.month(), first_shown.day());
+    const int kShownDays = 7 * 8;
+    std::vector<AvailabilityTotals> totals(kShownDays);
+    pipeline_.read([&](const SchedulerCore &core)
+                   {
+        for (int i = 0; i < kShownDays; ++i)
+            totals[i] = core.aggregates().day(first_day + i); });
+
+    for (int i = 0; i < kShownDays; ++i)
+    {
+        QTextCharFormat format;
+        const AvailabilityTotals &day = totals[i];
+        if (day.slots > 0)
         {
-            auto slot = temp_queue.top();
-            temp_queue.pop();
-            QString item_text = QString("%1. %2 %3 (ID: %4)")
-                                    .arg(position++)
-                                    .arg(slot->getDate())
-                                    .arg(slot->getTime())
-                                    .arg(slot->getId());
-            available_slots_list_->addItem(item_text);
-            available_slots_combo_->addItem(
-                QString("%1 %2 (ID: %3)").arg(slot->getDate()).arg(slot->getTime()).arg(slot->getId()),
-                slot->getId());
-            ++available_count;
+            // Red when fully booked, amber under a quarter open, green otherwise
+            if (day.open_slots == 0)
+                format.setBackground(QColor("#FFCDD2"));
+            else if (day.open_slots * 4 < day.slots)
+                format.setBackground(QColor("#FFE0B2"));
+            else
+                format.setBackground(QColor("#C8E6C9"));
+            format.setToolTip(QString("%1 of %2 slots open, %3 of %4 seats booked")
+                                  .arg(day.open_slots)
+                                  .arg(day.slots)
+                                  .arg(day.booked_seats)
+                                  .arg(day.seats));
         }
+        calendar->setDateTextFormat(first_shown.addDays(i), format);
     }
+}
+
+void CovidTestScheduler::updateBookingsTable()
+{
+    // Columns and headers come from the model; the view only pulls visible rows
+    if (booking_search_input_->text().trimmed().isEmpty())
+        bookings_model_->reload();
     else
+        filterBookings();
+}
+
+void CovidTestScheduler::filterBookings()
+{
+    const size_t kMaxSearchResults = 200;
+    QString query = booking_search_input_->text().trimmed();
+    if (query.isEmpty())
     {
-        available_slots_list_->addItem("No available slots");
-        available_slots_combo_->addItem("No slots available");
+        bookings_group_->setTitle("Patient Bookings");
+        bookings_model_->reload();
+        return;
     }
-    available_slots_count_label_->setText(QString("Available Slots: %1").arg(available_count));
+
+    std::vector<int> booking_ids;
+    {
+        ScopedLatency latency(&metrics_, SchedulerOperation::Search);
+        booking_ids = search_index_.search(query.toStdString(), kMaxSearchResults);
+    }
+    bookings_group_->setTitle(QString("Patient Bookings - %1%2 matching")
+                                  .arg(booking_ids.size())
+                                  .arg(booking_ids.size() == kMaxSearchResults ? "+" : ""));
+    bookings_model_->setFilter(std::move(booking_ids));
 }
 
-void CovidTestScheduler::updateBookingsTable()
+void CovidTestScheduler::importSlotsCsv()
 {
-    // Update table to show: Patient Name, Age, Slot Date, Slot Time
-    bookings_table_->setColumnCount(4);
-    QStringList headers;
-    headers << "Patient Name" << "Age" << "Slot Date" << "Slot Time";
-    bookings_table_->setHorizontalHeaderLabels(headers);
-    bookings_table_->setRowCount(static_cast<int>(patient_bookings_.size()));
-
-    for (size_t i = 0; i < patient_bookings_.size(); ++i)
+    QString path = QFileDialog::getOpenFileName(this, "Import Slots", QString(), "CSV files (*.csv);;All files (*)");
+    if (path.isEmpty())
+        return;
+
+    CsvImportStats stats;
+    std::string error;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    // Reading and parsing run unlocked; only each chunk's insert holds the core, so queued
+    // bookings and readers get in between chunks. 1 MB chunks keep each hold to about 15 ms.
+    CsvImportOptions options;
+    options.chunk_bytes = 1 << 20;
+    bool ok = readSlotsCsv(
+        path.toStdString(), [this](std::vector<SlotKey> slots, size_t *added, size_t *duplicates)
+        {
+            SchedulerResult result = SchedulerResult::Ok;
+            pipeline_.write([&](SchedulerCore &core)
+                            {
+                ScopedLatency latency(&metrics_, SchedulerOperation::Import);
+                result = core.addSlots(std::move(slots), added, duplicates); });
+            // Each chunk is synced before the next, so a storage failure stops the import at once
+            if (result == SchedulerResult::Ok && !pipeline_.commitWrites())
+                result = SchedulerResult::StorageFailed;
+            return result; },
+        &stats, &error, options);
+    QApplication::restoreOverrideCursor();
+    if (!ok)
     {
-        auto patient = patient_bookings_[i];
-        auto slot = patient->getAssignedSlot();
-        bookings_table_->setItem(i, 0, new QTableWidgetItem(patient->getName()));
-        bookings_table_->setItem(i, 1, new QTableWidgetItem(QString::number(patient->getAge())));
-        bookings_table_->setItem(i, 2, new QTableWidgetItem(slot ? slot->getDate() : ""));
-        bookings_table_->setItem(i, 3, new QTableWidgetItem(slot ? slot->getTime() : ""));
+        QMessageBox::warning(this, "Import Error", QString::fromStdString(error));
+        return;
+    }
+
+    QString message = QString("Imported %1 of %2 rows (%3 duplicates").arg(stats.added).arg(stats.rows).arg(stats.duplicates);
+    if (stats.rejected > 0)
+        message += QString(", %1 invalid, first on line %2").arg(stats.rejected).arg(stats.first_rejected_line);
+    status_label_->setText(message + ")");
+    updateAvailableSlotsCount();
+}
+
+void CovidTestScheduler::exportBookingsCsv()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export Bookings", "bookings.csv", "CSV files (*.csv)");
+    if (path.isEmpty())
+        return;
+
+    size_t rows = 0;
+    std::string error;
+    bool ok = false;
+    pipeline_.read([&](const SchedulerCore &core)
+                   { ok = ::exportBookingsCsv(path.toStdString(), core, &rows, &error); });
+    if (!ok)
+    {
+        QMessageBox::warning(this, "Export Error", QString::fromStdString(error));
+        return;
+    }
+    status_label_->setText(QString("Exported %1 bookings to %2").arg(rows).arg(path));
+}
+
+void CovidTestScheduler::exportCalendarImage()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Export Calendar Image", "calendar.img",
+                                                "Schedule images (*.img)");
+    if (path.isEmpty())
+        return;
+
+    std::vector<ScheduleImage::SlotRecord> records;
+    pipeline_.read([&](const SchedulerCore &core)
+                   {
+        records.reserve(core.slotCount());
+        for (size_t id = 1; id <= core.slotCount(); ++id)
+        {
+            auto slot = core.findSlot(static_cast<int>(id));
+            records.push_back({slot->getStartKey(), static_cast<uint32_t>(slot->getLane()),
+                               static_cast<uint32_t>(slot->getCapacity())});
+        } });
+
+    std::string error;
+    if (!ScheduleImage::write(path.toStdString(), records, &error))
+    {
+        QMessageBox::warning(this, "Export Error", QString::fromStdString(error));
+        return;
     }
+    status_label_->setText(QString("Exported %1 slots to %2; install it as calendar.img in %3 with an empty journal")
+                               .arg(records.size())
+                               .arg(path)
+                               .arg(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)));
+}
+
+void CovidTestScheduler::dumpMetrics()
+{
+    QString path = QFileDialog::getSaveFileName(this, "Dump Metrics", "scheduler-metrics.txt", "Text files (*.txt)");
+    if (path.isEmpty())
+        return;
+
+    SchedulerCounters counters;
+    pipeline_.read([&](const SchedulerCore &core)
+                   { counters = core.counters(); });
+    std::string error;
+    if (!metrics_.dump(path.toStdString(), counters, &error))
+    {
+        QMessageBox::warning(this, "Export Error", QString::fromStdString(error));
+        return;
+    }
+    status_label_->setText(QString("Wrote metrics to %1").arg(path));
+}
+
+int64_t CovidTestScheduler::selectedDay() const
+{
+    QDate date = date_select_edit_->date();
+    return daysFromCivil(date.year(), date.month(), date.day());
 }
 
 void CovidTestScheduler::updateDateTime()
 {
     QString current_datetime = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
     datetime_label_->setText(current_datetime);
+    pruneExpired();
+    updatePerformancePanel();
+}
+
+void CovidTestScheduler::pruneExpired()
+{
+    // Without the archive, pruning would drop past bookings for good
+    if (!archive_.isOpen())
+        return;
+
+    // Yesterday stays live so late cancellations still work; each tick spends a few milliseconds
+    // at most, in short writes, so bookings queued on the pipeline are never held up for long
+    const int64_t kRetainedPastDays = 1;
+    const size_t kPruneBudget = 256;
+    const qint64 kPruneTimeMs = 2;
+    QDate today = QDate::currentDate();
+    int64_t floor = daysFromCivil(today.year(), today.month(), today.day()) - kRetainedPastDays;
+    // Once a floor is swept, the ticks until the date changes need no lock at all
+    if (floor == swept_floor_)
+        return;
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+    bool more = true;
+    while (more && elapsed.elapsed() < kPruneTimeMs)
+    {
+        pipeline_.write([&](SchedulerCore &core)
+                        {
+            ScopedLatency latency(&metrics_, SchedulerOperation::Prune);
+            bool raised = core.retentionFloor() < floor;
+            core.setRetentionFloor(floor);
+            size_t spent = 0;
+            more = core.pruneStep(kPruneBudget, nullptr, &spent);
+            // A step that changed nothing neither needs replaying nor says anything about latency
+            if (raised || spent > 0)
+                trace_.recordPrune(floor, kPruneBudget);
+            else
+                latency.discard(); });
+        if (archive_.appendFailed())
+        {
+            // The booking stays live; the next tick tries again
+            status_label_->setText("Booking archive write failed, past bookings are kept for now");
+            return;
+        }
+    }
+    if (!more)
+        swept_floor_ = floor;
 }
 
 #include "covid_test_scheduler.moc"
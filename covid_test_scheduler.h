@@ -11,87 +11,29 @@
 #include <QtWidgets/QLabel>
 #include <QtWidgets/QLineEdit>
 #include <QtWidgets/QTextEdit>
+#include <QtWidgets/QPlainTextEdit>
 #include <QtWidgets/QSpinBox>
 #include <QtWidgets/QMessageBox>
-#include <QtWidgets/QListWidget>
+#include <QtWidgets/QListView>
 #include <QtWidgets/QGroupBox>
 #include <QtWidgets/QComboBox>
-#include <QtWidgets/QTableWidget>
-#include <QtWidgets/QTableWidgetItem>
+#include <QtWidgets/QTableView>
 #include <QtWidgets/QHeaderView>
 #include <QtCore/QTimer>
 #include <QtCore/QDateTime>
-#include <queue>
-#include <vector>
-#include <string>
-#include <memory>
-#include <map>
 #include <QtWidgets/QDateEdit>
-
-// Forward declarations
-class TimeSlot;
-class Patient;
-class CovidTestScheduler;
-
-/**
- * @brief TimeSlot class represents a Covid test appointment slot
- */
-class TimeSlot
-{
-public:
-    TimeSlot(int id, const QString &time, const QString &date);
-
-    int getId() const { return id_; }
-    QString getTime() const { return time_; }
-    QString getDate() const { return date_; }
-    QString getDateTime() const { return date_ + " " + time_; }
-    bool isBooked() const { return is_booked_; }
-
-    void setBooked(bool booked) { is_booked_ = booked; }
-
-    // Comparison operators for min-heap (earlier time has higher priority)
-    bool operator>(const TimeSlot &other) const;
-    bool operator<(const TimeSlot &other) const;
-    bool operator==(const TimeSlot &other) const;
-
-private:
-    int id_;
-    QString time_;
-    QString date_;
-    bool is_booked_;
-};
-
-/**
- * @brief Patient class represents a patient booking
- */
-class Patient
-{
-public:
-    Patient(const QString &name, int age, std::shared_ptr<TimeSlot> assignedSlot);
-
-    QString getName() const { return name_; }
-    int getAge() const { return age_; }
-    std::shared_ptr<TimeSlot> getAssignedSlot() const { return assigned_slot_; }
-    QString getBookingTime() const { return booking_time_; }
-
-private:
-    QString name_;
-    int age_;
-    std::shared_ptr<TimeSlot> assigned_slot_;
-    QString booking_time_;
-};
-
-/**
- * @brief Custom comparator for min-heap of TimeSlot objects
- */
-class TimeSlotComparator
-{
-public:
-    bool operator()(const std::shared_ptr<TimeSlot> &a, const std::shared_ptr<TimeSlot> &b)
-    {
-        return *a > *b; // Min-heap: smaller element has higher priority
-    }
-};
+#include <QtWidgets/QDockWidget>
+#include "scheduler_core.h"
+#include "scheduler_models.h"
+#include "scheduler_journal.h"
+#include "schedule_image.h"
+#include "scheduler_csv.h"
+#include "booking_pipeline.h"
+#include "booking_server.h"
+#include "scheduler_metrics.h"
+#include "booking_archive.h"
+#include "patient_search.h"
+#include "scheduler_trace.h"
 
 /**
  * @brief Main application class for Covid Test Center Scheduler
@@ -104,23 +46,41 @@ public:
     CovidTestScheduler(QWidget *parent = nullptr);
     ~CovidTestScheduler();
     void addSampleSlots();
+    // Serves the kiosk protocol (see booking_protocol.h); an empty name or port 0 skips that transport
+    bool startServer(const QString &local_name, quint16 tcp_port, QString *error = nullptr);
+    // Records every later add, booking and cancellation to path for scheduler_replay
+    bool startTrace(const QString &path, QString *error = nullptr);
 
 private slots:
     void addSlot();
+    void generateRecurringSlots();
+    void importSlotsCsv();
+    void exportBookingsCsv();
+    void exportCalendarImage();
+    void dumpMetrics();
     void bookSlot();
+    void bookNextAvailable();
     void viewBookings();
     void cancelSlot();
+    void filterBookings();
     void refreshDisplay();
+    void updateAvailableSlotsForSelectedDate(); // NEW: update available slots for selected date
     void updateDateTime();
+    void showOutcomes(const std::vector<BookingOutcome> &outcomes);
 
 private:
+    QString restoreSchedule();
     void setupUI();
     void setupMenuBar();
     void setupStatusBar();
+    void setupPerformancePanel();
+    void updatePerformancePanel();
     void updateAvailableSlots();
     void updateBookingsTable();
     void showAvailableSlots();
-    void updateAvailableSlotsForSelectedDate(); // NEW: update available slots for selected date
+    void updateAvailableSlotsCount();
+    void updateCalendarHeatmap();
+    void pruneExpired();
 
     // UI Components
     QWidget *central_widget_;
@@ -130,7 +90,9 @@ private:
 
     // Control buttons
     QPushButton *add_slot_button_;
+    QPushButton *generate_slots_button_;
     QPushButton *book_slot_button_;
+    QPushButton *book_next_button_;
     QPushButton *view_bookings_button_;
     QPushButton *cancel_slot_button_;
     QPushButton *refresh_button_;
@@ -139,6 +101,7 @@ private:
     QGroupBox *add_slot_group_;
     QLineEdit *time_input_;
     QLineEdit *date_input_;
+    QSpinBox *capacity_input_;
     QDateEdit *date_select_edit_; // NEW: for user to select date
 
     QGroupBox *book_patient_group_;
@@ -148,24 +111,38 @@ private:
 
     // Display areas
     QGroupBox *slots_group_;
-    QListWidget *available_slots_list_;
+    QListView *available_slots_list_;
+    AvailableSlotsModel *slots_model_;
 
     QGroupBox *bookings_group_;
-    QTableWidget *bookings_table_;
+    QLineEdit *booking_search_input_;
+    QTableView *bookings_table_;
+    BookingsTableModel *bookings_model_;
+    QPlainTextEdit *confirmation_feed_;
+    QDockWidget *performance_dock_;
+    QPlainTextEdit *performance_view_;
 
     // Status and info
     QLabel *status_label_;
     QLabel *datetime_label_;
     QLabel *available_slots_count_label_; // NEW: show number of available slots
+    QLabel *period_totals_label_;         // week and month totals for the selected date
     QTimer *datetime_timer_;
-
-    // Data structures
-    // Remove single heap, use map of heaps by date
-    std::map<QString, std::priority_queue<std::shared_ptr<TimeSlot>, std::vector<std::shared_ptr<TimeSlot>>, TimeSlotComparator>> slotsByDate_;
-    std::vector<std::shared_ptr<Patient>> patient_bookings_;
-    std::vector<std::shared_ptr<TimeSlot>> all_slots_;
-
-    int next_slot_id_;
+    QTimer *heatmap_timer_; // coalesces calendar heatmap repaints after outcomes
+    BookingServer *server_;
+    int64_t swept_floor_; // retention floor whose prune sweep has finished
+
+    int64_t selectedDay() const;
+
+    // Scheduling engine; the window only translates input and results
+    ScheduleImage image_; // mapped base calendar; must outlive core_
+    SchedulerCore core_;
+    BookingArchive archive_;   // listens to core_ ahead of the journal; see restoreSchedule
+    SchedulerJournal journal_; // declared after core_ so it detaches before the core is destroyed
+    SchedulerMetrics metrics_; // written by the pipeline's worker, so declared before it
+    SchedulerTrace trace_;     // likewise; closed until startTrace
+    BookingPipeline pipeline_; // sole writer once started; see BookingPipeline::read/write
+    PatientSearchIndex search_index_; // fed with the views' events, so only touched on the GUI thread
 };
 
 #endif // COVID_TEST_SCHEDULER_H
@@ -0,0 +1,210 @@
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#include <cstddef>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Default id -> heap position map for IndexedHeap
+ */
+template <typename Id>
+class HashPositionMap
+{
+public:
+    bool contains(const Id &id) const { return positions_.count(id) != 0; }
+    size_t get(const Id &id) const { return positions_.find(id)->second; }
+    void set(const Id &id, size_t position) { positions_[id] = position; }
+    void erase(const Id &id) { positions_.erase(id); }
+    void reserve(size_t count) { positions_.reserve(count); }
+
+private:
+    std::unordered_map<Id, size_t> positions_;
+};
+
+/**
+ * @brief Addressable d-ary heap with an id -> position map
+ *
+ * Follows std::priority_queue conventions: Compare(a, b) returns true when a
+ * has lower priority than b, so a "greater" comparator yields a min-heap. IdOf
+ * extracts the unique id of an element. Besides push/top/pop it supports
+ * contains(id), erase(id) and update(id) (re-sift after a key change, covering
+ * decrease-key) in O(log n). PositionMap may be replaced by a dense array when
+ * ids are small integers shared by several heaps.
+ */
+template <typename T, typename Compare, typename IdOf, unsigned Arity = 4,
+          typename PositionMap = HashPositionMap<typename std::decay<decltype(IdOf()(std::declval<const T &>()))>::type>>
+class IndexedHeap
+{
+    static_assert(Arity >= 2, "IndexedHeap needs at least two children per node");
+
+public:
+    using Id = typename std::decay<decltype(IdOf()(std::declval<const T &>()))>::type;
+
+    explicit IndexedHeap(PositionMap positions = PositionMap(), Compare compare = Compare())
+        : positions_(std::move(positions)), compare_(std::move(compare)) {}
+
+    bool empty() const { return items_.empty(); }
+    size_t size() const { return items_.size(); }
+    const T &top() const { return items_.front(); }
+
+    // Elements in heap order (not sorted); valid until the next mutation
+    const std::vector<T> &items() const { return items_; }
+
+    bool contains(const Id &id) const { return positions_.contains(id); }
+
+    // Inserts item unless an element with the same id is already present
+    bool push(const T &item)
+    {
+        Id id = IdOf()(item);
+        if (contains(id))
+            return false;
+        items_.push_back(item);
+        positions_.set(id, items_.size() - 1);
+        siftUp(items_.size() - 1);
+        return true;
+    }
+
+    // Appends every item whose id is not yet present and restores heap order.
+    // Large batches use one bottom-up heapify (O(n)) instead of per-item sifts.
+    template <typename InputIt>
+    size_t pushRange(InputIt first, InputIt last)
+    {
+        size_t old_size = items_.size();
+        for (; first != last; ++first)
+        {
+            Id id = IdOf()(*first);
+            if (contains(id))
+                continue;
+            positions_.set(id, items_.size());
+            items_.push_back(*first);
+        }
+        size_t added = items_.size() - old_size;
+        if (added >= old_size)
+        {
+            heapify();
+        }
+        else
+        {
+            for (size_t position = old_size; position < items_.size(); ++position)
+                siftUp(position);
+        }
+        return added;
+    }
+
+    void reserve(size_t count)
+    {
+        items_.reserve(count);
+        positions_.reserve(count);
+    }
+
+    void pop()
+    {
+        removeAt(0);
+    }
+
+    bool erase(const Id &id)
+    {
+        if (!contains(id))
+            return false;
+        removeAt(positions_.get(id));
+        return true;
+    }
+
+    // Restores heap order after the key of element id changed
+    bool update(const Id &id)
+    {
+        if (!contains(id))
+            return false;
+        siftUp(positions_.get(id));
+        siftDown(positions_.get(id));
+        return true;
+    }
+
+    void clear()
+    {
+        for (const T &item : items_)
+            positions_.erase(IdOf()(item));
+        items_.clear();
+    }
+
+private:
+    void heapify()
+    {
+        if (items_.size() < 2)
+            return;
+        for (size_t position = (items_.size() - 2) / Arity + 1; position-- > 0;)
+            siftDown(position);
+    }
+
+    void removeAt(size_t position)
+    {
+        positions_.erase(IdOf()(items_[position]));
+        size_t last = items_.size() - 1;
+        if (position != last)
+        {
+            items_[position] = std::move(items_[last]);
+            positions_.set(IdOf()(items_[position]), position);
+            items_.pop_back();
+            siftUp(position);
+            siftDown(position);
+        }
+        else
+        {
+            items_.pop_back();
+        }
+    }
+
+    void siftUp(size_t position)
+    {
+        T item = std::move(items_[position]);
+        while (position > 0)
+        {
+            size_t parent = (position - 1) / Arity;
+            if (!compare_(items_[parent], item))
+                break;
+            place(position, std::move(items_[parent]));
+            position = parent;
+        }
+        place(position, std::move(item));
+    }
+
+    void siftDown(size_t position)
+    {
+        if (position >= items_.size())
+            return;
+        T item = std::move(items_[position]);
+        for (;;)
+        {
+            size_t first_child = position * Arity + 1;
+            if (first_child >= items_.size())
+                break;
+            size_t best = first_child;
+            size_t end = first_child + Arity < items_.size() ? first_child + Arity : items_.size();
+            for (size_t child = first_child + 1; child < end; ++child)
+            {
+                if (compare_(items_[best], items_[child]))
+                    best = child;
+            }
+            if (!compare_(item, items_[best]))
+                break;
+            place(position, std::move(items_[best]));
+            position = best;
+        }
+        place(position, std::move(item));
+    }
+
+    void place(size_t position, T &&item)
+    {
+        items_[position] = std::move(item);
+        positions_.set(IdOf()(items_[position]), position);
+    }
+
+    std::vector<T> items_;
+    PositionMap positions_;
+    Compare compare_;
+};
+
+#endif // INDEXED_HEAP_H
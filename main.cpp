@@ -6,6 +6,7 @@
 #include <QPixmap>
 #include <QPalette>
 #include <QDebug>
+#include <QCommandLineParser>
 #include "covid_test_scheduler.h"
 
 int main(int argc, char *argv[])
@@ -44,10 +45,35 @@ int main(int argc, char *argv[])
     // Comment out the next line if you prefer light theme
     // app.setPalette(darkPalette);
 
+    // Optional kiosk endpoint, e.g. --listen-local covid-scheduler or --listen-tcp 7300, and --record-trace ops.trace
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption local_option("listen-local", "Serve the booking protocol on a local socket.", "name");
+    QCommandLineOption tcp_option("listen-tcp", "Serve the booking protocol on a loopback TCP port.", "port");
+    QCommandLineOption trace_option("record-trace", "Record adds, bookings and cancellations for scheduler_replay.", "path");
+    parser.addOption(local_option);
+    parser.addOption(tcp_option);
+    parser.addOption(trace_option);
+    parser.process(app);
+
     // Create and show the main window
     CovidTestScheduler window;
     window.show();
 
+    if (parser.isSet(local_option) || parser.isSet(tcp_option))
+    {
+        QString error;
+        if (!window.startServer(parser.value(local_option), parser.value(tcp_option).toUShort(), &error))
+            qWarning() << "Booking server not started:" << error;
+    }
+
+    if (parser.isSet(trace_option))
+    {
+        QString error;
+        if (!window.startTrace(parser.value(trace_option), &error))
+            qWarning() << "Trace not recorded:" << error;
+    }
+
     qDebug() << "Covid Test Center Scheduler started successfully";
     qDebug() << "Qt Version:" << QT_VERSION_STR;
     qDebug() << "Application Name:" << app.applicationName();
@@ -0,0 +1,516 @@
+#include "patient_search.h"
+#include "slot_time.h"
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_set>
+
+namespace
+{
+// ASCII folds of U+00C0..U+00FF (UTF-8 0xC3 0x80..0xBF); empty entries are word breaks
+const char *const kLatin1Folds[64] = {
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+    "d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "ss",
+    "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i",
+    "d", "n", "o", "o", "o", "o", "o", "", "o", "u", "u", "u", "u", "y", "th", "y"};
+
+const size_t kMaxFuzzyTokens = 1024;     // a short typo can sit above a large subtree
+const size_t kMaxFuzzyCandidates = 2048; // bookings checked while filling with typo matches
+const size_t kMaxFuzzyWord = 32;
+
+bool isDigits(const std::string &text)
+{
+    return !text.empty() && std::all_of(text.begin(), text.end(), [](char c)
+                                        { return c >= '0' && c <= '9'; });
+}
+} // namespace
+
+struct PatientSearchIndex::FuzzyWalk
+{
+    std::string word;
+    int max_distance;
+    // rows[depth][j]: distance of word[0, j) to the path so far; a walk ends within the word's length plus two
+    int rows[kMaxFuzzyWord + 4][kMaxFuzzyWord + 1];
+    char path[kMaxFuzzyWord + 4];
+    std::vector<std::pair<int, uint32_t>> *tokens;
+};
+
+PatientSearchIndex::PatientSearchIndex()
+{
+    clear();
+}
+
+void PatientSearchIndex::clear()
+{
+    nodes_.assign(1, TrieNode());
+    token_text_.clear();
+    token_postings_.clear();
+    bookings_.clear();
+    days_.clear();
+}
+
+void PatientSearchIndex::reload(const SchedulerCore &core)
+{
+    clear();
+    bookings_.reserve(core.bookings().size());
+    for (const Patient &booking : core.bookings())
+    {
+        std::optional<TimeSlot> slot = core.findSlot(booking.getSlotId());
+        add(booking, slot ? slot->getDay() : 0);
+    }
+}
+
+std::string PatientSearchIndex::normalize(const std::string &text)
+{
+    std::string normalized;
+    normalized.reserve(text.size());
+    auto breakWord = [&normalized]()
+    {
+        if (!normalized.empty() && normalized.back() != ' ')
+            normalized.push_back(' ');
+    };
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c >= 'A' && c <= 'Z')
+            normalized.push_back(static_cast<char>(c - 'A' + 'a'));
+        else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9'))
+            normalized.push_back(static_cast<char>(c));
+        else if (c == 0xC3 && i + 1 < text.size() && (static_cast<unsigned char>(text[i + 1]) & 0xC0) == 0x80)
+        {
+            const char *fold = kLatin1Folds[static_cast<unsigned char>(text[++i]) & 0x3F];
+            if (*fold)
+                normalized += fold;
+            else
+                breakWord();
+        }
+        else if (c >= 0x80)
+            normalized.push_back(static_cast<char>(c)); // other scripts are matched byte for byte
+        else
+            breakWord();
+    }
+    if (!normalized.empty() && normalized.back() == ' ')
+        normalized.pop_back();
+    return normalized;
+}
+
+uint32_t PatientSearchIndex::internToken(const std::string &token)
+{
+    uint32_t node = 0;
+    for (char c : token)
+    {
+        std::vector<std::pair<char, uint32_t>> &children = nodes_[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, uint32_t(0)));
+        if (it != children.end() && it->first == c)
+        {
+            node = it->second;
+            continue;
+        }
+        uint32_t child = static_cast<uint32_t>(nodes_.size());
+        children.insert(it, {c, child});
+        nodes_.emplace_back(); // invalidates children, which is not used again
+        node = child;
+    }
+    if (nodes_[node].token == kNoToken)
+    {
+        nodes_[node].token = static_cast<uint32_t>(token_text_.size());
+        token_text_.push_back(token);
+        token_postings_.emplace_back();
+    }
+    return nodes_[node].token;
+}
+
+uint32_t PatientSearchIndex::findNode(const std::string &prefix) const
+{
+    uint32_t node = 0;
+    for (char c : prefix)
+    {
+        const std::vector<std::pair<char, uint32_t>> &children = nodes_[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, uint32_t(0)));
+        if (it == children.end() || it->first != c)
+            return kNoToken;
+        node = it->second;
+    }
+    return node;
+}
+
+void PatientSearchIndex::countToken(uint32_t token, int delta)
+{
+    uint32_t node = 0;
+    nodes_[node].bookings += delta;
+    for (char c : token_text_[token])
+    {
+        const std::vector<std::pair<char, uint32_t>> &children = nodes_[node].children;
+        node = std::lower_bound(children.begin(), children.end(), std::make_pair(c, uint32_t(0)))->second;
+        nodes_[node].bookings += delta;
+    }
+}
+
+void PatientSearchIndex::add(const Patient &booking, int64_t day)
+{
+    if (bookings_.count(booking.getBookingId()))
+        return;
+
+    Posting posting;
+    posting.booking_id = booking.getBookingId();
+    posting.tokens.fill(kNoToken);
+    size_t token_count = 0;
+    std::string normalized = normalize(booking.getName());
+    size_t start = 0;
+    while (start < normalized.size() && token_count < kMaxTokensPerName)
+    {
+        size_t end = std::min(normalized.find(' ', start), normalized.size());
+        uint32_t token = internToken(normalized.substr(start, end - start));
+        start = end + 1;
+        if (std::find(posting.tokens.begin(), posting.tokens.begin() + token_count, token) !=
+            posting.tokens.begin() + token_count)
+            continue; // "Anna Anna" is listed under anna once
+        posting.tokens[token_count++] = token;
+    }
+
+    for (size_t i = 0; i < token_count; ++i)
+    {
+        countToken(posting.tokens[i], 1);
+        Postings &postings = token_postings_[posting.tokens[i]];
+        postings.entries.push_back(posting);
+        ++postings.live;
+    }
+    Postings &day_postings = days_[day];
+    day_postings.entries.push_back(posting);
+    ++day_postings.live;
+    bookings_.emplace(booking.getBookingId(), IndexedBooking{day, posting.tokens});
+}
+
+void PatientSearchIndex::remove(int booking_id)
+{
+    auto it = bookings_.find(booking_id);
+    if (it == bookings_.end())
+        return;
+    IndexedBooking indexed = it->second;
+    bookings_.erase(it);
+
+    for (size_t i = 0; i < kMaxTokensPerName && indexed.tokens[i] != kNoToken; ++i)
+    {
+        countToken(indexed.tokens[i], -1);
+        release(&token_postings_[indexed.tokens[i]]);
+    }
+    auto day_it = days_.find(indexed.day);
+    release(&day_it->second);
+    if (day_it->second.live == 0)
+        days_.erase(day_it);
+}
+
+bool PatientSearchIndex::isLive(const Posting &posting, int64_t *day) const
+{
+    // A booking id that came back (journal replay) may carry another name than its stale postings
+    auto it = bookings_.find(posting.booking_id);
+    if (it == bookings_.end() || it->second.tokens != posting.tokens)
+        return false;
+    if (day)
+        *day = it->second.day;
+    return true;
+}
+
+void PatientSearchIndex::release(Postings *postings)
+{
+    // Stale entries are skipped by search until they outnumber the live ones
+    --postings->live;
+    if (postings->entries.size() <= 2 * postings->live + 16)
+        return;
+    postings->entries.erase(std::remove_if(postings->entries.begin(), postings->entries.end(),
+                                           [this](const Posting &posting)
+                                           { return !isLive(posting, nullptr); }),
+                            postings->entries.end());
+}
+
+template <typename Visit>
+bool PatientSearchIndex::visitSubtree(uint32_t node, Visit &&visit) const
+{
+    // Depth first with children in character order, so tokens come out sorted and a node's own token first
+    std::vector<uint32_t> stack(1, node);
+    while (!stack.empty())
+    {
+        const TrieNode &current = nodes_[stack.back()];
+        stack.pop_back();
+        if (current.token != kNoToken && visit(current.token))
+            return true;
+        for (auto it = current.children.rbegin(); it != current.children.rend(); ++it)
+            stack.push_back(it->second);
+    }
+    return false;
+}
+
+void PatientSearchIndex::fuzzyTokens(const std::string &word, int max_distance,
+                                     std::vector<std::pair<int, uint32_t>> *tokens) const
+{
+    FuzzyWalk walk;
+    walk.word = word;
+    walk.max_distance = max_distance;
+    for (size_t j = 0; j <= word.size(); ++j)
+        walk.rows[0][j] = static_cast<int>(j);
+    walk.tokens = tokens;
+    fuzzyWalk(0, 0, static_cast<int>(word.size()), &walk);
+}
+
+void PatientSearchIndex::fuzzyWalk(uint32_t node, size_t depth, int best, FuzzyWalk *walk) const
+{
+    // A token matches with the smallest distance between the word and any prefix of it on this path
+    const TrieNode &current = nodes_[node];
+    if (current.token != kNoToken && best > 0 && best <= walk->max_distance)
+        walk->tokens->emplace_back(best, current.token);
+
+    size_t columns = walk->word.size() + 1;
+    for (const std::pair<char, uint32_t> &child : current.children)
+    {
+        if (walk->tokens->size() >= kMaxFuzzyTokens)
+            return;
+        char c = child.first;
+        walk->path[depth] = c;
+        const int *previous = walk->rows[depth];
+        int *row = walk->rows[depth + 1];
+        row[0] = static_cast<int>(depth + 1);
+        int row_min = row[0];
+        for (size_t j = 1; j < columns; ++j)
+        {
+            int substitution = previous[j - 1] + (walk->word[j - 1] != c);
+            row[j] = std::min({previous[j] + 1, row[j - 1] + 1, substitution});
+            // Adjacent letters typed the wrong way round cost one edit
+            if (depth > 0 && j > 1 && walk->word[j - 1] == walk->path[depth - 1] && walk->word[j - 2] == c)
+                row[j] = std::min(row[j], walk->rows[depth - 1][j - 2] + 1);
+            row_min = std::min(row_min, row[j]);
+        }
+        int child_best = std::min(best, row[columns - 1]);
+        // Exact prefixes were already listed; past the budget no descendant can come back within it
+        if (child_best == 0 || (row_min > walk->max_distance && child_best > walk->max_distance))
+            continue;
+        if (child_best <= walk->max_distance && row_min >= child_best)
+        {
+            // No descendant gets closer, so the whole subtree matches at this distance
+            visitSubtree(child.second, [walk, child_best](uint32_t token)
+                         {
+                             walk->tokens->emplace_back(child_best, token);
+                             return walk->tokens->size() >= kMaxFuzzyTokens; });
+            continue;
+        }
+        fuzzyWalk(child.second, depth + 1, child_best, walk);
+    }
+}
+
+int PatientSearchIndex::maxDistanceFor(const std::string &word)
+{
+    // Shorter words would match nearly every token within an edit; longer ones are taken as typed
+    if (word.size() < 4 || word.size() > kMaxFuzzyWord)
+        return 0;
+    return word.size() < 8 ? 1 : 2;
+}
+
+PatientSearchIndex::CheckedWord PatientSearchIndex::checkedWord(const std::string &word)
+{
+    CheckedWord checked;
+    checked.word = word;
+    checked.max_distance = maxDistanceFor(word);
+    checked.positions.fill(0);
+    for (size_t j = 0; j < word.size() && j < kMaxFuzzyWord; ++j)
+        checked.positions[static_cast<unsigned char>(word[j])] |= uint64_t(1) << j;
+    return checked;
+}
+
+int PatientSearchIndex::prefixDistance(const CheckedWord &word, const std::string &text)
+{
+    // One distance column per text letter in a few word operations (Myers, with Hyyro's step for
+    // swapped letters): bit j of vp / vn is set when word[0, j + 1) is one edit further from / closer
+    // to the text so far than word[0, j). Checked words are at most kMaxFuzzyWord letters long
+    uint64_t vp = ~uint64_t(0), vn = 0, d0 = 0, previous_eq = 0;
+    uint64_t last = uint64_t(1) << (word.word.size() - 1);
+    int distance = static_cast<int>(word.word.size());
+    int best = distance;
+    for (size_t i = 0; i < text.size() && best > 0; ++i)
+    {
+        uint64_t eq = word.positions[static_cast<unsigned char>(text[i])];
+        uint64_t swapped = (((~d0) & eq) << 1) & previous_eq;
+        d0 = (((eq & vp) + vp) ^ vp) | eq | vn | swapped;
+        uint64_t hp = vn | ~(d0 | vp);
+        uint64_t hn = vp & d0;
+        if (hp & last)
+            ++distance;
+        else if (hn & last)
+            --distance;
+        hp = (hp << 1) | 1;
+        hn <<= 1;
+        vp = hn | ~(d0 | hp);
+        vn = hp & d0;
+        previous_eq = eq;
+        best = std::min(best, distance);
+    }
+    return best;
+}
+
+int PatientSearchIndex::wordDistance(const CheckedWord &word, const std::array<uint32_t, kMaxTokensPerName> &tokens) const
+{
+    int best = word.max_distance + 1;
+    for (size_t i = 0; i < kMaxTokensPerName && tokens[i] != kNoToken && best > 0; ++i)
+    {
+        const std::string &text = token_text_[tokens[i]];
+        if (word.max_distance > 0)
+            best = std::min(best, prefixDistance(word, text));
+        else if (text.compare(0, word.word.size(), word.word) == 0)
+            best = 0;
+    }
+    return best <= word.max_distance ? best : -1;
+}
+
+std::vector<int> PatientSearchIndex::search(const std::string &query, size_t limit) const
+{
+    std::vector<int> results;
+    if (limit == 0)
+        return results;
+
+    // Whole words that read as a date or a booking id filter; the rest match names
+    bool by_day = false;
+    int64_t day = 0;
+    int booking_id = 0;
+    std::vector<std::string> words;
+    size_t start = 0;
+    while (start < query.size())
+    {
+        size_t end = std::min(query.find_first_of(" \t", start), query.size());
+        std::string word = query.substr(start, end - start);
+        start = end + 1;
+        if (!word.empty() && word[0] == '#')
+            word.erase(0, 1);
+        if (word.empty())
+            continue;
+        if (parseSlotDate(word, &day))
+        {
+            by_day = true;
+            continue;
+        }
+        if (isDigits(word) && word.size() <= 9)
+        {
+            booking_id = std::atoi(word.c_str());
+            continue;
+        }
+        std::string normalized = normalize(word);
+        size_t word_start = 0;
+        while (word_start < normalized.size())
+        {
+            size_t word_end = std::min(normalized.find(' ', word_start), normalized.size());
+            words.push_back(normalized.substr(word_start, word_end - word_start));
+            word_start = word_end + 1;
+        }
+    }
+
+    if (words.empty())
+    {
+        if (booking_id != 0)
+        {
+            auto it = bookings_.find(booking_id);
+            if (it != bookings_.end() && (!by_day || it->second.day == day))
+                results.push_back(booking_id);
+        }
+        else if (by_day)
+        {
+            auto day_it = days_.find(day);
+            if (day_it == days_.end())
+                return results;
+            for (const Posting &posting : day_it->second.entries)
+            {
+                if (isLive(posting, nullptr))
+                    results.push_back(posting.booking_id);
+            }
+            std::sort(results.begin(), results.end());
+            if (results.size() > limit)
+                results.resize(limit);
+        }
+        return results;
+    }
+
+    // The word with the fewest prefix matches walks the trie and the others are checked per candidate
+    size_t driver = 0;
+    size_t driver_cost = SIZE_MAX;
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        uint32_t node = findNode(words[i]);
+        size_t cost = node == kNoToken ? 0 : nodes_[node].bookings;
+        if (cost < driver_cost)
+        {
+            driver = i;
+            driver_cost = cost;
+        }
+    }
+
+    std::vector<CheckedWord> checked;
+    for (const std::string &word : words)
+        checked.push_back(checkedWord(word));
+
+    std::vector<Match> matches;
+    std::unordered_set<int> accepted; // a booking can be reached through two of its tokens
+    size_t budget = SIZE_MAX;
+    auto consider = [&](uint32_t token, int distance)
+    {
+        for (const Posting &posting : token_postings_[token].entries)
+        {
+            if (budget-- == 0)
+                return true;
+            if (booking_id != 0 && posting.booking_id != booking_id)
+                continue;
+            int total = distance;
+            for (size_t i = 0; i < words.size() && total >= 0; ++i)
+            {
+                if (i == driver)
+                    continue;
+                int word_distance = wordDistance(checked[i], posting.tokens);
+                total = word_distance < 0 ? -1 : total + word_distance;
+            }
+            // Only a match pays for the lookup that tells stale postings apart
+            int64_t posting_day = 0;
+            if (total < 0 || !isLive(posting, &posting_day) || (by_day && posting_day != day))
+                continue;
+            if (accepted.insert(posting.booking_id).second)
+                matches.push_back({total, posting.booking_id});
+            if (matches.size() >= limit)
+                return true;
+        }
+        return false;
+    };
+
+    uint32_t node = findNode(words[driver]);
+    bool full = node != kNoToken && visitSubtree(node, [&](uint32_t token)
+                                                 { return consider(token, 0); });
+    int max_distance = maxDistanceFor(words[driver]);
+    if (!full && max_distance > 0)
+    {
+        // Typos only fill what the prefix matches left over, nearest first
+        budget = kMaxFuzzyCandidates;
+        std::vector<std::pair<int, uint32_t>> tokens;
+        fuzzyTokens(words[driver], max_distance, &tokens);
+        std::stable_sort(tokens.begin(), tokens.end(), [](const std::pair<int, uint32_t> &a, const std::pair<int, uint32_t> &b)
+                         { return a.first < b.first; });
+        for (const std::pair<int, uint32_t> &token : tokens)
+        {
+            if (consider(token.second, token.first))
+                break;
+        }
+    }
+
+    std::stable_sort(matches.begin(), matches.end(), [](const Match &a, const Match &b)
+                     { return a.distance < b.distance; });
+    results.reserve(matches.size());
+    for (const Match &match : matches)
+        results.push_back(match.booking_id);
+    return results;
+}
+
+void PatientSearchIndex::slotBooked(const TimeSlot &slot, const Patient &booking)
+{
+    add(booking, slot.getDay());
+}
+
+void PatientSearchIndex::bookingRemoved(const Patient &booking, size_t)
+{
+    remove(booking.getBookingId());
+}
+
+void PatientSearchIndex::bookingArchived(const Patient &booking, size_t)
+{
+    remove(booking.getBookingId());
+}
@@ -0,0 +1,126 @@
+#ifndef PATIENT_SEARCH_H
+#define PATIENT_SEARCH_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "scheduler_core.h"
+
+/**
+ * @brief As-you-type search over live bookings by patient name, booking id and date
+ *
+ * Names are normalized (lower case, common Latin-1 accents folded, anything
+ * else a word break) into tokens held once each in a trie; every token keeps
+ * the ids of the bookings whose name contains it. A query word matches a
+ * token it is a prefix of, and words of four letters or more also match
+ * tokens that start within one edit of them (two edits from eight letters
+ * on; a swap of adjacent letters counts as one edit), found by walking the
+ * trie with a Levenshtein row per node. Whole query words that parse as a
+ * date ("yyyy-MM-dd") or a number restrict the results to that slot date or
+ * booking id. Results come prefix matches first, then by edit distance.
+ * The word with the fewest bookings under its trie node drives the search
+ * and the others are checked against each candidate's tokens, which its
+ * posting carries, with a bit-parallel distance; typo matches are only
+ * sought to fill what prefix matches leave, among a bounded number of
+ * candidates, so a query stays under a millisecond at a million bookings.
+ *
+ * As a SchedulerListener it follows book, cancel and archive events.
+ * Removal is lazy, as in SchedulerWaitlist: a token's postings drop stale
+ * entries once they outnumber the live ones. Tokens past the fourth word
+ * of a name are not indexed.
+ */
+class PatientSearchIndex : public SchedulerListener
+{
+public:
+    PatientSearchIndex();
+
+    void reload(const SchedulerCore &core); // rebuilds from core.bookings()
+    void clear();
+    void add(const Patient &booking, int64_t day);
+    void remove(int booking_id);
+    size_t size() const { return bookings_.size(); }
+
+    // Booking ids matching every word of query, best first, at most limit
+    std::vector<int> search(const std::string &query, size_t limit = 200) const;
+
+    static std::string normalize(const std::string &text); // words separated by single spaces
+
+    void slotBooked(const TimeSlot &slot, const Patient &booking) override;
+    void bookingRemoved(const Patient &booking, size_t position) override;
+    void bookingArchived(const Patient &booking, size_t position) override;
+
+    static constexpr size_t kMaxTokensPerName = 4;
+
+private:
+    static constexpr uint32_t kNoToken = UINT32_MAX;
+
+    // A booking listed under a token or date, with all its name's tokens so that candidates are
+    // checked without a lookup; unused entries of tokens are kNoToken
+    struct Posting
+    {
+        int booking_id;
+        std::array<uint32_t, kMaxTokensPerName> tokens;
+    };
+
+    // Postings, with removed bookings' dropped lazily
+    struct Postings
+    {
+        std::vector<Posting> entries;
+        size_t live = 0;
+    };
+
+    struct TrieNode
+    {
+        std::vector<std::pair<char, uint32_t>> children; // sorted by character
+        uint32_t token = kNoToken;
+        uint32_t bookings = 0; // live bookings with a token in this subtree, for picking the driving word
+    };
+
+    struct IndexedBooking
+    {
+        int64_t day;
+        std::array<uint32_t, kMaxTokensPerName> tokens;
+    };
+
+    struct Match
+    {
+        int distance;
+        int booking_id;
+    };
+
+    // A query word other than the driving one, checked against each candidate's tokens
+    struct CheckedWord
+    {
+        std::string word;
+        int max_distance;
+        std::array<uint64_t, 256> positions; // bit j of positions[c] is set when word[j] == c
+    };
+
+    struct FuzzyWalk; // Levenshtein rows and results of one fuzzyTokens call
+
+    uint32_t internToken(const std::string &token);
+    uint32_t findNode(const std::string &prefix) const;
+    void countToken(uint32_t token, int delta); // along the token's path
+    bool isLive(const Posting &posting, int64_t *day) const; // and still carries the booking's name
+    void release(Postings *postings);
+    // Feeds each token under node to visit(token) in order until it returns true
+    template <typename Visit>
+    bool visitSubtree(uint32_t node, Visit &&visit) const;
+    void fuzzyTokens(const std::string &word, int max_distance, std::vector<std::pair<int, uint32_t>> *tokens) const;
+    void fuzzyWalk(uint32_t node, size_t depth, int best, FuzzyWalk *walk) const;
+    int wordDistance(const CheckedWord &word, const std::array<uint32_t, kMaxTokensPerName> &tokens) const;
+
+    static int maxDistanceFor(const std::string &word);
+    static CheckedWord checkedWord(const std::string &word);
+    static int prefixDistance(const CheckedWord &word, const std::string &text);
+
+    std::vector<TrieNode> nodes_; // nodes_[0] is the root
+    std::vector<std::string> token_text_;
+    std::vector<Postings> token_postings_;
+    std::unordered_map<int, IndexedBooking> bookings_;
+    std::unordered_map<int64_t, Postings> days_;
+};
+
+#endif // PATIENT_SEARCH_H
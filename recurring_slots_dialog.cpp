@@ -0,0 +1,111 @@
+#include "recurring_slots_dialog.h"
+#include <QDialogButtonBox>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QVBoxLayout>
+
+static int64_t dayNumber(const QDate &date)
+{
+    return daysFromCivil(date.year(), date.month(), date.day());
+}
+
+RecurringSlotsDialog::RecurringSlotsDialog(QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle("Generate Recurring Slots");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    QGridLayout *form = new QGridLayout();
+
+    form->addWidget(new QLabel("From:"), 0, 0);
+    first_date_edit_ = new QDateEdit(QDate::currentDate());
+    first_date_edit_->setDisplayFormat("yyyy-MM-dd");
+    first_date_edit_->setCalendarPopup(true);
+    form->addWidget(first_date_edit_, 0, 1);
+
+    form->addWidget(new QLabel("To:"), 1, 0);
+    last_date_edit_ = new QDateEdit(QDate::currentDate().addDays(27));
+    last_date_edit_->setDisplayFormat("yyyy-MM-dd");
+    last_date_edit_->setCalendarPopup(true);
+    form->addWidget(last_date_edit_, 1, 1);
+
+    form->addWidget(new QLabel("Weekdays:"), 2, 0);
+    QHBoxLayout *weekday_layout = new QHBoxLayout();
+    static const char *kWeekdays[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+    for (int i = 0; i < 7; ++i)
+    {
+        weekday_checks_[i] = new QCheckBox(kWeekdays[i]);
+        weekday_checks_[i]->setChecked(i < 5);
+        weekday_layout->addWidget(weekday_checks_[i]);
+    }
+    form->addLayout(weekday_layout, 2, 1);
+
+    form->addWidget(new QLabel("Windows (HH:MM-HH:MM, ...):"), 3, 0);
+    windows_input_ = new QLineEdit("09:00-12:00, 14:00-16:00");
+    form->addWidget(windows_input_, 3, 1);
+
+    form->addWidget(new QLabel("Interval (minutes):"), 4, 0);
+    interval_input_ = new QSpinBox();
+    interval_input_->setRange(1, 24 * 60);
+    interval_input_->setValue(30);
+    form->addWidget(interval_input_, 4, 1);
+
+    form->addWidget(new QLabel("Lanes:"), 5, 0);
+    lanes_input_ = new QSpinBox();
+    lanes_input_->setRange(1, 64);
+    lanes_input_->setValue(1);
+    form->addWidget(lanes_input_, 5, 1);
+
+    // Seats per slot: one slot per time serves a whole lane group instead of one slot per seat
+    form->addWidget(new QLabel("Seats per slot:"), 6, 0);
+    capacity_input_ = new QSpinBox();
+    capacity_input_->setRange(1, SchedulerCore::kMaxCapacity);
+    capacity_input_->setValue(1);
+    form->addWidget(capacity_input_, 6, 1);
+
+    layout->addLayout(form);
+
+    QDialogButtonBox *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    layout->addWidget(buttons);
+}
+
+bool RecurringSlotsDialog::spec(RecurringSlotSpec *spec, QString *error) const
+{
+    spec->first_day = dayNumber(first_date_edit_->date());
+    spec->last_day = dayNumber(last_date_edit_->date());
+    spec->interval_minutes = interval_input_->value();
+    spec->lanes = lanes_input_->value();
+    spec->capacity = capacity_input_->value();
+
+    spec->weekday_mask = 0;
+    for (int i = 0; i < 7; ++i)
+    {
+        if (weekday_checks_[i]->isChecked())
+            spec->weekday_mask |= 1u << i;
+    }
+
+    spec->windows.clear();
+    const QStringList windows = windows_input_->text().split(',', Qt::SkipEmptyParts);
+    for (const QString &window : windows)
+    {
+        QStringList bounds = window.trimmed().split('-');
+        int start_minute, end_minute;
+        if (bounds.size() != 2 ||
+            !parseSlotTime(bounds[0].trimmed().toStdString(), &start_minute) ||
+            !parseSlotTime(bounds[1].trimmed().toStdString(), &end_minute))
+        {
+            *error = QString("Invalid time window \"%1\"; use HH:MM-HH:MM.").arg(window.trimmed());
+            return false;
+        }
+        spec->windows.push_back({start_minute, end_minute});
+    }
+    if (spec->windows.empty())
+    {
+        *error = "Please enter at least one time window.";
+        return false;
+    }
+    return true;
+}
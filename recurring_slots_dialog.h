@@ -0,0 +1,34 @@
+#ifndef RECURRING_SLOTS_DIALOG_H
+#define RECURRING_SLOTS_DIALOG_H
+
+#include <QtWidgets/QDialog>
+#include <QtWidgets/QDateEdit>
+#include <QtWidgets/QCheckBox>
+#include <QtWidgets/QLineEdit>
+#include <QtWidgets/QSpinBox>
+#include "scheduler_core.h"
+
+/**
+ * @brief Dialog collecting a RecurringSlotSpec (date range, weekdays, windows, lanes, seats)
+ */
+class RecurringSlotsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit RecurringSlotsDialog(QWidget *parent = nullptr);
+
+    // Fills spec from the inputs; returns false and sets error when they are invalid
+    bool spec(RecurringSlotSpec *spec, QString *error) const;
+
+private:
+    QDateEdit *first_date_edit_;
+    QDateEdit *last_date_edit_;
+    QCheckBox *weekday_checks_[7];
+    QLineEdit *windows_input_;
+    QSpinBox *interval_input_;
+    QSpinBox *lanes_input_;
+    QSpinBox *capacity_input_;
+};
+
+#endif // RECURRING_SLOTS_DIALOG_H
@@ -0,0 +1,242 @@
+#include "schedule_image.h"
+#include "slot_time.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct ScheduleImage::Header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t slot_count;
+    int64_t first_day;
+    uint64_t day_count;
+    uint64_t days_offset;
+    uint64_t slots_offset;
+    uint64_t checksum; // FNV-1a over the slot records, identifies the calendar
+};
+
+namespace
+{
+const char kImageMagic[8] = {'C', 'T', 'S', 'I', 'M', 'G', '0', '1'};
+const uint32_t kImageVersion = 1;
+
+uint64_t fnv1a(const void *data, size_t size)
+{
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    uint64_t hash = 1469598103934665603ull;
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+} // namespace
+
+ScheduleImage::ScheduleImage()
+    : data_(nullptr), size_(0), days_(nullptr), slots_(nullptr), slot_count_(0), first_day_(0), day_count_(0), checksum_(0)
+#ifdef _WIN32
+      ,
+      file_handle_(nullptr), mapping_handle_(nullptr)
+#endif
+{
+}
+
+ScheduleImage::~ScheduleImage()
+{
+    close();
+}
+
+bool ScheduleImage::open(const std::string &path, std::string *error)
+{
+    std::string ignored;
+    if (!error)
+        error = &ignored;
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        *error = "cannot open " + path;
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void *view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        *error = "cannot map " + path;
+        return false;
+    }
+    file_handle_ = file;
+    mapping_handle_ = mapping;
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    data_ = static_cast<const char *>(view);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        *error = "cannot open " + path;
+        return false;
+    }
+    struct stat info;
+    void *view = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+        view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // the mapping keeps its own reference
+    if (view == MAP_FAILED)
+    {
+        *error = "cannot map " + path;
+        return false;
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    data_ = static_cast<const char *>(view);
+#endif
+
+    // Validate the fixed layout once; queries then trust the offsets
+    Header header;
+    bool valid = size_ >= sizeof(Header);
+    if (valid)
+    {
+        std::memcpy(&header, data_, sizeof(Header));
+        valid = std::memcmp(header.magic, kImageMagic, sizeof(kImageMagic)) == 0 && header.version == kImageVersion &&
+                header.header_size == sizeof(Header) &&
+                header.days_offset <= size_ && header.day_count <= (size_ - header.days_offset) / sizeof(DayEntry) &&
+                header.slots_offset <= size_ && header.slot_count <= (size_ - header.slots_offset) / sizeof(SlotRecord) &&
+                header.slots_offset % alignof(SlotRecord) == 0 && header.days_offset % alignof(DayEntry) == 0;
+    }
+    if (!valid)
+    {
+        close();
+        *error = "unsupported or damaged schedule image " + path;
+        return false;
+    }
+
+    days_ = reinterpret_cast<const DayEntry *>(data_ + header.days_offset);
+    slots_ = reinterpret_cast<const SlotRecord *>(data_ + header.slots_offset);
+    slot_count_ = static_cast<size_t>(header.slot_count);
+    first_day_ = header.first_day;
+    day_count_ = static_cast<size_t>(header.day_count);
+    checksum_ = header.checksum;
+    return true;
+}
+
+void ScheduleImage::close()
+{
+    if (data_)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(data_);
+        CloseHandle(static_cast<HANDLE>(mapping_handle_));
+        CloseHandle(static_cast<HANDLE>(file_handle_));
+        mapping_handle_ = file_handle_ = nullptr;
+#else
+        munmap(const_cast<char *>(data_), size_);
+#endif
+    }
+    data_ = nullptr;
+    size_ = 0;
+    days_ = nullptr;
+    slots_ = nullptr;
+    slot_count_ = day_count_ = 0;
+    first_day_ = 0;
+    checksum_ = 0;
+}
+
+std::pair<size_t, size_t> ScheduleImage::dayRange(int64_t day) const
+{
+    if (!days_ || day < first_day_ || day >= first_day_ + static_cast<int64_t>(day_count_))
+        return std::make_pair(size_t(0), size_t(0));
+    const DayEntry &entry = days_[day - first_day_];
+    size_t first = std::min<size_t>(entry.first_slot, slot_count_);
+    size_t last = std::min<size_t>(first + entry.slot_count, slot_count_);
+    return std::make_pair(first, last);
+}
+
+size_t ScheduleImage::lowerBound(int64_t start_key) const
+{
+    if (!slots_)
+        return 0;
+    const SlotRecord *record = std::lower_bound(slots_, slots_ + slot_count_, start_key,
+                                                [](const SlotRecord &slot, int64_t key)
+                                                { return slot.start_key < key; });
+    return static_cast<size_t>(record - slots_);
+}
+
+bool ScheduleImage::write(const std::string &path, std::vector<SlotRecord> slots, std::string *error)
+{
+    std::string ignored;
+    if (!error)
+        error = &ignored;
+
+    std::sort(slots.begin(), slots.end(), [](const SlotRecord &a, const SlotRecord &b)
+              { return a.start_key != b.start_key ? a.start_key < b.start_key : a.lane < b.lane; });
+    slots.erase(std::unique(slots.begin(), slots.end(), [](const SlotRecord &a, const SlotRecord &b)
+                            { return a.start_key == b.start_key && a.lane == b.lane; }),
+                slots.end());
+    for (SlotRecord &record : slots)
+        record.capacity = std::max<uint32_t>(record.capacity, 1);
+
+    std::vector<DayEntry> days;
+    int64_t first_day = slots.empty() ? 0 : dayOfKey(slots.front().start_key);
+    if (!slots.empty())
+        days.assign(static_cast<size_t>(dayOfKey(slots.back().start_key) - first_day + 1), DayEntry{0, 0});
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        DayEntry &entry = days[static_cast<size_t>(dayOfKey(slots[i].start_key) - first_day)];
+        if (entry.slot_count == 0)
+            entry.first_slot = static_cast<uint32_t>(i);
+        ++entry.slot_count;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, kImageMagic, sizeof(kImageMagic));
+    header.version = kImageVersion;
+    header.header_size = sizeof(Header);
+    header.slot_count = slots.size();
+    header.first_day = first_day;
+    header.day_count = days.size();
+    header.days_offset = sizeof(Header);
+    // Round up so the mapped slot table stays 8-byte aligned
+    header.slots_offset = (header.days_offset + days.size() * sizeof(DayEntry) + 7) & ~uint64_t(7);
+    header.checksum = fnv1a(slots.data(), slots.size() * sizeof(SlotRecord));
+
+    std::string temp_path = path + ".tmp";
+    FILE *file = std::fopen(temp_path.c_str(), "wb");
+    if (!file)
+    {
+        *error = "cannot create " + temp_path;
+        return false;
+    }
+    static const char kPadding[8] = {0};
+    size_t padding = static_cast<size_t>(header.slots_offset - header.days_offset - days.size() * sizeof(DayEntry));
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (days.empty() || std::fwrite(days.data(), sizeof(DayEntry), days.size(), file) == days.size()) &&
+              std::fwrite(kPadding, 1, padding, file) == padding &&
+              (slots.empty() || std::fwrite(slots.data(), sizeof(SlotRecord), slots.size(), file) == slots.size());
+    ok = (std::fclose(file) == 0) && ok;
+    if (ok)
+    {
+        std::remove(path.c_str());
+        ok = std::rename(temp_path.c_str(), path.c_str()) == 0;
+    }
+    if (!ok)
+    {
+        std::remove(temp_path.c_str());
+        *error = "cannot write " + path;
+    }
+    return ok;
+}
@@ -0,0 +1,74 @@
+#ifndef SCHEDULE_IMAGE_H
+#define SCHEDULE_IMAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Read-only, memory-mapped calendar of published slots
+ *
+ * File layout (little-endian, version 1):
+ *   Header                      magic "CTSIMG01", counts, offsets, checksum
+ *   DayEntry[day_count]         {first_slot, slot_count} for first_day + i
+ *   SlotRecord[slot_count]      {start_key, lane, capacity}, sorted by start key then lane
+ *
+ * Opening maps the file and validates the header only, so it costs the same
+ * for a week or a year of slots. SchedulerCore serves untouched days straight
+ * from the mapping and keeps every change in its own overlay.
+ */
+class ScheduleImage
+{
+public:
+    struct SlotRecord
+    {
+        int64_t start_key;
+        uint32_t lane;
+        uint32_t capacity; // seats; 0 in images written before capacities, read as 1
+    };
+
+    ScheduleImage();
+    ~ScheduleImage();
+    ScheduleImage(const ScheduleImage &) = delete;
+    ScheduleImage &operator=(const ScheduleImage &) = delete;
+
+    bool open(const std::string &path, std::string *error = nullptr);
+    void close();
+    bool isOpen() const { return data_ != nullptr; }
+
+    size_t slotCount() const { return slot_count_; }
+    const SlotRecord &slot(size_t index) const { return slots_[index]; }
+    // Half-open record range [first, second) for a day; empty outside the image
+    std::pair<size_t, size_t> dayRange(int64_t day) const;
+    // Index of the first record starting at or after start_key; slotCount() if none
+    size_t lowerBound(int64_t start_key) const;
+    uint64_t checksum() const { return checksum_; }
+
+    // Writes slots (sorted and de-duplicated on (start key, lane)) as a new image
+    static bool write(const std::string &path, std::vector<SlotRecord> slots, std::string *error = nullptr);
+
+private:
+    struct Header;
+    struct DayEntry
+    {
+        uint32_t first_slot;
+        uint32_t slot_count;
+    };
+
+    const char *data_;
+    size_t size_;
+    const DayEntry *days_;
+    const SlotRecord *slots_;
+    size_t slot_count_;
+    int64_t first_day_;
+    size_t day_count_;
+    uint64_t checksum_;
+#ifdef _WIN32
+    void *file_handle_;
+    void *mapping_handle_;
+#endif
+};
+
+#endif // SCHEDULE_IMAGE_H
@@ -0,0 +1,515 @@
+// Microbenchmarks for the scheduling engine.
+//
+//   scheduler_benchmark [--max-slots 10000000] [--ops 10000] [--legacy-max 100000]
+//                       [--slots-per-day 288] [--label text] [--json results.json]
+//
+// For each calendar size (1k, 10k, ... up to --max-slots) a SchedulerCore is
+// filled with slots spread over consecutive days and every fourth slot is
+// booked. The benchmark then times --ops single operations against it: adding
+// a slot, booking a given slot, cancelling a booking, refreshing a day's slot
+// list, picking a day's earliest slot and the next ten open slots from a
+// given time across dates, counting a month of open slots, plus the bulk
+// build itself. Up to a million bookings, PatientSearchIndex is timed on
+// synthetic names: indexing, prefix, two-word and misspelled queries, and
+// removal.
+//
+// Up to --legacy-max slots, the same operations also run against a
+// reconstruction of the original window's data path (std::string in place of
+// QString): duplicate check by scanning every slot, booking by draining and
+// rebuilding the day's priority queue, cancellation by vector erase, refresh
+// by copying and popping the whole queue, and a comparator that re-parses both
+// date-time strings on every comparison.
+//
+// Results go to stdout as a table and, with --json, to a file for tracking
+// regressions between versions.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+#include "patient_search.h"
+#include "scheduler_core.h"
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+const int64_t kFirstDay = 19723; // 2024-01-01
+
+struct Options
+{
+    size_t max_slots = 10000000;
+    size_t ops = 10000;
+    size_t legacy_max = 100000;
+    size_t legacy_ops = 1000;
+    int slots_per_day = 288;
+    std::string label;
+    std::string json_path;
+};
+
+struct Result
+{
+    std::string name;
+    std::string impl; // "core" or "legacy"
+    size_t slots;
+    size_t bookings;
+    size_t ops;
+    double ns_per_op;
+};
+
+std::vector<Result> results;
+volatile uint64_t sink; // keeps measured work from being optimized away
+
+template <typename Function>
+double timeNs(Function &&function)
+{
+    Clock::time_point start = Clock::now();
+    function();
+    return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+void record(const std::string &name, const std::string &impl, size_t slots, size_t bookings, size_t ops, double total_ns)
+{
+    Result result{name, impl, slots, bookings, ops, ops ? total_ns / ops : 0.0};
+    std::printf("%-16s %-7s %10zu slots %9zu bookings %8zu ops %14.1f ns/op\n", name.c_str(), impl.c_str(), slots,
+                bookings, ops, result.ns_per_op);
+    std::fflush(stdout);
+    results.push_back(result);
+}
+
+int minuteOfIndex(const Options &options, size_t index_in_day)
+{
+    return static_cast<int>(index_in_day * kMinutesPerDay / options.slots_per_day);
+}
+
+int64_t slotKey(const Options &options, size_t index)
+{
+    return makeStartKey(kFirstDay + static_cast<int64_t>(index / options.slots_per_day),
+                        minuteOfIndex(options, index % options.slots_per_day));
+}
+
+// Distinct indexes in [0, count), shuffled; at most limit of them
+std::vector<size_t> sample(size_t count, size_t limit, std::mt19937_64 *rng)
+{
+    std::vector<size_t> indexes(count);
+    for (size_t i = 0; i < count; ++i)
+        indexes[i] = i;
+    std::shuffle(indexes.begin(), indexes.end(), *rng);
+    indexes.resize(std::min(count, limit));
+    return indexes;
+}
+
+// Reconstruction of the original window's data path
+struct LegacySlot
+{
+    int id;
+    std::string time;
+    std::string date;
+    bool booked = false;
+    std::string dateTime() const { return date + " " + time; }
+};
+
+int64_t legacyParse(const std::string &date_time)
+{
+    int64_t day = 0;
+    int minute = 0;
+    parseSlotDate(date_time.substr(0, 10), &day);
+    parseSlotTime(date_time.substr(11, 5), &minute);
+    return makeStartKey(day, minute);
+}
+
+bool legacyGreater(const LegacySlot &a, const LegacySlot &b)
+{
+    return legacyParse(a.dateTime()) > legacyParse(b.dateTime());
+}
+
+struct LegacyComparator
+{
+    bool operator()(const std::shared_ptr<LegacySlot> &a, const std::shared_ptr<LegacySlot> &b) const
+    {
+        return legacyGreater(*a, *b);
+    }
+};
+
+struct LegacyPatient
+{
+    std::string name;
+    int age;
+    std::shared_ptr<LegacySlot> slot;
+};
+
+typedef std::priority_queue<std::shared_ptr<LegacySlot>, std::vector<std::shared_ptr<LegacySlot>>, LegacyComparator> LegacyHeap;
+
+struct LegacyScheduler
+{
+    std::map<std::string, LegacyHeap> slots_by_date;
+    std::vector<std::shared_ptr<LegacyPatient>> bookings;
+    std::vector<std::shared_ptr<LegacySlot>> all_slots;
+    int next_slot_id = 1;
+
+    bool addSlot(const std::string &date, const std::string &time)
+    {
+        for (const auto &slot : all_slots)
+        {
+            if (slot->date == date && slot->time == time)
+                return false;
+        }
+        auto slot = std::make_shared<LegacySlot>(LegacySlot{next_slot_id++, time, date});
+        all_slots.push_back(slot);
+        slots_by_date[date].push(slot);
+        return true;
+    }
+
+    bool bookSlot(const std::string &date, int slot_id, const std::string &name, int age)
+    {
+        LegacyHeap &heap = slots_by_date[date];
+        std::vector<std::shared_ptr<LegacySlot>> temp_slots;
+        std::shared_ptr<LegacySlot> selected;
+        while (!heap.empty())
+        {
+            auto slot = heap.top();
+            heap.pop();
+            if (slot->id == slot_id && !slot->booked)
+                selected = slot;
+            else
+                temp_slots.push_back(slot);
+        }
+        for (auto &slot : temp_slots)
+            heap.push(slot);
+        if (!selected)
+            return false;
+        selected->booked = true;
+        bookings.push_back(std::make_shared<LegacyPatient>(LegacyPatient{name, age, selected}));
+        return true;
+    }
+
+    void cancelBooking(size_t index)
+    {
+        auto patient = bookings[index];
+        patient->slot->booked = false;
+        slots_by_date[patient->slot->date].push(patient->slot);
+        bookings.erase(bookings.begin() + index);
+    }
+
+    size_t refresh(const std::string &date)
+    {
+        size_t characters = 0;
+        auto temp_queue = slots_by_date[date];
+        int position = 1;
+        while (!temp_queue.empty())
+        {
+            auto slot = temp_queue.top();
+            temp_queue.pop();
+            std::string item_text = std::to_string(position++) + ". " + slot->date + " " + slot->time +
+                                    " (ID: " + std::to_string(slot->id) + ")";
+            characters += item_text.size();
+        }
+        return characters;
+    }
+};
+
+void benchCore(const Options &options, size_t slots)
+{
+    std::mt19937_64 rng(slots);
+    size_t days = (slots + options.slots_per_day - 1) / options.slots_per_day;
+    std::unique_ptr<SchedulerCore> core(new SchedulerCore());
+
+    std::vector<SlotKey> keys(slots);
+    for (size_t i = 0; i < slots; ++i)
+        keys[i] = {slotKey(options, i), 1};
+    record("build", "core", slots, 0, slots, timeNs([&]()
+                                                  { core->addSlots(std::move(keys)); }));
+
+    // Every fourth slot is booked; slot ids follow the key order
+    size_t booked = 0;
+    for (size_t i = 0; i < slots; i += 4)
+        booked += core->bookSlot(static_cast<int>(i) + 1, "Patient " + std::to_string(i), 30) == SchedulerResult::Ok;
+
+    std::vector<size_t> picks = sample(slots / 4, options.ops, &rng);
+    record("add_slot", "core", slots, booked, picks.size(), timeNs([&]()
+                                                                 {
+        for (size_t pick : picks)
+            core->addSlot(slotKey(options, pick * 4) + 1, nullptr); }));
+
+    record("book_slot", "core", slots, booked, picks.size(), timeNs([&]()
+                                                                  {
+        for (size_t pick : picks)
+            core->bookSlot(static_cast<int>(pick * 4 + 2) + 1, "Walk-in", 40); }));
+
+    record("cancel_booking", "core", slots, core->bookings().size(), picks.size(), timeNs([&]()
+                                                                                        {
+        for (size_t pick : picks)
+            core->cancelBooking(static_cast<int>(pick) + 1); }));
+
+    size_t refreshes = std::min<size_t>(options.ops, 1000);
+    std::uniform_int_distribution<size_t> day_of(0, days - 1);
+    std::vector<int64_t> refresh_days(refreshes);
+    for (int64_t &day : refresh_days)
+        day = kFirstDay + static_cast<int64_t>(day_of(rng));
+    record("refresh_day", "core", slots, core->bookings().size(), refreshes, timeNs([&]()
+                                                                                  {
+        for (int64_t day : refresh_days)
+            sink = sink + core->availableSlots(day).size(); }));
+
+    record("earliest_slot", "core", slots, core->bookings().size(), refreshes, timeNs([&]()
+                                                                                    {
+        for (int64_t day : refresh_days)
+            sink = sink + (core->earliestSlot(day) ? 1 : 0); }));
+
+    // From a random instant: the day's remaining slots are scanned, later days come from the open-date index
+    std::uniform_int_distribution<int> minute_of(0, kMinutesPerDay - 1);
+    std::vector<int64_t> after_keys(refreshes);
+    for (size_t i = 0; i < refreshes; ++i)
+        after_keys[i] = makeStartKey(refresh_days[i], minute_of(rng));
+    record("next_available", "core", slots, core->bookings().size(), refreshes, timeNs([&]()
+                                                                                     {
+        for (int64_t key : after_keys)
+            sink = sink + core->nextAvailableSlots(key, 10).size(); }));
+
+    // Month-long range counts: one popcount run per lane, against summing 30 per-day heap sizes
+    record("count_month", "core", slots, core->bookings().size(), refreshes, timeNs([&]()
+                                                                                  {
+        for (int64_t day : refresh_days)
+            sink = sink + core->availableCount(day, day + 29); }));
+
+    record("count_month_days", "core", slots, core->bookings().size(), refreshes, timeNs([&]()
+                                                                                       {
+        for (int64_t day : refresh_days)
+            for (int64_t d = day; d < day + 30; ++d)
+                sink = sink + core->availableCount(d); }));
+}
+
+// Names from syllables, so a million bookings share tens of thousands of distinct words like real ones
+std::string syntheticWord(std::mt19937_64 *rng)
+{
+    static const char *kSyllables[] = {"an", "jo", "ma", "ri", "el", "ka", "to", "li", "sa", "ben", "mar", "tin",
+                                       "son", "er", "ia", "ha", "ro", "de", "ne", "lu", "vi", "go", "pe", "ti"};
+    std::string word;
+    for (int count = 2 + static_cast<int>((*rng)() % 3); count > 0; --count)
+        word += kSyllables[(*rng)() % 24];
+    return word;
+}
+
+void benchSearch(const Options &options, size_t bookings)
+{
+    std::mt19937_64 rng(bookings);
+    std::vector<Patient> patients;
+    patients.reserve(bookings);
+    for (size_t i = 0; i < bookings; ++i)
+        patients.emplace_back(static_cast<int>(i) + 1, syntheticWord(&rng) + " " + syntheticWord(&rng), 30, 1);
+
+    PatientSearchIndex index;
+    record("search_build", "core", 0, bookings, bookings, timeNs([&]()
+                                                               {
+        for (size_t i = 0; i < bookings; ++i)
+            index.add(patients[i], kFirstDay + static_cast<int64_t>(i % 365)); }));
+
+    // Queries are cut from existing names: a prefix, a first name plus a surname prefix, and a swapped-letter surname
+    size_t queries = std::min<size_t>(options.ops, 1000);
+    std::vector<std::string> prefixes, pairs, typos;
+    for (size_t i = 0; i < queries; ++i)
+    {
+        std::string name = PatientSearchIndex::normalize(patients[rng() % bookings].getName());
+        size_t space = name.find(' ');
+        prefixes.push_back(name.substr(0, 3));
+        pairs.push_back(name.substr(0, space + 4));
+        std::string surname = name.substr(space + 1);
+        std::swap(surname[1], surname[2]);
+        typos.push_back(surname);
+    }
+    auto timeQueries = [&](const char *name, const std::vector<std::string> &texts)
+    {
+        record(name, "core", 0, bookings, texts.size(), timeNs([&]()
+                                                              {
+            for (const std::string &text : texts)
+                sink = sink + index.search(text, 200).size(); }));
+    };
+    timeQueries("search_prefix", prefixes);
+    timeQueries("search_two_words", pairs);
+    timeQueries("search_typo", typos);
+
+    std::vector<size_t> picks = sample(bookings, options.ops, &rng);
+    record("search_remove", "core", 0, bookings, picks.size(), timeNs([&]()
+                                                                    {
+        for (size_t pick : picks)
+            index.remove(static_cast<int>(pick) + 1); }));
+}
+
+void benchLegacy(const Options &options, size_t slots)
+{
+    std::mt19937_64 rng(slots);
+    size_t days = (slots + options.slots_per_day - 1) / options.slots_per_day;
+    LegacyScheduler legacy;
+
+    // Built without the duplicate scan, which would make setup quadratic
+    for (size_t i = 0; i < slots; ++i)
+    {
+        int64_t key = slotKey(options, i);
+        auto slot = std::make_shared<LegacySlot>(LegacySlot{legacy.next_slot_id++, formatSlotTime(minuteOfKey(key)),
+                                                            formatSlotDate(dayOfKey(key))});
+        legacy.all_slots.push_back(slot);
+        if (i % 4 == 0)
+        {
+            slot->booked = true;
+            legacy.bookings.push_back(std::make_shared<LegacyPatient>(LegacyPatient{"Patient " + std::to_string(i), 30, slot}));
+        }
+        else
+        {
+            legacy.slots_by_date[slot->date].push(slot);
+        }
+    }
+    size_t booked = legacy.bookings.size();
+
+    std::vector<size_t> picks = sample(slots / 4, options.legacy_ops, &rng);
+    record("add_slot", "legacy", slots, booked, picks.size(), timeNs([&]()
+                                                                   {
+        for (size_t pick : picks)
+        {
+            int64_t key = slotKey(options, pick * 4) + 1;
+            legacy.addSlot(formatSlotDate(dayOfKey(key)), formatSlotTime(minuteOfKey(key)));
+        } }));
+
+    record("book_slot", "legacy", slots, booked, picks.size(), timeNs([&]()
+                                                                    {
+        for (size_t pick : picks)
+        {
+            const LegacySlot &slot = *legacy.all_slots[pick * 4 + 2];
+            legacy.bookSlot(slot.date, slot.id, "Walk-in", 40);
+        } }));
+
+    std::uniform_int_distribution<size_t> booking_of(0, legacy.bookings.size() - 1);
+    size_t cancels = std::min(picks.size(), legacy.bookings.size());
+    record("cancel_booking", "legacy", slots, legacy.bookings.size(), cancels, timeNs([&]()
+                                                                                    {
+        for (size_t i = 0; i < cancels; ++i)
+            legacy.cancelBooking(booking_of(rng) % legacy.bookings.size()); }));
+
+    size_t refreshes = std::min<size_t>(options.legacy_ops, 1000);
+    std::uniform_int_distribution<size_t> day_of(0, days - 1);
+    std::vector<std::string> refresh_days(refreshes);
+    for (std::string &day : refresh_days)
+        day = formatSlotDate(kFirstDay + static_cast<int64_t>(day_of(rng)));
+    record("refresh_day", "legacy", slots, legacy.bookings.size(), refreshes, timeNs([&]()
+                                                                                   {
+        for (const std::string &day : refresh_days)
+            sink = sink + legacy.refresh(day); }));
+}
+
+void benchComparators(const Options &options)
+{
+    const size_t count = 1 << 16;
+    const size_t compares = options.ops * 100;
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<size_t> index_of(0, 100000);
+    std::vector<TimeSlot> slots;
+    std::vector<LegacySlot> legacy_slots;
+    for (size_t i = 0; i < count; ++i)
+    {
+        int64_t key = slotKey(options, index_of(rng));
+        slots.emplace_back(static_cast<int>(i) + 1, key);
+        legacy_slots.push_back({static_cast<int>(i) + 1, formatSlotTime(minuteOfKey(key)), formatSlotDate(dayOfKey(key))});
+    }
+
+    record("comparator", "core", 0, 0, compares, timeNs([&]()
+                                                       {
+        uint64_t less = 0;
+        for (size_t i = 0; i < compares; ++i)
+            less += slots[i & (count - 1)] > slots[(i * 7 + 1) & (count - 1)];
+        sink = sink + less; }));
+
+    size_t legacy_compares = compares / 100;
+    record("comparator", "legacy", 0, 0, legacy_compares, timeNs([&]()
+                                                               {
+        uint64_t less = 0;
+        for (size_t i = 0; i < legacy_compares; ++i)
+            less += legacyGreater(legacy_slots[i & (count - 1)], legacy_slots[(i * 7 + 1) & (count - 1)]);
+        sink = sink + less; }));
+}
+
+std::string jsonEscape(const std::string &text)
+{
+    std::string escaped;
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+            escaped.push_back('\\');
+        if (static_cast<unsigned char>(c) >= 0x20)
+            escaped.push_back(c);
+    }
+    return escaped;
+}
+
+bool writeJson(const Options &options)
+{
+    FILE *file = std::fopen(options.json_path.c_str(), "w");
+    if (!file)
+        return false;
+    std::fprintf(file, "{\n  \"benchmark\": \"scheduler\",\n  \"label\": \"%s\",\n  \"slots_per_day\": %d,\n  \"results\": [\n",
+                 jsonEscape(options.label).c_str(), options.slots_per_day);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &result = results[i];
+        std::fprintf(file, "    {\"name\": \"%s\", \"impl\": \"%s\", \"slots\": %zu, \"bookings\": %zu, \"ops\": %zu, \"ns_per_op\": %.1f}%s\n",
+                     result.name.c_str(), result.impl.c_str(), result.slots, result.bookings, result.ops, result.ns_per_op,
+                     i + 1 < results.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--max-slots")
+            options.max_slots = std::strtoull(value, nullptr, 10);
+        else if (flag == "--ops")
+            options.ops = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+        else if (flag == "--legacy-max")
+            options.legacy_max = std::strtoull(value, nullptr, 10);
+        else if (flag == "--slots-per-day")
+            options.slots_per_day = std::max(1, std::min(std::atoi(value), static_cast<int>(kMinutesPerDay)));
+        else if (flag == "--label")
+            options.label = value;
+        else if (flag == "--json")
+            options.json_path = value;
+        else
+        {
+            std::fprintf(stderr, "unknown option %s\n", flag.c_str());
+            return 2;
+        }
+    }
+    if (argc % 2 == 0)
+    {
+        std::fprintf(stderr, "missing value for %s\n", argv[argc - 1]);
+        return 2;
+    }
+    options.legacy_ops = std::min(options.ops, options.legacy_ops);
+
+    benchComparators(options);
+    for (size_t slots = 1000; slots <= options.max_slots; slots *= 10)
+    {
+        benchCore(options, slots);
+        if (slots <= options.legacy_max)
+            benchLegacy(options, slots);
+    }
+    for (size_t bookings = 1000; bookings <= std::min<size_t>(options.max_slots, 1000000); bookings *= 10)
+        benchSearch(options, bookings);
+
+    if (!options.json_path.empty() && !writeJson(options))
+    {
+        std::fprintf(stderr, "cannot write %s\n", options.json_path.c_str());
+        return 1;
+    }
+    return 0;
+}
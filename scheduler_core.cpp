@@ -0,0 +1,1104 @@
+#include "scheduler_core.h"
+#include "schedule_image.h"
+#include <algorithm>
+#include <ctime>
+#include <limits>
+
+// TimeSlot Implementation
+TimeSlot::TimeSlot(int id, int64_t start_key, int lane, bool booked)
+    : id_(id), start_key_(start_key), lane_(lane), capacity_(1), booked_count_(booked ? 1 : 0) {}
+
+TimeSlot::TimeSlot(int id, int64_t start_key, int lane, int capacity, int booked_count)
+    : id_(id), start_key_(start_key), lane_(lane), capacity_(capacity), booked_count_(booked_count) {}
+
+bool TimeSlot::operator>(const TimeSlot &other) const
+{
+    if (start_key_ != other.start_key_)
+        return start_key_ > other.start_key_;
+    return id_ > other.id_;
+}
+
+bool TimeSlot::operator<(const TimeSlot &other) const
+{
+    if (start_key_ != other.start_key_)
+        return start_key_ < other.start_key_;
+    return id_ < other.id_;
+}
+
+bool TimeSlot::operator==(const TimeSlot &other) const
+{
+    return id_ == other.id_;
+}
+
+// Patient Implementation
+Patient::Patient(int booking_id, const std::string &name, int age, int slot_id)
+    : booking_id_(booking_id), slot_id_(slot_id), booked_at_(static_cast<int64_t>(std::time(nullptr))),
+      name_(name), age_(age) {}
+
+Patient::Patient(int booking_id, const std::string &name, int age, int slot_id, int64_t booked_at)
+    : booking_id_(booking_id), slot_id_(slot_id), booked_at_(booked_at), name_(name), age_(age) {}
+
+const char *schedulerResultText(SchedulerResult result)
+{
+    switch (result)
+    {
+    case SchedulerResult::Ok:
+        return "OK";
+    case SchedulerResult::InvalidDate:
+        return "Please enter a date in YYYY-MM-DD format between 1970 and 2199.";
+    case SchedulerResult::InvalidTime:
+        return "Please enter time in HH:MM format.";
+    case SchedulerResult::DuplicateSlot:
+        return "This time slot already exists.";
+    case SchedulerResult::InvalidPatient:
+        return "Please enter patient name.";
+    case SchedulerResult::NoSuchSlot:
+        return "Invalid slot selection.";
+    case SchedulerResult::SlotUnavailable:
+        return "The selected slot is no longer available.";
+    case SchedulerResult::NoSuchBooking:
+        return "The selected booking no longer exists.";
+    case SchedulerResult::InvalidRecurrence:
+        return "Please check the date range, time windows, interval and lane count.";
+    case SchedulerResult::InvalidCapacity:
+        return "Please enter between 1 and 65535 seats per slot.";
+    case SchedulerResult::InvalidWaitlistRange:
+        return "Please choose a waitlist date range of at most 62 days.";
+    case SchedulerResult::NoSuchWaitlistEntry:
+        return "The selected waitlist entry no longer exists.";
+    case SchedulerResult::ExpiredDate:
+        return "That date has passed and can no longer be changed.";
+    case SchedulerResult::StorageFailed:
+        return "The change could not be saved; bookings are suspended until the scheduler restarts.";
+    }
+    return "Unknown error";
+}
+
+// SchedulerCore Implementation
+SchedulerCore::SchedulerCore()
+    : image_(nullptr), image_slot_count_(0), full_slot_count_(0), arena_seats_(0), image_seats_(0),
+      image_seats_known_(false), next_booking_id_(1), retention_floor_(std::numeric_limits<int64_t>::min()),
+      booking_prune_cursor_(0), index_prune_day_(std::numeric_limits<int64_t>::max()), index_prune_minute_(0),
+      index_prune_found_(0), archived_booking_count_(0) {}
+
+bool SchedulerCore::attachImage(const ScheduleImage *image)
+{
+    if (slotCount() != 0 || !image || !image->isOpen())
+        return false;
+    image_ = image;
+    image_slot_count_ = static_cast<SlotHandle>(image->slotCount());
+    image_seats_known_ = false;
+
+    // One pass over the records, which are grouped by date, seeds the date, week and month totals
+    AvailabilityTotals day_totals;
+    for (size_t index = 0; index < image->slotCount(); ++index)
+    {
+        int64_t day = dayOfKey(image->slot(index).start_key);
+        day_totals.slots += 1;
+        day_totals.seats += capacityOf(static_cast<SlotHandle>(index));
+        if (index + 1 == image->slotCount() || dayOfKey(image->slot(index + 1).start_key) != day)
+        {
+            day_totals.open_slots = day_totals.slots;
+            aggregates_.apply(day, day_totals);
+            day_totals = AvailabilityTotals();
+        }
+    }
+    if (image->slotCount() > 0)
+        index_prune_day_ = dayOfKey(image->slot(0).start_key);
+    return true;
+}
+
+void SchedulerCore::addListener(SchedulerListener *listener)
+{
+    listeners_.push_back(listener);
+}
+
+void SchedulerCore::removeListener(SchedulerListener *listener)
+{
+    listeners_.erase(std::remove(listeners_.begin(), listeners_.end(), listener), listeners_.end());
+}
+
+SchedulerCore::SlotHeap &SchedulerCore::heapForDay(int64_t day)
+{
+    auto it = slotsByDate_.find(day);
+    if (it != slotsByDate_.end())
+        return it->second;
+
+    it = slotsByDate_.emplace(day, SlotHeap(SlotHeapPositions(this))).first;
+    if (image_)
+    {
+        // Copy the day's open image slots into the overlay heap; records are already in heap order
+        std::pair<size_t, size_t> range = image_->dayRange(day);
+        std::vector<SlotHeapEntry> entries;
+        entries.reserve(range.second - range.first);
+        for (size_t index = range.first; index < range.second; ++index)
+        {
+            SlotHandle handle = static_cast<SlotHandle>(index);
+            if (!isBookedHandle(handle))
+                entries.push_back({image_->slot(index).start_key, handle});
+        }
+        it->second.reserve(entries.size());
+        it->second.pushRange(entries.begin(), entries.end());
+        updateOpenDay(day, it->second);
+        for (const SlotHeapEntry &entry : entries)
+            open_bitmap_.set(entry.start_key, laneOf(entry.handle));
+    }
+    return it->second;
+}
+
+std::pair<size_t, size_t> SchedulerCore::untouchedImageRange(int64_t day) const
+{
+    // Untouched image days are all open, until they expire
+    if (!image_ || day < retention_floor_ || slotsByDate_.count(day))
+        return {0, 0};
+    return image_->dayRange(day);
+}
+
+void SchedulerCore::updateOpenDay(int64_t day, const SlotHeap &heap)
+{
+    if (heap.empty())
+        open_days_.erase(day);
+    else
+        open_days_.insert(day);
+}
+
+SlotHandle SchedulerCore::createSlot(int64_t start_key, int lane, int capacity)
+{
+    SlotHandle handle = static_cast<SlotHandle>(slotCount());
+    slot_start_keys_.push_back(start_key);
+    slot_lanes_.push_back(static_cast<uint8_t>(lane));
+    slot_capacities_.push_back(static_cast<uint16_t>(capacity));
+    slot_booked_counts_.push_back(0);
+    arena_seats_ += static_cast<size_t>(capacity);
+    aggregates_.apply(dayOfKey(start_key), AvailabilityTotals{1, 1, capacity, 0});
+    slot_heap_positions_.push_back(kNotInHeap);
+    slot_handles_by_start_.emplace(slotIndexKey(start_key, lane), handle);
+    if (dayOfKey(start_key) < index_prune_day_)
+    {
+        // Only dates at or past the floor take new slots, so no sweep of this date is under way
+        index_prune_day_ = dayOfKey(start_key);
+        index_prune_minute_ = 0;
+        index_prune_found_ = 0;
+    }
+    return handle;
+}
+
+TimeSlot SchedulerCore::slotView(SlotHandle handle) const
+{
+    return TimeSlot(static_cast<int>(handle) + 1, startKeyOf(handle), laneOf(handle), capacityOf(handle),
+                    bookedCountOf(handle));
+}
+
+int64_t SchedulerCore::startKeyOf(SlotHandle handle) const
+{
+    if (handle < image_slot_count_)
+        return image_->slot(handle).start_key;
+    return slot_start_keys_[handle - image_slot_count_];
+}
+
+int SchedulerCore::laneOf(SlotHandle handle) const
+{
+    if (handle < image_slot_count_)
+        return static_cast<int>(image_->slot(handle).lane);
+    return slot_lanes_[handle - image_slot_count_];
+}
+
+int SchedulerCore::capacityOf(SlotHandle handle) const
+{
+    if (handle < image_slot_count_)
+        return static_cast<int>(std::min<uint32_t>(std::max<uint32_t>(image_->slot(handle).capacity, 1), kMaxCapacity));
+    return slot_capacities_[handle - image_slot_count_];
+}
+
+int SchedulerCore::bookedCountOf(SlotHandle handle) const
+{
+    if (handle < image_slot_count_)
+    {
+        auto it = image_booked_counts_.find(handle);
+        return it == image_booked_counts_.end() ? 0 : it->second;
+    }
+    return slot_booked_counts_[handle - image_slot_count_];
+}
+
+void SchedulerCore::setBookedCount(SlotHandle handle, int booked_count)
+{
+    bool was_full = isBookedHandle(handle);
+    int old_booked_count = bookedCountOf(handle);
+    if (handle >= image_slot_count_)
+        slot_booked_counts_[handle - image_slot_count_] = static_cast<uint16_t>(booked_count);
+    else if (booked_count > 0)
+        image_booked_counts_[handle] = static_cast<uint16_t>(booked_count);
+    else
+        image_booked_counts_.erase(handle);
+
+    bool full = isBookedHandle(handle);
+    if (full && !was_full)
+        ++full_slot_count_;
+    else if (was_full && !full)
+        --full_slot_count_;
+
+    AvailabilityTotals delta;
+    delta.open_slots = static_cast<int>(was_full) - static_cast<int>(full);
+    delta.booked_seats = booked_count - old_booked_count;
+    aggregates_.apply(dayOfKey(startKeyOf(handle)), delta);
+}
+
+bool SchedulerCore::hasSlotAt(int64_t start_key, int lane, SlotHandle *handle) const
+{
+    auto it = slot_handles_by_start_.find(slotIndexKey(start_key, lane));
+    if (it != slot_handles_by_start_.end())
+    {
+        if (handle)
+            *handle = it->second;
+        return true;
+    }
+    if (!image_)
+        return false;
+
+    // Image records are sorted by (start key, lane) within each day
+    std::pair<size_t, size_t> range = image_->dayRange(dayOfKey(start_key));
+    size_t low = range.first, high = range.second;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        const ScheduleImage::SlotRecord &record = image_->slot(middle);
+        if (record.start_key < start_key || (record.start_key == start_key && static_cast<int>(record.lane) < lane))
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low == range.second || image_->slot(low).start_key != start_key || static_cast<int>(image_->slot(low).lane) != lane)
+        return false;
+    if (handle)
+        *handle = static_cast<SlotHandle>(low);
+    return true;
+}
+
+SchedulerResult SchedulerCore::addSlot(const std::string &date, const std::string &time, int *slot_id)
+{
+    int64_t day;
+    int minute_of_day;
+    if (!parseSlotDate(date, &day))
+        return SchedulerResult::InvalidDate;
+    if (!parseSlotTime(time, &minute_of_day))
+        return SchedulerResult::InvalidTime;
+    return addSlot(makeStartKey(day, minute_of_day), slot_id);
+}
+
+SchedulerResult SchedulerCore::addSlot(const std::string &date, const std::string &time, int capacity, int *slot_id)
+{
+    int64_t day;
+    int minute_of_day;
+    if (!parseSlotDate(date, &day))
+        return SchedulerResult::InvalidDate;
+    if (!parseSlotTime(time, &minute_of_day))
+        return SchedulerResult::InvalidTime;
+    return addSlot(makeStartKey(day, minute_of_day), 1, capacity, slot_id);
+}
+
+SchedulerResult SchedulerCore::addSlot(int64_t start_key, int *slot_id)
+{
+    return addSlot(start_key, 1, 1, slot_id);
+}
+
+SchedulerResult SchedulerCore::addSlot(int64_t start_key, int lane, int *slot_id)
+{
+    return addSlot(start_key, lane, 1, slot_id);
+}
+
+SchedulerResult SchedulerCore::addSlot(int64_t start_key, int lane, int capacity, int *slot_id)
+{
+    if (lane < 1 || lane > kMaxLanes)
+        return SchedulerResult::InvalidRecurrence;
+    if (capacity < 1 || capacity > kMaxCapacity)
+        return SchedulerResult::InvalidCapacity;
+    if (!isSlotDay(dayOfKey(start_key)))
+        return SchedulerResult::InvalidDate;
+
+    if (dayOfKey(start_key) < retention_floor_)
+        return SchedulerResult::ExpiredDate;
+    // Check if slot already exists
+    if (hasSlotAt(start_key, lane))
+        return SchedulerResult::DuplicateSlot;
+
+    SlotHandle handle = createSlot(start_key, lane, capacity);
+    SlotHeap &heap = heapForDay(dayOfKey(start_key));
+    heap.push({start_key, handle});
+    updateOpenDay(dayOfKey(start_key), heap);
+    open_bitmap_.set(start_key, lane);
+
+    TimeSlot slot = slotView(handle);
+    for (auto *listener : listeners_)
+        listener->slotAdded(slot);
+
+    if (slot_id)
+        *slot_id = slot.getId();
+    return SchedulerResult::Ok;
+}
+
+SchedulerResult SchedulerCore::addRecurringSlots(const RecurringSlotSpec &requested, size_t *added, size_t *duplicates)
+{
+    if (requested.last_day >= requested.first_day && (!isSlotDay(requested.first_day) || !isSlotDay(requested.last_day)))
+        return SchedulerResult::InvalidDate;
+
+    // Expired dates are dropped from the spec itself, so listeners (the journal) see what was generated
+    RecurringSlotSpec spec = requested;
+    spec.first_day = std::max(spec.first_day, retention_floor_);
+    if (requested.last_day >= requested.first_day && spec.last_day < spec.first_day)
+    {
+        if (added)
+            *added = 0;
+        if (duplicates)
+            *duplicates = 0;
+        return SchedulerResult::ExpiredDate;
+    }
+
+    if (spec.last_day < spec.first_day || spec.interval_minutes <= 0 || spec.lanes < 1 || spec.lanes > kMaxLanes ||
+        spec.windows.empty() || (spec.weekday_mask & 0x7f) == 0)
+        return SchedulerResult::InvalidRecurrence;
+    if (spec.capacity < 1 || spec.capacity > kMaxCapacity)
+        return SchedulerResult::InvalidCapacity;
+
+    // Slot start minutes within one day, shared by every generated date
+    std::vector<int> minutes;
+    for (const SlotWindow &window : spec.windows)
+    {
+        if (window.start_minute < 0 || window.end_minute > kMinutesPerDay || window.start_minute >= window.end_minute)
+            return SchedulerResult::InvalidRecurrence;
+        for (int minute = window.start_minute; minute < window.end_minute; minute += spec.interval_minutes)
+            minutes.push_back(minute);
+    }
+    std::sort(minutes.begin(), minutes.end());
+    minutes.erase(std::unique(minutes.begin(), minutes.end()), minutes.end());
+
+    // 1970-01-01 was a Thursday, so Monday-based weekday = (day + 3) mod 7
+    auto weekdayOf = [](int64_t day)
+    { return static_cast<int>(((day + 3) % 7 + 7) % 7); };
+
+    size_t matching_days = 0;
+    for (int64_t day = spec.first_day; day <= spec.last_day; ++day)
+    {
+        if (spec.weekday_mask & (1u << weekdayOf(day)))
+            ++matching_days;
+    }
+    reserveSlots(matching_days * minutes.size() * spec.lanes);
+
+    size_t created = 0;
+    size_t skipped = 0;
+    std::vector<SlotHeapEntry> day_slots;
+    day_slots.reserve(minutes.size() * spec.lanes);
+    for (int64_t day = spec.first_day; day <= spec.last_day; ++day)
+    {
+        if (!(spec.weekday_mask & (1u << weekdayOf(day))))
+            continue;
+
+        day_slots.clear();
+        for (int minute : minutes)
+        {
+            int64_t start_key = makeStartKey(day, minute);
+            for (int lane = 1; lane <= spec.lanes; ++lane)
+            {
+                if (hasSlotAt(start_key, lane))
+                {
+                    ++skipped;
+                    continue;
+                }
+                day_slots.push_back({start_key, createSlot(start_key, lane, spec.capacity)});
+            }
+        }
+        if (day_slots.empty())
+            continue;
+
+        // One heapify per date instead of a sift per slot
+        SlotHeap &heap = heapForDay(day);
+        heap.reserve(heap.size() + day_slots.size());
+        heap.pushRange(day_slots.begin(), day_slots.end());
+        updateOpenDay(day, heap);
+        for (const SlotHeapEntry &entry : day_slots)
+            open_bitmap_.set(entry.start_key, laneOf(entry.handle));
+        created += day_slots.size();
+    }
+
+    if (created > 0)
+    {
+        for (auto *listener : listeners_)
+            listener->slotsAdded(spec);
+    }
+
+    if (added)
+        *added = created;
+    if (duplicates)
+        *duplicates = skipped;
+    return SchedulerResult::Ok;
+}
+
+SchedulerResult SchedulerCore::addSlots(std::vector<SlotKey> slots, size_t *added, size_t *duplicates)
+{
+    for (const SlotKey &slot : slots)
+    {
+        if (slot.lane < 1 || slot.lane > kMaxLanes)
+            return SchedulerResult::InvalidRecurrence;
+        if (slot.capacity < 1 || slot.capacity > kMaxCapacity)
+            return SchedulerResult::InvalidCapacity;
+        if (!isSlotDay(dayOfKey(slot.start_key)))
+            return SchedulerResult::InvalidDate;
+    }
+
+    // Sorting groups each date's slots together and makes in-batch duplicates adjacent
+    std::sort(slots.begin(), slots.end(), [](const SlotKey &a, const SlotKey &b)
+              { return a.start_key != b.start_key ? a.start_key < b.start_key : a.lane < b.lane; });
+    size_t batch_size = slots.size();
+    slots.erase(std::unique(slots.begin(), slots.end(), [](const SlotKey &a, const SlotKey &b)
+                            { return a.start_key == b.start_key && a.lane == b.lane; }),
+                slots.end());
+    size_t skipped = batch_size - slots.size();
+    reserveSlots(slots.size());
+
+    int first_slot_id = static_cast<int>(slotCount()) + 1;
+    std::vector<SlotHeapEntry> day_slots;
+    for (size_t begin = 0; begin < slots.size();)
+    {
+        int64_t day = dayOfKey(slots[begin].start_key);
+        size_t end = begin;
+        day_slots.clear();
+        for (; end < slots.size() && dayOfKey(slots[end].start_key) == day; ++end)
+        {
+            if (day < retention_floor_ || hasSlotAt(slots[end].start_key, slots[end].lane))
+            {
+                ++skipped;
+                continue;
+            }
+            day_slots.push_back({slots[end].start_key, createSlot(slots[end].start_key, slots[end].lane, slots[end].capacity)});
+        }
+        begin = end;
+        if (day_slots.empty())
+            continue;
+
+        SlotHeap &heap = heapForDay(day);
+        heap.reserve(heap.size() + day_slots.size());
+        heap.pushRange(day_slots.begin(), day_slots.end());
+        updateOpenDay(day, heap);
+        for (const SlotHeapEntry &entry : day_slots)
+            open_bitmap_.set(entry.start_key, laneOf(entry.handle));
+    }
+
+    size_t created = slotCount() + 1 - static_cast<size_t>(first_slot_id);
+    if (created > 0)
+    {
+        for (auto *listener : listeners_)
+            listener->slotsImported(first_slot_id, created);
+    }
+
+    if (added)
+        *added = created;
+    if (duplicates)
+        *duplicates = skipped;
+    return SchedulerResult::Ok;
+}
+
+SchedulerResult SchedulerCore::bookSlot(int slot_id, const std::string &patient_name, int patient_age, int *booking_id)
+{
+    if (patient_name.empty())
+        return SchedulerResult::InvalidPatient;
+    if (isValidSlotId(slot_id) && dayOfKey(startKeyOf(static_cast<SlotHandle>(slot_id - 1))) < retention_floor_)
+        return SchedulerResult::ExpiredDate;
+
+    SchedulerResult result = restoreBooking(Patient(next_booking_id_, patient_name, patient_age, slot_id));
+    if (result == SchedulerResult::Ok && booking_id)
+        *booking_id = next_booking_id_ - 1;
+    return result;
+}
+
+SchedulerResult SchedulerCore::restoreBooking(Patient booking)
+{
+    int slot_id = booking.getSlotId();
+    if (!isValidSlotId(slot_id))
+        return SchedulerResult::NoSuchSlot;
+    if (booking_positions_.count(booking.getBookingId()))
+        return SchedulerResult::SlotUnavailable;
+
+    SlotHandle handle = static_cast<SlotHandle>(slot_id - 1);
+    if (isBookedHandle(handle))
+        return SchedulerResult::SlotUnavailable;
+
+    // Take one seat; the slot leaves its date heap, in O(log n), only with the last one
+    int booked_count = bookedCountOf(handle) + 1;
+    if (booked_count == capacityOf(handle))
+    {
+        int64_t day = dayOfKey(startKeyOf(handle));
+        SlotHeap &heap = heapForDay(day);
+        if (!heap.erase(handle))
+            return SchedulerResult::SlotUnavailable;
+        updateOpenDay(day, heap);
+        open_bitmap_.reset(startKeyOf(handle), laneOf(handle));
+    }
+    setBookedCount(handle, booked_count);
+
+    booking_positions_.emplace(booking.getBookingId(), patient_bookings_.size());
+    booking_ids_by_slot_.emplace(slot_id, booking.getBookingId());
+    setNextBookingId(booking.getBookingId() + 1);
+    patient_bookings_.push_back(std::move(booking));
+
+    TimeSlot slot = slotView(handle);
+    for (auto *listener : listeners_)
+        listener->slotBooked(slot, patient_bookings_.back());
+    return SchedulerResult::Ok;
+}
+
+void SchedulerCore::setNextBookingId(int next_booking_id)
+{
+    next_booking_id_ = std::max(next_booking_id_, next_booking_id);
+}
+
+SchedulerResult SchedulerCore::cancelBooking(int booking_id, int *reassigned_booking_id)
+{
+    if (reassigned_booking_id)
+        *reassigned_booking_id = 0;
+    const Patient *booking = findBooking(booking_id);
+    if (!booking)
+        return SchedulerResult::NoSuchBooking;
+    int slot_id = booking->getSlotId();
+    // A booking on an expired date is waiting for the archive; its date heap may already be gone
+    if (isValidSlotId(slot_id) && dayOfKey(startKeyOf(static_cast<SlotHandle>(slot_id - 1))) < retention_floor_)
+        return SchedulerResult::ExpiredDate;
+    SchedulerResult result = restoreCancellation(booking_id);
+    if (result != SchedulerResult::Ok || !isValidSlotId(slot_id))
+        return result;
+
+    // The freed seat goes straight to the best waiting patient for that date
+    const WaitlistEntry *waiting = waitlist_.best(dayOfKey(startKeyOf(static_cast<SlotHandle>(slot_id - 1))));
+    if (!waiting)
+        return result;
+    WaitlistEntry entry;
+    waitlist_.remove(waiting->waitlist_id, &entry);
+    int new_booking_id = 0;
+    if (bookSlot(slot_id, entry.patient_name, entry.patient_age, &new_booking_id) != SchedulerResult::Ok)
+    {
+        // Cannot happen for a seat that was just freed; keep the patient waiting rather than drop them
+        waitlist_.add(entry);
+        return result;
+    }
+    for (auto *listener : listeners_)
+        listener->waitlistRemoved(entry, new_booking_id);
+    if (reassigned_booking_id)
+        *reassigned_booking_id = new_booking_id;
+    return result;
+}
+
+SchedulerResult SchedulerCore::addToWaitlist(const std::string &patient_name, int patient_age, int64_t first_day,
+                                             int64_t last_day, int priority, int *waitlist_id)
+{
+    WaitlistEntry entry;
+    entry.waitlist_id = waitlist_.nextId();
+    entry.patient_name = patient_name;
+    entry.patient_age = patient_age;
+    entry.priority = priority;
+    entry.requested_at = static_cast<int64_t>(std::time(nullptr));
+    entry.first_day = first_day;
+    entry.last_day = last_day;
+    SchedulerResult result = restoreWaitlistEntry(entry);
+    if (result == SchedulerResult::Ok && waitlist_id)
+        *waitlist_id = entry.waitlist_id;
+    return result;
+}
+
+SchedulerResult SchedulerCore::restoreWaitlistEntry(const WaitlistEntry &entry)
+{
+    if (entry.patient_name.empty())
+        return SchedulerResult::InvalidPatient;
+    if (entry.last_day < entry.first_day || entry.last_day - entry.first_day >= SchedulerWaitlist::kMaxDays)
+        return SchedulerResult::InvalidWaitlistRange;
+    if (entry.last_day < retention_floor_)
+        return SchedulerResult::ExpiredDate;
+    if (!waitlist_.add(entry))
+        return SchedulerResult::InvalidPatient; // that id is already waiting
+
+    for (auto *listener : listeners_)
+        listener->waitlistAdded(entry);
+    return SchedulerResult::Ok;
+}
+
+SchedulerResult SchedulerCore::removeFromWaitlist(int waitlist_id)
+{
+    WaitlistEntry entry;
+    if (!waitlist_.remove(waitlist_id, &entry))
+        return SchedulerResult::NoSuchWaitlistEntry;
+
+    for (auto *listener : listeners_)
+        listener->waitlistRemoved(entry, 0);
+    return SchedulerResult::Ok;
+}
+
+SchedulerResult SchedulerCore::restoreCancellation(int booking_id)
+{
+    auto position_it = booking_positions_.find(booking_id);
+    if (position_it == booking_positions_.end())
+        return SchedulerResult::NoSuchBooking;
+
+    size_t position = position_it->second;
+    Patient patient = detachBooking(position);
+    if (isValidSlotId(patient.getSlotId()))
+    {
+        // push() ignores ids already in the heap, so a release never duplicates a slot. Journals
+        // written before cancelBooking refused expired dates can replay one; the seat is freed
+        // without bringing back the date's heap and bits
+        SlotHandle handle = static_cast<SlotHandle>(patient.getSlotId() - 1);
+        setBookedCount(handle, bookedCountOf(handle) - 1);
+        int64_t day = dayOfKey(startKeyOf(handle));
+        if (day >= retention_floor_)
+        {
+            SlotHeap &heap = heapForDay(day);
+            heap.push({startKeyOf(handle), handle});
+            updateOpenDay(day, heap);
+            open_bitmap_.set(startKeyOf(handle), laneOf(handle));
+        }
+
+        TimeSlot slot = slotView(handle);
+        for (auto *listener : listeners_)
+            listener->slotReleased(slot);
+    }
+
+    for (auto *listener : listeners_)
+        listener->bookingRemoved(patient, position);
+    return SchedulerResult::Ok;
+}
+
+Patient SchedulerCore::detachBooking(size_t position)
+{
+    Patient patient = std::move(patient_bookings_[position]);
+    auto range = booking_ids_by_slot_.equal_range(patient.getSlotId());
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (it->second == patient.getBookingId())
+        {
+            booking_ids_by_slot_.erase(it);
+            break;
+        }
+    }
+
+    // Swap-remove keeps the storage dense and the erase O(1)
+    if (position + 1 != patient_bookings_.size())
+    {
+        patient_bookings_[position] = std::move(patient_bookings_.back());
+        booking_positions_[patient_bookings_[position].getBookingId()] = position;
+    }
+    patient_bookings_.pop_back();
+    booking_positions_.erase(patient.getBookingId());
+    return patient;
+}
+
+SchedulerResult SchedulerCore::restoreArchival(int booking_id)
+{
+    auto position_it = booking_positions_.find(booking_id);
+    if (position_it == booking_positions_.end())
+        return SchedulerResult::NoSuchBooking;
+
+    archiveBooking(position_it->second);
+    return SchedulerResult::Ok;
+}
+
+void SchedulerCore::archiveBooking(size_t position)
+{
+    // The seat stays taken: an archived booking happened, it just no longer needs to be live
+    Patient patient = detachBooking(position);
+    ++archived_booking_count_;
+    for (auto *listener : listeners_)
+        listener->bookingArchived(patient, position);
+}
+
+SchedulerResult SchedulerCore::restoreArchivedSeats(int slot_id, int seats)
+{
+    if (!isValidSlotId(slot_id))
+        return SchedulerResult::NoSuchSlot;
+    SlotHandle handle = static_cast<SlotHandle>(slot_id - 1);
+    int booked_count = bookedCountOf(handle) + seats;
+    if (seats <= 0 || booked_count > capacityOf(handle))
+        return SchedulerResult::SlotUnavailable;
+
+    if (booked_count == capacityOf(handle))
+    {
+        int64_t day = dayOfKey(startKeyOf(handle));
+        SlotHeap &heap = heapForDay(day);
+        heap.erase(handle);
+        updateOpenDay(day, heap);
+        open_bitmap_.reset(startKeyOf(handle), laneOf(handle));
+    }
+    setBookedCount(handle, booked_count);
+    archived_booking_count_ += static_cast<size_t>(seats);
+    return SchedulerResult::Ok;
+}
+
+void SchedulerCore::setRetentionFloor(int64_t day)
+{
+    if (day <= retention_floor_)
+        return;
+    retention_floor_ = day;
+    for (auto *listener : listeners_)
+        listener->retentionFloorRaised(day);
+    // The booking sweep only compared against the old floor, so it starts over; the date
+    // sweep of slot index entries and totals carries on from the last date it finished
+    booking_prune_cursor_ = 0;
+}
+
+std::vector<std::pair<int, int>> SchedulerCore::archivedSeats() const
+{
+    // A slot's seats are taken by its live bookings and by archived ones, so the rest are archived
+    std::vector<std::pair<int, int>> seats;
+    auto collect = [&](SlotHandle handle, int booked_count)
+    {
+        int slot_id = static_cast<int>(handle) + 1;
+        int archived = booked_count - static_cast<int>(booking_ids_by_slot_.count(slot_id));
+        if (archived > 0)
+            seats.emplace_back(slot_id, archived);
+    };
+    for (const auto &booked : image_booked_counts_)
+        collect(booked.first, booked.second);
+    std::sort(seats.begin(), seats.end());
+    for (size_t index = 0; index < slot_booked_counts_.size(); ++index)
+    {
+        if (slot_booked_counts_[index] > 0)
+            collect(image_slot_count_ + static_cast<SlotHandle>(index), slot_booked_counts_[index]);
+    }
+    return seats;
+}
+
+bool SchedulerCore::pruneStep(size_t budget, size_t *archived, size_t *spent)
+{
+    if (archived)
+        *archived = 0;
+    const size_t requested = budget;
+    // Expired date heaps, oldest first; each costs its open slots
+    while (budget > 0 && !slotsByDate_.empty() && slotsByDate_.begin()->first < retention_floor_)
+    {
+        auto date_it = slotsByDate_.begin();
+        SlotHeap &heap = date_it->second;
+        for (const SlotHeapEntry &entry : heap.items())
+            open_bitmap_.reset(entry.start_key, laneOf(entry.handle));
+        budget -= std::min(budget, heap.size() + 1);
+        heap.clear();
+        open_days_.erase(date_it->first);
+        slotsByDate_.erase(date_it);
+    }
+
+    // Bookings on expired dates; a swap-remove refills the position, so it is checked again
+    while (budget > 0 && booking_prune_cursor_ < patient_bookings_.size())
+    {
+        --budget;
+        int slot_id = patient_bookings_[booking_prune_cursor_].getSlotId();
+        if (!isValidSlotId(slot_id) || dayOfKey(startKeyOf(static_cast<SlotHandle>(slot_id - 1))) >= retention_floor_)
+        {
+            ++booking_prune_cursor_;
+            continue;
+        }
+        // Evicting a booking the archive failed to store would lose it for good
+        bool stored = true;
+        for (auto *listener : listeners_)
+            stored = stored && listener->storeArchived(patient_bookings_[booking_prune_cursor_]);
+        if (!stored)
+            break;
+        archiveBooking(booking_prune_cursor_);
+        if (archived)
+            ++*archived;
+    }
+
+    // Expired dates one at a time from where the last sweep stopped: the duplicate-check index
+    // entries of their arena slots (the floor already refuses those keys), probed a minute per
+    // unit until the date's slot total is accounted for, then the date's totals. It waits for
+    // the booking sweep, so no live booking outlives its date's totals
+    while (budget > 0 && booking_prune_cursor_ >= patient_bookings_.size() && index_prune_day_ < retention_floor_)
+    {
+        int64_t day = index_prune_day_;
+        size_t image_slots = 0;
+        if (image_)
+        {
+            std::pair<size_t, size_t> range = image_->dayRange(day);
+            image_slots = range.second - range.first;
+        }
+        size_t arena_slots = static_cast<size_t>(aggregates_.day(day).slots) - image_slots;
+        for (; budget > 0 && index_prune_found_ < arena_slots && index_prune_minute_ < kMinutesPerDay;
+             --budget, ++index_prune_minute_)
+        {
+            int64_t start_key = makeStartKey(day, index_prune_minute_);
+            for (int lane = 1; lane <= open_bitmap_.laneCount(); ++lane)
+                index_prune_found_ += slot_handles_by_start_.erase(slotIndexKey(start_key, lane));
+        }
+        if (index_prune_found_ < arena_slots && index_prune_minute_ < kMinutesPerDay)
+            break;
+        budget -= std::min<size_t>(budget, 1);
+        aggregates_.dropDay(day);
+        ++index_prune_day_;
+        index_prune_minute_ = 0;
+        index_prune_found_ = 0;
+    }
+
+    // Bitmap blocks wholly before the floor; their bits went with the date heaps above
+    if (slotsByDate_.empty() || slotsByDate_.begin()->first >= retention_floor_)
+        open_bitmap_.dropBefore(retention_floor_);
+
+    // Waiting patients whose whole date range has passed
+    std::vector<WaitlistEntry> expired;
+    budget -= std::min(budget, waitlist_.expireBefore(retention_floor_, budget, &expired));
+    for (const WaitlistEntry &entry : expired)
+    {
+        for (auto *listener : listeners_)
+            listener->waitlistExpired(entry);
+    }
+
+    if (spent)
+        *spent = requested - budget;
+    return (!slotsByDate_.empty() && slotsByDate_.begin()->first < retention_floor_) ||
+           booking_prune_cursor_ < patient_bookings_.size() || index_prune_day_ < retention_floor_ ||
+           waitlist_.expiredBefore() < retention_floor_;
+}
+
+std::vector<TimeSlot> SchedulerCore::availableSlots(int64_t day) const
+{
+    std::vector<TimeSlot> result;
+    auto date_it = slotsByDate_.find(day);
+    if (date_it == slotsByDate_.end())
+    {
+        // Untouched image days are read straight from the mapping, already in order
+        std::pair<size_t, size_t> range = untouchedImageRange(day);
+        result.reserve(range.second - range.first);
+        for (size_t index = range.first; index < range.second; ++index)
+            result.push_back(slotView(static_cast<SlotHandle>(index)));
+        return result;
+    }
+
+    // Sort a copy of the heap array to list the slots in min-heap pop order
+    std::vector<SlotHeapEntry> entries = date_it->second.items();
+    std::sort(entries.begin(), entries.end(), [](const SlotHeapEntry &a, const SlotHeapEntry &b)
+              { return SlotHeapEntryGreater()(b, a); });
+    result.reserve(entries.size());
+    for (const SlotHeapEntry &entry : entries)
+        result.push_back(slotView(entry.handle));
+    return result;
+}
+
+size_t SchedulerCore::availableSeats(int64_t day) const
+{
+    size_t seats = 0;
+    auto date_it = slotsByDate_.find(day);
+    if (date_it != slotsByDate_.end())
+    {
+        for (const SlotHeapEntry &entry : date_it->second.items())
+            seats += static_cast<size_t>(capacityOf(entry.handle) - bookedCountOf(entry.handle));
+        return seats;
+    }
+    std::pair<size_t, size_t> range = untouchedImageRange(day);
+    for (size_t index = range.first; index < range.second; ++index)
+        seats += static_cast<size_t>(capacityOf(static_cast<SlotHandle>(index)));
+    return seats;
+}
+
+size_t SchedulerCore::availableCount(int64_t day) const
+{
+    auto date_it = slotsByDate_.find(day);
+    if (date_it != slotsByDate_.end())
+        return date_it->second.size();
+    std::pair<size_t, size_t> range = untouchedImageRange(day);
+    return range.second - range.first;
+}
+
+size_t SchedulerCore::availableCount(int64_t first_day, int64_t last_day) const
+{
+    size_t total = open_bitmap_.count(first_day, last_day);
+    if (image_)
+    {
+        // Untouched image days have no bits; all their records are open
+        for (int64_t day = first_day; day <= last_day; ++day)
+        {
+            std::pair<size_t, size_t> range = untouchedImageRange(day);
+            total += range.second - range.first;
+        }
+    }
+    return total;
+}
+
+std::vector<size_t> SchedulerCore::availableCountsByDay(int64_t first_day, int64_t last_day) const
+{
+    std::vector<size_t> counts;
+    for (int64_t day = first_day; day <= last_day; ++day)
+        counts.push_back(slotsByDate_.count(day) ? open_bitmap_.count(day) : availableCount(day));
+    return counts;
+}
+
+std::optional<TimeSlot> SchedulerCore::earliestSlot(int64_t day) const
+{
+    auto date_it = slotsByDate_.find(day);
+    if (date_it != slotsByDate_.end())
+    {
+        if (date_it->second.empty())
+            return std::nullopt;
+        return slotView(date_it->second.top().handle);
+    }
+    std::pair<size_t, size_t> range = untouchedImageRange(day);
+    if (range.first < range.second)
+        return slotView(static_cast<SlotHandle>(range.first));
+    return std::nullopt;
+}
+
+int64_t SchedulerCore::nextOpenDay(int64_t day) const
+{
+    auto open_it = open_days_.upper_bound(day);
+    int64_t next = open_it == open_days_.end() ? std::numeric_limits<int64_t>::max() : *open_it;
+    if (image_)
+    {
+        // Untouched image days are open wherever the image has slots; touched ones are in open_days_
+        size_t index = image_->lowerBound(makeStartKey(std::max(day + 1, retention_floor_), 0));
+        while (index < image_->slotCount())
+        {
+            int64_t image_day = dayOfKey(image_->slot(index).start_key);
+            if (image_day >= next)
+                break;
+            if (!slotsByDate_.count(image_day))
+                return image_day;
+            index = image_->dayRange(image_day).second;
+        }
+    }
+    return next;
+}
+
+void SchedulerCore::appendOpenSlots(int64_t day, int64_t from_key, size_t count, std::vector<TimeSlot> *slots) const
+{
+    auto date_it = slotsByDate_.find(day);
+    if (date_it != slotsByDate_.end())
+    {
+        const SlotHeap &heap = date_it->second;
+        if (heap.empty())
+            return;
+        if (count == 1 && heap.top().start_key >= from_key)
+        {
+            slots->push_back(slotView(heap.top().handle));
+            return;
+        }
+        // Walk the day's open minutes in order with count-trailing-zeros over all lanes' bits;
+        // slots sharing a minute are ordered by handle, as the heap orders them
+        int from_minute = from_key > makeStartKey(day, 0) ? minuteOfKey(from_key) : 0;
+        std::vector<SlotHandle> handles;
+        for (int word = from_minute / 64; word < AvailabilityBitmap::kWordsPerDay && count > 0; ++word)
+        {
+            uint64_t bits = open_bitmap_.unionWord(day, word);
+            if (word == from_minute / 64)
+                bits &= ~uint64_t(0) << (from_minute % 64);
+            for (; bits && count > 0; bits &= bits - 1)
+            {
+                int minute = word * 64 + __builtin_ctzll(bits);
+                int64_t start_key = makeStartKey(day, minute);
+                handles.clear();
+                for (uint64_t lanes = open_bitmap_.lanesAt(day, minute); lanes; lanes &= lanes - 1)
+                {
+                    SlotHandle handle;
+                    if (hasSlotAt(start_key, __builtin_ctzll(lanes) + 1, &handle))
+                        handles.push_back(handle);
+                }
+                std::sort(handles.begin(), handles.end());
+                for (size_t i = 0; i < handles.size() && count > 0; ++i, --count)
+                    slots->push_back(slotView(handles[i]));
+            }
+        }
+        return;
+    }
+    // No slot on an untouched day is full, and its records are in start order
+    std::pair<size_t, size_t> range = untouchedImageRange(day);
+    if (range.first < range.second)
+    {
+        size_t index = std::max(range.first, image_->lowerBound(from_key));
+        for (; index < range.second && count > 0; ++index, --count)
+            slots->push_back(slotView(static_cast<SlotHandle>(index)));
+    }
+}
+
+std::optional<TimeSlot> SchedulerCore::earliestSlotAfter(int64_t start_key) const
+{
+    std::vector<TimeSlot> slots = nextAvailableSlots(start_key, 1);
+    if (slots.empty())
+        return std::nullopt;
+    return slots.front();
+}
+
+std::vector<TimeSlot> SchedulerCore::nextAvailableSlots(int64_t start_key, size_t count) const
+{
+    std::vector<TimeSlot> slots;
+    if (count == 0)
+        return slots;
+    int64_t day = dayOfKey(start_key);
+    appendOpenSlots(day, start_key, count, &slots);
+    while (slots.size() < count)
+    {
+        day = nextOpenDay(day);
+        if (day == std::numeric_limits<int64_t>::max())
+            break;
+        appendOpenSlots(day, makeStartKey(day, 0), count - slots.size(), &slots);
+    }
+    return slots;
+}
+
+std::optional<TimeSlot> SchedulerCore::findSlot(int slot_id) const
+{
+    if (!isValidSlotId(slot_id))
+        return std::nullopt;
+    return slotView(static_cast<SlotHandle>(slot_id - 1));
+}
+
+std::optional<TimeSlot> SchedulerCore::findSlotAt(int64_t start_key, int lane) const
+{
+    SlotHandle handle;
+    if (!hasSlotAt(start_key, lane, &handle))
+        return std::nullopt;
+    return slotView(handle);
+}
+
+void SchedulerCore::reserveSlots(size_t count)
+{
+    size_t total = slot_start_keys_.size() + count;
+    if (total <= slot_start_keys_.capacity())
+        return;
+    // Grow geometrically so repeated bulk loads (e.g. chunked imports) stay amortized O(n)
+    total = std::max(total, slot_start_keys_.capacity() * 2);
+    slot_start_keys_.reserve(total);
+    slot_lanes_.reserve(total);
+    slot_capacities_.reserve(total);
+    slot_booked_counts_.reserve(total);
+    slot_heap_positions_.reserve(total);
+    slot_handles_by_start_.reserve(total);
+}
+
+const Patient *SchedulerCore::findBooking(int booking_id) const
+{
+    auto it = booking_positions_.find(booking_id);
+    return it == booking_positions_.end() ? nullptr : &patient_bookings_[it->second];
+}
+
+const Patient *SchedulerCore::findBookingForSlot(int slot_id) const
+{
+    auto it = booking_ids_by_slot_.find(slot_id);
+    return it == booking_ids_by_slot_.end() ? nullptr : findBooking(it->second);
+}
+
+SchedulerCounters SchedulerCore::counters() const
+{
+    SchedulerCounters counters;
+    counters.slots = slotCount();
+    counters.bookings = patient_bookings_.size();
+    // Every slot with a seat left is open, whether or not its day heap exists yet
+    counters.open_slots = counters.slots - full_slot_count_;
+    if (image_ && !image_seats_known_)
+    {
+        image_seats_ = 0;
+        for (SlotHandle handle = 0; handle < image_slot_count_; ++handle)
+            image_seats_ += static_cast<size_t>(capacityOf(handle));
+        image_seats_known_ = true;
+    }
+    counters.seats = (image_ ? image_seats_ : 0) + arena_seats_;
+    counters.waitlisted = waitlist_.size();
+    counters.archived = archived_booking_count_;
+    counters.day_heaps = slotsByDate_.size();
+    for (const auto &date : slotsByDate_)
+    {
+        counters.largest_day_heap = std::max(counters.largest_day_heap, date.second.size());
+        if (date.second.empty())
+            ++counters.empty_day_heaps;
+    }
+    return counters;
+}
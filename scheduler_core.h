@@ -0,0 +1,436 @@
+#ifndef SCHEDULER_CORE_H
+#define SCHEDULER_CORE_H
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include "slot_time.h"
+#include "indexed_heap.h"
+#include "availability_bitmap.h"
+#include "availability_totals.h"
+#include "scheduler_waitlist.h"
+
+// Forward declarations
+class TimeSlot;
+class Patient;
+class SchedulerCore;
+class ScheduleImage;
+
+// Index into SchedulerCore's slots (mapped image first, then the arena); the public slot id is handle + 1
+typedef uint32_t SlotHandle;
+
+/**
+ * @brief TimeSlot class represents a Covid test appointment slot
+ *
+ * A lightweight value view; the slot itself lives in SchedulerCore's
+ * structure-of-arrays slot arena. A slot seats capacity patients and counts
+ * as booked once every seat is taken.
+ */
+class TimeSlot
+{
+public:
+    TimeSlot(int id, int64_t start_key, int lane = 1, bool booked = false);
+    TimeSlot(int id, int64_t start_key, int lane, int capacity, int booked_count);
+
+    int getId() const { return id_; }
+    int64_t getStartKey() const { return start_key_; }
+    int getLane() const { return lane_; }
+    int64_t getDay() const { return dayOfKey(start_key_); }
+    std::string getTime() const { return formatSlotTime(minuteOfKey(start_key_)); }
+    std::string getDate() const { return formatSlotDate(getDay()); }
+    std::string getDateTime() const { return getDate() + " " + getTime(); }
+    bool isBooked() const { return booked_count_ >= capacity_; } // no seat left
+    int getCapacity() const { return capacity_; }
+    int getBookedCount() const { return booked_count_; }
+    int getSeatsLeft() const { return capacity_ - booked_count_; }
+
+    // Comparison operators for min-heap (earlier time has higher priority)
+    bool operator>(const TimeSlot &other) const;
+    bool operator<(const TimeSlot &other) const;
+    bool operator==(const TimeSlot &other) const;
+
+private:
+    int id_;
+    int64_t start_key_; // minutes since epoch, display strings are derived on demand
+    int lane_;          // 1-based swab lane; slots at the same time differ by lane
+    int capacity_;      // seats; one booking takes one seat
+    int booked_count_;
+};
+
+/**
+ * @brief Patient class represents a patient booking
+ *
+ * Stored by value in SchedulerCore's dense booking pool and linked to its
+ * slot by id rather than by pointer.
+ */
+class Patient
+{
+public:
+    Patient(int booking_id, const std::string &name, int age, int slot_id);
+    Patient(int booking_id, const std::string &name, int age, int slot_id, int64_t booked_at);
+
+    int getBookingId() const { return booking_id_; }
+    const std::string &getName() const { return name_; }
+    int getAge() const { return age_; }
+    int getSlotId() const { return slot_id_; }
+    int64_t getBookedAt() const { return booked_at_; } // seconds since epoch
+
+private:
+    int booking_id_;
+    int slot_id_;
+    int64_t booked_at_;
+    std::string name_;
+    int age_;
+};
+
+/**
+ * @brief Daily opening window [start_minute, end_minute) for recurring slots
+ */
+struct SlotWindow
+{
+    int start_minute;
+    int end_minute;
+};
+
+/**
+ * @brief Describes a block of recurring slots for SchedulerCore::addRecurringSlots
+ */
+struct RecurringSlotSpec
+{
+    int64_t first_day = 0;           // day numbers, inclusive
+    int64_t last_day = 0;
+    unsigned weekday_mask = 0x7f;    // bit 0 = Monday ... bit 6 = Sunday
+    std::vector<SlotWindow> windows; // slot starts at every interval inside each window
+    int interval_minutes = 30;
+    int lanes = 1;
+    int capacity = 1; // seats per generated slot
+};
+
+/**
+ * @brief A slot to create in a SchedulerCore::addSlots batch
+ */
+struct SlotKey
+{
+    int64_t start_key;
+    int lane;
+    int capacity = 1;
+};
+
+/**
+ * @brief Size counters for monitoring; see SchedulerCore::counters
+ */
+struct SchedulerCounters
+{
+    size_t slots = 0;
+    size_t bookings = 0;
+    size_t open_slots = 0;       // slots with at least one seat left
+    size_t seats = 0;            // capacity summed over all slots
+    size_t day_heaps = 0;        // dates with a materialized heap
+    size_t largest_day_heap = 0; // open slots on the fullest materialized date
+    size_t empty_day_heaps = 0;  // materialized dates with every seat booked
+    size_t waitlisted = 0;
+    size_t archived = 0; // bookings moved out by pruneStep, since the journal began
+};
+
+/**
+ * @brief Outcome of a SchedulerCore operation
+ */
+enum class SchedulerResult
+{
+    Ok,
+    InvalidDate,
+    InvalidTime,
+    DuplicateSlot,
+    InvalidPatient,
+    NoSuchSlot,
+    SlotUnavailable,
+    NoSuchBooking,
+    InvalidRecurrence,
+    InvalidCapacity,
+    InvalidWaitlistRange,
+    NoSuchWaitlistEntry,
+    ExpiredDate,
+    StorageFailed // applied in memory, but the journal could not make it durable
+};
+
+const char *schedulerResultText(SchedulerResult result);
+
+/**
+ * @brief Receives fine-grained change events from SchedulerCore
+ *
+ * Events fire after the core has applied the change. Views use them to insert
+ * or remove a single row instead of rebuilding everything.
+ */
+class SchedulerListener
+{
+public:
+    virtual ~SchedulerListener() {}
+
+    virtual void slotAdded(const TimeSlot &) {}
+    virtual void slotBooked(const TimeSlot &, const Patient &) {}
+    virtual void slotReleased(const TimeSlot &) {}
+    // position is where the booking sat in bookings(); the last booking has been moved there
+    virtual void bookingRemoved(const Patient &, size_t) {}
+    // pruneStep is about to archive a booking on an expired date; returning false keeps it live
+    // for a later step, e.g. because the archive could not store it
+    virtual bool storeArchived(const Patient &) { return true; }
+    // A booking on an expired date left bookings() for the archive; position as for bookingRemoved
+    virtual void bookingArchived(const Patient &, size_t) {}
+    // A bulk load added slots to days in [spec.first_day, spec.last_day]; no per-slot events follow
+    virtual void slotsAdded(const RecurringSlotSpec &) {}
+    // A batch load created slot ids [first_slot_id, first_slot_id + count); no per-slot events follow
+    virtual void slotsImported(int, size_t) {}
+    virtual void waitlistAdded(const WaitlistEntry &) {}
+    // booking_id is the booking that gave the patient a seat, or 0 when the entry was withdrawn
+    virtual void waitlistRemoved(const WaitlistEntry &, int) {}
+    // pruneStep dropped a waiting patient whose whole date range has passed
+    virtual void waitlistExpired(const WaitlistEntry &) {}
+    // setRetentionFloor moved the floor up to day
+    virtual void retentionFloorRaised(int64_t) {}
+};
+
+/**
+ * @brief GUI-free scheduling engine
+ *
+ * Owns the per-date min-heaps of open slots, the slot table and the patient
+ * bookings. Every operation reports a SchedulerResult instead of showing
+ * dialogs, so the same engine serves the window, bulk jobs and benchmarks.
+ *
+ * An optional ScheduleImage supplies a read-only base calendar: its slots take
+ * the first handles, untouched days are answered straight from the mapping,
+ * and a day gets its own heap only when it is first changed.
+ */
+class SchedulerCore
+{
+public:
+    static constexpr int kMaxLanes = 64;
+    static constexpr int kMaxCapacity = 65535; // seats per slot
+
+    SchedulerCore();
+    // Heaps keep a pointer to the shared position array, so the core is not copyable
+    SchedulerCore(const SchedulerCore &) = delete;
+    SchedulerCore &operator=(const SchedulerCore &) = delete;
+
+    // Attaches a mapped base calendar; only allowed while the core is empty.
+    // The image must stay open for the lifetime of the core.
+    bool attachImage(const ScheduleImage *image);
+    const ScheduleImage *image() const { return image_; }
+    size_t imageSlotCount() const { return image_slot_count_; }
+
+    void addListener(SchedulerListener *listener);
+    void removeListener(SchedulerListener *listener);
+
+    // Dates outside kFirstSlotDay..kLastSlotDay (slot_time.h) are rejected with InvalidDate
+    SchedulerResult addSlot(const std::string &date, const std::string &time, int *slot_id = nullptr);
+    SchedulerResult addSlot(int64_t start_key, int *slot_id = nullptr);
+    SchedulerResult addSlot(int64_t start_key, int lane, int *slot_id);
+    // A slot with several seats stays open, and in its date heap, until every seat is booked
+    SchedulerResult addSlot(const std::string &date, const std::string &time, int capacity, int *slot_id);
+    SchedulerResult addSlot(int64_t start_key, int lane, int capacity, int *slot_id);
+    // Generates a recurring block in one pass; existing (time, lane) pairs and expired dates are skipped
+    SchedulerResult addRecurringSlots(const RecurringSlotSpec &spec, size_t *added = nullptr, size_t *duplicates = nullptr);
+    // Inserts a batch ordered by start key, with one heapify per date; duplicates
+    // (within the batch or already present) are skipped and invalid lanes, capacities or dates rejected
+    SchedulerResult addSlots(std::vector<SlotKey> slots, size_t *added = nullptr, size_t *duplicates = nullptr);
+    SchedulerResult bookSlot(int slot_id, const std::string &patient_name, int patient_age, int *booking_id = nullptr);
+    // Hands the released seat to the best waiting patient for its date, if any, in the same call;
+    // bookings on expired dates are refused with ExpiredDate until pruneStep archives them
+    SchedulerResult cancelBooking(int booking_id, int *reassigned_booking_id = nullptr);
+
+    // Patients waiting for a seat on any date in [first_day, last_day] (at most
+    // SchedulerWaitlist::kMaxDays); higher priority first, then first come
+    SchedulerResult addToWaitlist(const std::string &patient_name, int patient_age, int64_t first_day, int64_t last_day,
+                                  int priority = 0, int *waitlist_id = nullptr);
+    SchedulerResult removeFromWaitlist(int waitlist_id);
+    const SchedulerWaitlist &waitlist() const { return waitlist_; }
+
+    // Retention: dates before the floor have expired, and new slots, bookings or waiting
+    // patients on them are refused. Each pruneStep does about budget units of work evicting
+    // them (their date heaps, bitmap blocks, slot index entries, date, week and month totals
+    // and waitlist heaps), moves bookings on them out of bookings() with a bookingArchived
+    // event each and drops waiting patients whose range has passed with a waitlistExpired
+    // event each; it returns false once nothing is left to do. Slot rows stay, so ids are
+    // stable. Expired dates are swept once, so raising the floor only costs the new dates.
+    // Each raise is a retentionFloorRaised event, which the journal persists.
+    void setRetentionFloor(int64_t day);
+    int64_t retentionFloor() const { return retention_floor_; }
+    // spent reports the units used; 0 when the floor has nothing left to sweep
+    bool pruneStep(size_t budget, size_t *archived = nullptr, size_t *spent = nullptr);
+
+    // Recovery helpers: re-create a booking with its original id and timestamp,
+    // and keep new booking ids above every id handed out before a restart
+    SchedulerResult restoreBooking(Patient booking);
+    int nextBookingId() const { return next_booking_id_; }
+    void setNextBookingId(int next_booking_id);
+    // Journal replay: the reassignment that followed a cancellation has its own records
+    SchedulerResult restoreCancellation(int booking_id);
+    SchedulerResult restoreWaitlistEntry(const WaitlistEntry &entry);
+    SchedulerResult restoreArchival(int booking_id);
+    // (slot id, seats still held by archived bookings) in slot id order, so snapshots keep past
+    // slots full; derived from booked counts, so archiving keeps nothing per slot
+    std::vector<std::pair<int, int>> archivedSeats() const;
+    SchedulerResult restoreArchivedSeats(int slot_id, int seats);
+    void setNextWaitlistId(int next_waitlist_id) { waitlist_.setNextId(next_waitlist_id); }
+
+    // Open slots for a day (see dayOfKey), earliest first
+    std::vector<TimeSlot> availableSlots(int64_t day) const;
+    size_t availableCount(int64_t day) const;
+    size_t availableSeats(int64_t day) const; // seats left over the day's open slots
+    // Open slots over an inclusive date range: a popcount over the availability bitmap,
+    // one contiguous run of words per lane, plus untouched image days from the mapping
+    size_t availableCount(int64_t first_day, int64_t last_day) const;
+    std::vector<size_t> availableCountsByDay(int64_t first_day, int64_t last_day) const;
+    // Open and booked counters per date, week and month, kept current on every change
+    const AvailabilityAggregates &aggregates() const { return aggregates_; }
+    std::optional<TimeSlot> earliestSlot(int64_t day) const; // heap top, O(1)
+    // Across dates: the first open slots starting at or after start_key, earliest first.
+    // O(log n) per date visited, plus a scan of start_key's own date when its top is earlier.
+    std::optional<TimeSlot> earliestSlotAfter(int64_t start_key) const;
+    std::vector<TimeSlot> nextAvailableSlots(int64_t start_key, size_t count) const;
+
+    std::optional<TimeSlot> findSlot(int slot_id) const;
+    std::optional<TimeSlot> findSlotAt(int64_t start_key, int lane = 1) const;
+    void reserveSlots(size_t count); // pre-size storage before bulk loads
+    // Pointers into the booking pool stay valid until the next book or cancel
+    const Patient *findBooking(int booking_id) const;
+    const Patient *findBookingForSlot(int slot_id) const; // any one of the slot's bookings
+    // Live bookings in dense storage; cancelling moves the last booking into the freed position
+    const std::vector<Patient> &bookings() const { return patient_bookings_; }
+    size_t slotCount() const { return image_slot_count_ + slot_start_keys_.size(); }
+    SchedulerCounters counters() const; // O(dates with a heap)
+
+private:
+    static constexpr uint32_t kNotInHeap = 0xffffffffu;
+    static int64_t slotIndexKey(int64_t start_key, int lane) { return start_key * kMaxLanes + (lane - 1); }
+
+    // Heap entries carry the start key so sifting never leaves the heap array
+    struct SlotHeapEntry
+    {
+        int64_t start_key;
+        SlotHandle handle;
+    };
+
+    struct SlotHeapEntryGreater
+    {
+        bool operator()(const SlotHeapEntry &a, const SlotHeapEntry &b) const
+        {
+            if (a.start_key != b.start_key)
+                return a.start_key > b.start_key;
+            return a.handle > b.handle; // Min-heap: smaller element has higher priority
+        }
+    };
+
+    struct SlotHeapEntryHandle
+    {
+        SlotHandle operator()(const SlotHeapEntry &entry) const { return entry.handle; }
+    };
+
+    // Every slot sits in at most one date heap, so all heaps share one dense position
+    // array for arena slots; image slots only get an entry once their day is materialized
+    class SlotHeapPositions
+    {
+    public:
+        explicit SlotHeapPositions(SchedulerCore *core = nullptr) : core_(core) {}
+        bool contains(SlotHandle handle) const
+        {
+            if (handle < core_->image_slot_count_)
+                return core_->image_heap_positions_.count(handle) != 0;
+            return core_->slot_heap_positions_[handle - core_->image_slot_count_] != kNotInHeap;
+        }
+        size_t get(SlotHandle handle) const
+        {
+            if (handle < core_->image_slot_count_)
+                return core_->image_heap_positions_.find(handle)->second;
+            return core_->slot_heap_positions_[handle - core_->image_slot_count_];
+        }
+        void set(SlotHandle handle, size_t position)
+        {
+            if (handle < core_->image_slot_count_)
+                core_->image_heap_positions_[handle] = static_cast<uint32_t>(position);
+            else
+                core_->slot_heap_positions_[handle - core_->image_slot_count_] = static_cast<uint32_t>(position);
+        }
+        void erase(SlotHandle handle)
+        {
+            if (handle < core_->image_slot_count_)
+                core_->image_heap_positions_.erase(handle);
+            else
+                core_->slot_heap_positions_[handle - core_->image_slot_count_] = kNotInHeap;
+        }
+        void reserve(size_t) {}
+
+    private:
+        SchedulerCore *core_;
+    };
+
+    using SlotHeap = IndexedHeap<SlotHeapEntry, SlotHeapEntryGreater, SlotHeapEntryHandle, 4, SlotHeapPositions>;
+
+    SlotHeap &heapForDay(int64_t day); // materializes image days on first change
+    void updateOpenDay(int64_t day, const SlotHeap &heap); // after every heap change
+    std::pair<size_t, size_t> untouchedImageRange(int64_t day) const; // image records of a day without a heap
+    int64_t nextOpenDay(int64_t day) const; // first later date with an open slot, or INT64_MAX
+    void appendOpenSlots(int64_t day, int64_t from_key, size_t count, std::vector<TimeSlot> *slots) const;
+    SlotHandle createSlot(int64_t start_key, int lane, int capacity);
+    TimeSlot slotView(SlotHandle handle) const;
+    int64_t startKeyOf(SlotHandle handle) const;
+    int laneOf(SlotHandle handle) const;
+    int capacityOf(SlotHandle handle) const;
+    int bookedCountOf(SlotHandle handle) const;
+    bool isBookedHandle(SlotHandle handle) const { return bookedCountOf(handle) >= capacityOf(handle); }
+    void setBookedCount(SlotHandle handle, int booked_count);
+    Patient detachBooking(size_t position); // swap-removes from bookings() and its indexes
+    void archiveBooking(size_t position); // detaches, keeping the seat taken
+    bool hasSlotAt(int64_t start_key, int lane, SlotHandle *handle = nullptr) const;
+    bool isValidSlotId(int slot_id) const { return slot_id >= 1 && static_cast<size_t>(slot_id) <= slotCount(); }
+
+    // Per-date min-heaps of open slots, keyed by day number
+    std::map<int64_t, SlotHeap> slotsByDate_;
+    // Ordered index of the dates whose heap is non-empty; each heap's top is that date's
+    // minimum, and dates do not overlap, so together they order every open slot
+    std::set<int64_t> open_days_;
+    // Bit per open slot on every date with a heap, for range counts and in-order scans of a day
+    AvailabilityBitmap open_bitmap_;
+    AvailabilityAggregates aggregates_;
+
+    // Read-only base calendar; handles below image_slot_count_ refer to its records
+    const ScheduleImage *image_;
+    SlotHandle image_slot_count_;
+    std::unordered_map<SlotHandle, uint16_t> image_booked_counts_;  // overlay of image slots with bookings
+    std::unordered_map<SlotHandle, uint32_t> image_heap_positions_; // image slots in materialized day heaps
+
+    // Slot arena, structure-of-arrays indexed by SlotHandle - image_slot_count_
+    std::vector<int64_t> slot_start_keys_;
+    std::vector<uint8_t> slot_lanes_;
+    std::vector<uint16_t> slot_capacities_;
+    std::vector<uint16_t> slot_booked_counts_;
+    std::vector<uint32_t> slot_heap_positions_; // kNotInHeap while every seat is booked
+    std::unordered_map<int64_t, SlotHandle> slot_handles_by_start_; // slotIndexKey(start, lane) -> handle, for O(1) duplicate checks
+
+    std::vector<Patient> patient_bookings_;
+    std::unordered_map<int, size_t> booking_positions_; // booking id -> index in patient_bookings_
+    std::unordered_multimap<int, int> booking_ids_by_slot_; // slot id -> booking ids
+
+    // Kept up to date for counters(); image seats are summed on first use
+    size_t full_slot_count_;
+    size_t arena_seats_;
+    mutable size_t image_seats_;
+    mutable bool image_seats_known_;
+
+    std::vector<SchedulerListener *> listeners_;
+
+    int next_booking_id_;
+    int64_t retention_floor_;
+    size_t booking_prune_cursor_; // next bookings() position to check against the floor
+    int64_t index_prune_day_;     // dates before this have no slot index entries or totals left
+    int index_prune_minute_;      // next minute of index_prune_day_ to probe
+    size_t index_prune_found_;    // arena slots of index_prune_day_ already dropped from the index
+    size_t archived_booking_count_;
+    SchedulerWaitlist waitlist_;
+};
+
+#endif // SCHEDULER_CORE_H
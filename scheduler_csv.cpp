@@ -0,0 +1,325 @@
+#include "scheduler_csv.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+const size_t kMinBytesPerThread = 256 << 10; // smaller chunks are not worth a thread
+const size_t kExportBufferBytes = 64 << 10;
+
+// Parsed rows of one line-aligned piece of a chunk
+struct ParsedPart
+{
+    std::vector<SlotKey> slots;
+    size_t lines = 0;
+    size_t rows = 0;
+    size_t rejected = 0;
+    size_t first_rejected_line = 0; // 1-based within the part
+};
+
+// Reads one field up to the next comma; trims blanks and unquotes "..." fields
+const char *nextField(const char *p, const char *end, std::string *field)
+{
+    field->clear();
+    while (p < end && (*p == ' ' || *p == '\t'))
+        ++p;
+    if (p < end && *p == '"')
+    {
+        for (++p; p < end; ++p)
+        {
+            if (*p == '"')
+            {
+                if (p + 1 < end && p[1] == '"')
+                    ++p;
+                else
+                {
+                    ++p;
+                    break;
+                }
+            }
+            field->push_back(*p);
+        }
+    }
+    else
+    {
+        const char *start = p;
+        while (p < end && *p != ',')
+            ++p;
+        const char *stop = p;
+        while (stop > start && (stop[-1] == ' ' || stop[-1] == '\t'))
+            --stop;
+        field->assign(start, stop);
+    }
+    while (p < end && *p != ',')
+        ++p;
+    return p < end ? p + 1 : p;
+}
+
+// Optional small decimal column; empty keeps the default
+bool parseCount(const std::string &text, size_t max_digits, int low, int high, int *value)
+{
+    if (text.empty())
+        return true;
+    if (text.size() > max_digits || !std::all_of(text.begin(), text.end(), [](char c)
+                                                 { return c >= '0' && c <= '9'; }))
+        return false;
+    *value = std::stoi(text);
+    return *value >= low && *value <= high;
+}
+
+bool parseSlotLine(const char *p, const char *end, SlotKey *slot)
+{
+    std::string date, time, lane, capacity;
+    p = nextField(p, end, &date);
+    p = nextField(p, end, &time);
+    p = nextField(p, end, &lane);
+    nextField(p, end, &capacity);
+
+    int64_t day;
+    int minute_of_day;
+    if (!parseSlotDate(date, &day) || !isSlotDay(day) || !parseSlotTime(time, &minute_of_day))
+        return false;
+    slot->start_key = makeStartKey(day, minute_of_day);
+    slot->lane = 1;
+    slot->capacity = 1;
+    return parseCount(lane, 2, 1, SchedulerCore::kMaxLanes, &slot->lane) &&
+           parseCount(capacity, 5, 1, SchedulerCore::kMaxCapacity, &slot->capacity);
+}
+
+const char *lineEnd(const char *p, const char *end)
+{
+    const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    return newline ? newline : end;
+}
+
+void parsePart(const char *p, const char *end, ParsedPart *part)
+{
+    part->slots.reserve((end - p) / 20);
+    while (p < end)
+    {
+        const char *stop = lineEnd(p, end);
+        const char *content_end = (stop > p && stop[-1] == '\r') ? stop - 1 : stop;
+        ++part->lines;
+        if (content_end > p)
+        {
+            ++part->rows;
+            SlotKey slot;
+            if (parseSlotLine(p, content_end, &slot))
+                part->slots.push_back(slot);
+            else if (part->rejected++ == 0)
+                part->first_rejected_line = part->lines;
+        }
+        p = stop < end ? stop + 1 : end;
+    }
+}
+
+void appendCsvField(std::string *out, const std::string &value)
+{
+    if (value.find_first_of(",\"\r\n") == std::string::npos)
+    {
+        out->append(value);
+        return;
+    }
+    out->push_back('"');
+    for (char c : value)
+    {
+        if (c == '"')
+            out->push_back('"');
+        out->push_back(c);
+    }
+    out->push_back('"');
+}
+} // namespace
+
+bool readSlotsCsv(const std::string &path, const CsvSlotSink &sink, CsvImportStats *stats, std::string *error,
+                  const CsvImportOptions &options)
+{
+    std::string ignored;
+    if (!error)
+        error = &ignored;
+    *stats = CsvImportStats();
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        *error = "cannot open " + path;
+        return false;
+    }
+
+    unsigned max_threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    size_t chunk_bytes = std::max<size_t>(options.chunk_bytes, 4096);
+    std::string buffer; // unconsumed partial line, then the next chunk
+    size_t line_number = 0;
+    bool at_start = true;
+    bool eof = false;
+    while (!eof)
+    {
+        size_t carried = buffer.size();
+        buffer.resize(carried + chunk_bytes);
+        size_t count = std::fread(&buffer[carried], 1, chunk_bytes, file);
+        buffer.resize(carried + count);
+        if (count < chunk_bytes)
+        {
+            if (std::ferror(file))
+            {
+                std::fclose(file);
+                *error = "read error in " + path;
+                return false;
+            }
+            eof = true;
+        }
+
+        // Only whole lines are parsed; the tail waits for the next chunk
+        size_t usable = buffer.size();
+        if (!eof)
+        {
+            size_t last_newline = buffer.rfind('\n');
+            if (last_newline == std::string::npos)
+                continue;
+            usable = last_newline + 1;
+        }
+
+        const char *begin = buffer.data();
+        const char *end = begin + usable;
+        if (at_start && begin < end)
+        {
+            at_start = false;
+            const char *stop = lineEnd(begin, end);
+            SlotKey slot;
+            if (!parseSlotLine(begin, (stop > begin && stop[-1] == '\r') ? stop - 1 : stop, &slot))
+            {
+                begin = stop < end ? stop + 1 : end; // header row
+                ++line_number;
+            }
+        }
+
+        // Split the chunk into line-aligned parts, one per thread
+        size_t parts = std::min<size_t>(max_threads, (end - begin) / kMinBytesPerThread + 1);
+        std::vector<const char *> bounds(1, begin);
+        for (size_t i = 1; i < parts; ++i)
+        {
+            const char *target = begin + (end - begin) * i / parts;
+            target = std::max(target, bounds.back());
+            const char *stop = lineEnd(target, end);
+            bounds.push_back(stop < end ? stop + 1 : end);
+        }
+        bounds.push_back(end);
+
+        std::vector<ParsedPart> parsed(parts);
+        std::vector<std::thread> workers;
+        for (size_t i = 1; i < parts; ++i)
+            workers.emplace_back(parsePart, bounds[i], bounds[i + 1], &parsed[i]);
+        parsePart(bounds[0], bounds[1], &parsed[0]);
+        for (std::thread &worker : workers)
+            worker.join();
+
+        std::vector<SlotKey> slots;
+        size_t total = 0;
+        for (const ParsedPart &part : parsed)
+            total += part.slots.size();
+        slots.reserve(total);
+        for (const ParsedPart &part : parsed)
+        {
+            slots.insert(slots.end(), part.slots.begin(), part.slots.end());
+            stats->rows += part.rows;
+            if (part.rejected > 0 && stats->rejected == 0)
+                stats->first_rejected_line = line_number + part.first_rejected_line;
+            stats->rejected += part.rejected;
+            line_number += part.lines;
+        }
+
+        size_t added = 0, duplicates = 0;
+        SchedulerResult result = sink(std::move(slots), &added, &duplicates);
+        if (result != SchedulerResult::Ok)
+        {
+            std::fclose(file);
+            *error = schedulerResultText(result);
+            return false;
+        }
+        stats->added += added;
+        stats->duplicates += duplicates;
+        buffer.erase(0, usable);
+    }
+    std::fclose(file);
+    return true;
+}
+
+bool importSlotsCsv(const std::string &path, SchedulerCore *core, CsvImportStats *stats, std::string *error,
+                    const CsvImportOptions &options)
+{
+    return readSlotsCsv(
+        path, [core](std::vector<SlotKey> slots, size_t *added, size_t *duplicates)
+        { return core->addSlots(std::move(slots), added, duplicates); },
+        stats, error, options);
+}
+
+bool exportBookingsCsv(const std::string &path, const SchedulerCore &core, size_t *rows, std::string *error)
+{
+    std::string ignored;
+    if (!error)
+        error = &ignored;
+    FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file)
+    {
+        *error = "cannot create " + path;
+        return false;
+    }
+
+    // Order by slot through an index of positions rather than copying the bookings
+    const std::vector<Patient> &bookings = core.bookings();
+    std::vector<std::pair<int64_t, uint32_t>> order; // (start key * 64 + lane, position)
+    order.reserve(bookings.size());
+    for (size_t position = 0; position < bookings.size(); ++position)
+    {
+        auto slot = core.findSlot(bookings[position].getSlotId());
+        int64_t key = slot ? slot->getStartKey() * 64 + slot->getLane() : INT64_MAX;
+        order.emplace_back(key, static_cast<uint32_t>(position));
+    }
+    std::sort(order.begin(), order.end());
+
+    std::string buffer = "date,time,lane,booking_id,patient_name,age\n";
+    buffer.reserve(kExportBufferBytes + 256);
+    bool ok = true;
+    for (const auto &entry : order)
+    {
+        const Patient &booking = bookings[entry.second];
+        auto slot = core.findSlot(booking.getSlotId());
+        if (slot)
+        {
+            buffer.append(slot->getDate()).push_back(',');
+            buffer.append(slot->getTime()).push_back(',');
+            buffer.append(std::to_string(slot->getLane()));
+        }
+        else
+        {
+            buffer.append(",,");
+        }
+        buffer.push_back(',');
+        buffer.append(std::to_string(booking.getBookingId())).push_back(',');
+        appendCsvField(&buffer, booking.getName());
+        buffer.push_back(',');
+        buffer.append(std::to_string(booking.getAge())).push_back('\n');
+
+        if (buffer.size() >= kExportBufferBytes)
+        {
+            ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+            buffer.clear();
+            if (!ok)
+                break;
+        }
+    }
+    if (ok)
+        ok = std::fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok)
+    {
+        *error = "write error in " + path;
+        return false;
+    }
+    if (rows)
+        *rows = order.size();
+    return true;
+}
@@ -0,0 +1,50 @@
+#ifndef SCHEDULER_CSV_H
+#define SCHEDULER_CSV_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+#include "scheduler_core.h"
+
+/**
+ * @brief Tuning for importSlotsCsv
+ */
+struct CsvImportOptions
+{
+    size_t chunk_bytes = 4 << 20; // read and insert the file this many bytes at a time
+    unsigned threads = 0;         // parser threads per chunk; 0 = hardware concurrency
+};
+
+/**
+ * @brief Outcome counters of a CSV slot import
+ */
+struct CsvImportStats
+{
+    size_t rows = 0;       // data rows read, excluding a header row
+    size_t added = 0;
+    size_t duplicates = 0; // already scheduled, or repeated in the file
+    size_t rejected = 0;   // malformed date, time, lane or capacity
+    size_t first_rejected_line = 0;
+};
+
+// Inserts one parsed chunk, as SchedulerCore::addSlots does; an error result stops the import
+typedef std::function<SchedulerResult(std::vector<SlotKey> slots, size_t *added, size_t *duplicates)> CsvSlotSink;
+
+// Streams "date,time[,lane[,capacity]]" rows (yyyy-MM-dd, hh:mm, lane and capacity default to 1) into
+// sink. The file is read in chunks; each chunk is split at line boundaries,
+// parsed on several threads and handed to sink in one call, so a caller that
+// locks the core only inside sink holds the lock for one insert at a time.
+// A first line that does not parse is taken as a header.
+bool readSlotsCsv(const std::string &path, const CsvSlotSink &sink, CsvImportStats *stats,
+                  std::string *error = nullptr, const CsvImportOptions &options = CsvImportOptions());
+// readSlotsCsv straight into core
+bool importSlotsCsv(const std::string &path, SchedulerCore *core, CsvImportStats *stats,
+                    std::string *error = nullptr, const CsvImportOptions &options = CsvImportOptions());
+
+// Writes a run sheet of all bookings ordered by slot time, then lane, through a
+// fixed-size buffer. Columns: date, time, lane, booking id, patient name, age.
+bool exportBookingsCsv(const std::string &path, const SchedulerCore &core, size_t *rows = nullptr,
+                       std::string *error = nullptr);
+
+#endif // SCHEDULER_CSV_H
@@ -0,0 +1,758 @@
+#include "scheduler_journal.h"
+#include "schedule_image.h"
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace
+{
+const char kSnapshotMagic[4] = {'C', 'T', 'S', 'S'};
+const uint32_t kSnapshotVersion = 6; // 2: records the base ScheduleImage identity; 3: slot capacities; 4: waitlist; 5: archived seats; 6: retention floor
+const size_t kRecordHeaderSize = 4 + 4 + 1 + 8; // length, crc, type, sequence
+
+int64_t nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+std::array<uint32_t, 256> makeCrcTable()
+{
+    std::array<uint32_t, 256> table;
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t value = i;
+        for (int bit = 0; bit < 8; ++bit)
+            value = (value & 1) ? 0xedb88320u ^ (value >> 1) : value >> 1;
+        table[i] = value;
+    }
+    return table;
+}
+
+uint32_t crc32(const char *data, size_t size, uint32_t crc = 0)
+{
+    static const std::array<uint32_t, 256> table = makeCrcTable();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+bool syncFile(FILE *file)
+{
+    if (std::fflush(file) != 0)
+        return false;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#elif defined(__linux__)
+    return fdatasync(fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Little-endian field encoding shared by journal records and snapshots
+template <typename T>
+void put(std::string *out, T value)
+{
+    out->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void putString(std::string *out, const std::string &value)
+{
+    put<uint32_t>(out, static_cast<uint32_t>(value.size()));
+    out->append(value);
+}
+
+class Reader
+{
+public:
+    Reader(const char *data, size_t size) : data_(data), size_(size), offset_(0) {}
+
+    template <typename T>
+    bool get(T *value)
+    {
+        if (size_ - offset_ < sizeof(T))
+            return false;
+        std::memcpy(value, data_ + offset_, sizeof(T));
+        offset_ += sizeof(T);
+        return true;
+    }
+
+    bool atEnd() const { return offset_ == size_; }
+
+    bool getString(std::string *value)
+    {
+        uint32_t length;
+        if (!get(&length) || size_ - offset_ < length)
+            return false;
+        value->assign(data_ + offset_, length);
+        offset_ += length;
+        return true;
+    }
+
+private:
+    const char *data_;
+    size_t size_;
+    size_t offset_;
+};
+
+void encodeBooking(std::string *out, const Patient &booking)
+{
+    put<int32_t>(out, booking.getBookingId());
+    put<int32_t>(out, booking.getSlotId());
+    put<int32_t>(out, booking.getAge());
+    put<int64_t>(out, booking.getBookedAt());
+    putString(out, booking.getName());
+}
+
+bool decodeBooking(Reader *reader, int32_t *booking_id, int32_t *slot_id, int32_t *age, int64_t *booked_at, std::string *name)
+{
+    return reader->get(booking_id) && reader->get(slot_id) && reader->get(age) && reader->get(booked_at) &&
+           reader->getString(name);
+}
+
+void encodeWaitlistEntry(std::string *out, const WaitlistEntry &entry)
+{
+    put<int32_t>(out, entry.waitlist_id);
+    put<int32_t>(out, entry.patient_age);
+    put<int32_t>(out, entry.priority);
+    put<int64_t>(out, entry.requested_at);
+    put<int64_t>(out, entry.first_day);
+    put<int64_t>(out, entry.last_day);
+    putString(out, entry.patient_name);
+}
+
+bool decodeWaitlistEntry(Reader *reader, WaitlistEntry *entry)
+{
+    int32_t waitlist_id, age, priority;
+    if (!reader->get(&waitlist_id) || !reader->get(&age) || !reader->get(&priority) ||
+        !reader->get(&entry->requested_at) || !reader->get(&entry->first_day) || !reader->get(&entry->last_day) ||
+        !reader->getString(&entry->patient_name))
+        return false;
+    entry->waitlist_id = waitlist_id;
+    entry->patient_age = age;
+    entry->priority = priority;
+    return true;
+}
+
+bool readFile(const std::string &path, std::string *contents)
+{
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+        return false;
+    contents->clear();
+    char buffer[1 << 16];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        contents->append(buffer, count);
+    std::fclose(file);
+    return true;
+}
+} // namespace
+
+SchedulerJournal::SchedulerJournal(const JournalOptions &options)
+    : options_(options), core_(nullptr), file_(nullptr), failed_(false), pending_records_(0), oldest_pending_ms_(0),
+      sequence_(0), snapshot_sequence_(0), records_since_snapshot_(0), recovered_records_(0) {}
+
+SchedulerJournal::~SchedulerJournal()
+{
+    close();
+}
+
+bool SchedulerJournal::open(const std::string &directory, SchedulerCore *core, std::string *error)
+{
+    std::string ignored;
+    if (!error)
+        error = &ignored;
+    if (isOpen())
+    {
+        *error = "journal is already open";
+        return false;
+    }
+    if (core->slotCount() != core->imageSlotCount() || !core->bookings().empty())
+    {
+        *error = "journal recovery needs a scheduler holding at most its schedule image";
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    snapshot_path_ = (std::filesystem::path(directory) / "schedule.snapshot").string();
+    journal_path_ = (std::filesystem::path(directory) / "schedule.journal").string();
+    core_ = core;
+    failed_ = false;
+    sequence_ = snapshot_sequence_ = 0;
+    recovered_records_ = records_since_snapshot_ = 0;
+
+    if (!loadSnapshot(error) || !replayJournal(error))
+    {
+        core_ = nullptr;
+        return false;
+    }
+
+    file_ = std::fopen(journal_path_.c_str(), "ab");
+    if (!file_)
+    {
+        *error = "cannot open " + journal_path_;
+        core_ = nullptr;
+        return false;
+    }
+    core_->addListener(this);
+    return true;
+}
+
+void SchedulerJournal::close()
+{
+    if (!isOpen())
+        return;
+    flush();
+    core_->removeListener(this);
+    std::fclose(file_);
+    file_ = nullptr;
+    core_ = nullptr;
+}
+
+bool SchedulerJournal::flush()
+{
+    std::lock_guard<std::mutex> io_lock(io_mutex_);
+    return flushLocked();
+}
+
+bool SchedulerJournal::flushLocked()
+{
+    if (!file_)
+        return true;
+    if (failed_)
+        return false;
+    // The group is taken before the archive syncs, so every archive record it refers to was
+    // appended before that sync
+    std::string group;
+    size_t group_records;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        group.swap(pending_);
+        group_records = pending_records_;
+        pending_records_ = 0;
+    }
+    if (group.empty())
+        return true;
+    if (sync_before_ && !sync_before_())
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        pending_.insert(0, group);
+        pending_records_ += group_records;
+        return false;
+    }
+    if (std::fwrite(group.data(), 1, group.size(), file_) != group.size() || !syncFile(file_))
+        failed_ = true;
+    return !failed_;
+}
+
+void SchedulerJournal::poll()
+{
+    bool due;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        due = pending_records_ >= options_.group_commit_records ||
+              (pending_records_ > 0 && nowMs() - oldest_pending_ms_ >= options_.group_commit_ms);
+    }
+    if (due)
+        flush();
+}
+
+bool SchedulerJournal::snapshotDue() const
+{
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    return options_.snapshot_every_records > 0 && records_since_snapshot_ >= options_.snapshot_every_records;
+}
+
+uint64_t SchedulerJournal::lastSequence() const
+{
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    return sequence_;
+}
+
+void SchedulerJournal::append(RecordType type, const std::string &payload)
+{
+    // Syncing is left to flush() and poll(), so no file I/O happens under the core's lock
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    ++sequence_;
+    std::string body;
+    body.reserve(1 + 8 + payload.size());
+    put<uint8_t>(&body, type);
+    put<uint64_t>(&body, sequence_);
+    body.append(payload);
+
+    put<uint32_t>(&pending_, static_cast<uint32_t>(payload.size()));
+    put<uint32_t>(&pending_, crc32(body.data(), body.size()));
+    pending_.append(body);
+
+    if (pending_records_++ == 0)
+        oldest_pending_ms_ = nowMs();
+    ++records_since_snapshot_;
+}
+
+void SchedulerJournal::slotAdded(const TimeSlot &slot)
+{
+    std::string payload;
+    put<int64_t>(&payload, slot.getStartKey());
+    put<uint8_t>(&payload, static_cast<uint8_t>(slot.getLane()));
+    put<uint16_t>(&payload, static_cast<uint16_t>(slot.getCapacity()));
+    append(AddSlotRecord, payload);
+}
+
+void SchedulerJournal::slotsAdded(const RecurringSlotSpec &spec)
+{
+    // Generation is deterministic, so the spec replays to the same slot ids
+    std::string payload;
+    put<int64_t>(&payload, spec.first_day);
+    put<int64_t>(&payload, spec.last_day);
+    put<uint32_t>(&payload, spec.weekday_mask);
+    put<int32_t>(&payload, spec.interval_minutes);
+    put<int32_t>(&payload, spec.lanes);
+    put<uint32_t>(&payload, static_cast<uint32_t>(spec.windows.size()));
+    for (const SlotWindow &window : spec.windows)
+    {
+        put<int32_t>(&payload, window.start_minute);
+        put<int32_t>(&payload, window.end_minute);
+    }
+    put<int32_t>(&payload, spec.capacity);
+    append(AddRecurringRecord, payload);
+}
+
+void SchedulerJournal::slotsImported(int first_slot_id, size_t count)
+{
+    // Batches are stored in id order, which addSlots reproduces on replay
+    std::string payload;
+    payload.reserve(4 + count * 11);
+    put<uint32_t>(&payload, static_cast<uint32_t>(count));
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto slot = core_->findSlot(first_slot_id + static_cast<int>(i));
+        put<int64_t>(&payload, slot->getStartKey());
+        put<uint8_t>(&payload, static_cast<uint8_t>(slot->getLane()));
+        put<uint16_t>(&payload, static_cast<uint16_t>(slot->getCapacity()));
+    }
+    append(AddSlotCapacityBatchRecord, payload);
+}
+
+void SchedulerJournal::slotBooked(const TimeSlot &, const Patient &booking)
+{
+    std::string payload;
+    encodeBooking(&payload, booking);
+    append(BookRecord, payload);
+}
+
+void SchedulerJournal::bookingRemoved(const Patient &booking, size_t)
+{
+    std::string payload;
+    put<int32_t>(&payload, booking.getBookingId());
+    append(CancelRecord, payload);
+}
+
+void SchedulerJournal::bookingArchived(const Patient &booking, size_t)
+{
+    std::string payload;
+    put<int32_t>(&payload, booking.getBookingId());
+    append(ArchiveRecord, payload);
+}
+
+void SchedulerJournal::waitlistAdded(const WaitlistEntry &entry)
+{
+    std::string payload;
+    encodeWaitlistEntry(&payload, entry);
+    append(WaitlistAddRecord, payload);
+}
+
+void SchedulerJournal::waitlistRemoved(const WaitlistEntry &entry, int)
+{
+    // A seat handed to the entry is journaled as its own book record
+    std::string payload;
+    put<int32_t>(&payload, entry.waitlist_id);
+    append(WaitlistRemoveRecord, payload);
+}
+
+void SchedulerJournal::waitlistExpired(const WaitlistEntry &entry)
+{
+    // Replays as a withdrawal, since replay does not prune
+    waitlistRemoved(entry, 0);
+}
+
+void SchedulerJournal::retentionFloorRaised(int64_t day)
+{
+    std::string payload;
+    put<int64_t>(&payload, day);
+    append(RetentionFloorRecord, payload);
+}
+
+bool SchedulerJournal::applyRecord(RecordType type, const char *data, size_t size)
+{
+    Reader reader(data, size);
+    switch (type)
+    {
+    case AddSlotRecord:
+    {
+        int64_t start_key;
+        uint8_t lane;
+        uint16_t capacity = 1; // absent in records written before capacities
+        if (!reader.get(&start_key) || !reader.get(&lane) || (!reader.atEnd() && !reader.get(&capacity)))
+            return false;
+        core_->addSlot(start_key, lane, capacity, nullptr);
+        return true;
+    }
+    case AddRecurringRecord:
+    {
+        RecurringSlotSpec spec;
+        uint32_t window_count;
+        if (!reader.get(&spec.first_day) || !reader.get(&spec.last_day) || !reader.get(&spec.weekday_mask) ||
+            !reader.get(&spec.interval_minutes) || !reader.get(&spec.lanes) || !reader.get(&window_count))
+            return false;
+        for (uint32_t i = 0; i < window_count; ++i)
+        {
+            SlotWindow window;
+            if (!reader.get(&window.start_minute) || !reader.get(&window.end_minute))
+                return false;
+            spec.windows.push_back(window);
+        }
+        if (!reader.atEnd() && !reader.get(&spec.capacity))
+            return false;
+        core_->addRecurringSlots(spec);
+        return true;
+    }
+    case AddSlotBatchRecord:
+    case AddSlotCapacityBatchRecord:
+    {
+        uint32_t count;
+        if (!reader.get(&count))
+            return false;
+        std::vector<SlotKey> slots(count);
+        for (SlotKey &slot : slots)
+        {
+            uint8_t lane;
+            uint16_t capacity = 1;
+            if (!reader.get(&slot.start_key) || !reader.get(&lane) ||
+                (type == AddSlotCapacityBatchRecord && !reader.get(&capacity)))
+                return false;
+            slot.lane = lane;
+            slot.capacity = capacity;
+        }
+        core_->addSlots(std::move(slots));
+        return true;
+    }
+    case BookRecord:
+    {
+        int32_t booking_id, slot_id, age;
+        int64_t booked_at;
+        std::string name;
+        if (!decodeBooking(&reader, &booking_id, &slot_id, &age, &booked_at, &name))
+            return false;
+        core_->restoreBooking(Patient(booking_id, name, age, slot_id, booked_at));
+        return true;
+    }
+    case CancelRecord:
+    {
+        int32_t booking_id;
+        if (!reader.get(&booking_id))
+            return false;
+        core_->restoreCancellation(booking_id);
+        return true;
+    }
+    case WaitlistAddRecord:
+    {
+        WaitlistEntry entry;
+        if (!decodeWaitlistEntry(&reader, &entry))
+            return false;
+        core_->restoreWaitlistEntry(entry);
+        return true;
+    }
+    case WaitlistRemoveRecord:
+    {
+        int32_t waitlist_id;
+        if (!reader.get(&waitlist_id))
+            return false;
+        core_->removeFromWaitlist(waitlist_id);
+        return true;
+    }
+    case ArchiveRecord:
+    {
+        int32_t booking_id;
+        if (!reader.get(&booking_id))
+            return false;
+        core_->restoreArchival(booking_id);
+        return true;
+    }
+    case RetentionFloorRecord:
+    {
+        int64_t day;
+        if (!reader.get(&day))
+            return false;
+        core_->setRetentionFloor(day);
+        return true;
+    }
+    }
+    return false;
+}
+
+bool SchedulerJournal::replayJournal(std::string *error)
+{
+    std::string contents;
+    if (!readFile(journal_path_, &contents))
+        return true; // first start
+
+    size_t offset = 0;
+    while (contents.size() - offset >= kRecordHeaderSize)
+    {
+        uint32_t length, crc;
+        std::memcpy(&length, contents.data() + offset, 4);
+        std::memcpy(&crc, contents.data() + offset + 4, 4);
+        size_t body_size = 1 + 8 + static_cast<size_t>(length);
+        if (contents.size() - offset - 8 < body_size)
+            break; // torn write at the tail
+        const char *body = contents.data() + offset + 8;
+        if (crc32(body, body_size) != crc)
+            break;
+
+        uint8_t type;
+        uint64_t sequence;
+        std::memcpy(&type, body, 1);
+        std::memcpy(&sequence, body + 1, 8);
+        // Records already folded into the snapshot survive a crash between snapshot and truncate
+        if (sequence > snapshot_sequence_)
+        {
+            if (!applyRecord(static_cast<RecordType>(type), body + 9, length))
+            {
+                *error = "malformed journal record " + std::to_string(sequence);
+                return false;
+            }
+            sequence_ = sequence;
+            ++recovered_records_;
+            ++records_since_snapshot_;
+        }
+        offset += 8 + body_size;
+    }
+
+    if (offset != contents.size())
+    {
+        // Drop the incomplete tail so new records follow the last good one
+        std::error_code ec;
+        std::filesystem::resize_file(journal_path_, offset, ec);
+        if (ec)
+        {
+            *error = "cannot truncate damaged journal tail: " + ec.message();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SchedulerJournal::loadSnapshot(std::string *error)
+{
+    std::string contents;
+    if (!readFile(snapshot_path_, &contents))
+        return true; // no snapshot yet
+
+    if (contents.size() < 4 + 4 + 4 || std::memcmp(contents.data(), kSnapshotMagic, 4) != 0)
+    {
+        *error = "unrecognised snapshot file " + snapshot_path_;
+        return false;
+    }
+    uint32_t stored_crc;
+    std::memcpy(&stored_crc, contents.data() + contents.size() - 4, 4);
+    if (crc32(contents.data(), contents.size() - 4) != stored_crc)
+    {
+        *error = "snapshot checksum mismatch in " + snapshot_path_;
+        return false;
+    }
+
+    Reader reader(contents.data() + 4, contents.size() - 8);
+    uint32_t version;
+    uint64_t image_slot_count, image_checksum, slot_count, booking_count;
+    int32_t next_booking_id;
+    if (!reader.get(&version) || version < 2 || version > kSnapshotVersion || !reader.get(&snapshot_sequence_) ||
+        !reader.get(&image_slot_count) || !reader.get(&image_checksum) ||
+        !reader.get(&next_booking_id) || !reader.get(&slot_count))
+    {
+        *error = "unsupported snapshot version in " + snapshot_path_;
+        return false;
+    }
+    // Slot ids continue after the image's, so the journal only fits the image it was written against
+    if (image_slot_count != core_->imageSlotCount() || image_checksum != (core_->image() ? core_->image()->checksum() : 0))
+    {
+        *error = "snapshot " + snapshot_path_ + " was written against a different schedule image";
+        return false;
+    }
+
+    // Arena slots are stored in handle order, so re-adding them reproduces the ids
+    core_->reserveSlots(slot_count);
+    for (uint64_t i = 0; i < slot_count; ++i)
+    {
+        int64_t start_key;
+        uint8_t lane;
+        uint16_t capacity = 1;
+        if (!reader.get(&start_key) || !reader.get(&lane) || (version >= 3 && !reader.get(&capacity)))
+        {
+            *error = "truncated snapshot " + snapshot_path_;
+            return false;
+        }
+        core_->addSlot(start_key, lane, capacity, nullptr);
+    }
+    if (!reader.get(&booking_count))
+    {
+        *error = "truncated snapshot " + snapshot_path_;
+        return false;
+    }
+    for (uint64_t i = 0; i < booking_count; ++i)
+    {
+        int32_t booking_id, slot_id, age;
+        int64_t booked_at;
+        std::string name;
+        if (!decodeBooking(&reader, &booking_id, &slot_id, &age, &booked_at, &name))
+        {
+            *error = "truncated snapshot " + snapshot_path_;
+            return false;
+        }
+        core_->restoreBooking(Patient(booking_id, name, age, slot_id, booked_at));
+    }
+    core_->setNextBookingId(next_booking_id);
+
+    if (version >= 4)
+    {
+        int32_t next_waitlist_id;
+        uint64_t waitlist_count;
+        if (!reader.get(&next_waitlist_id) || !reader.get(&waitlist_count))
+        {
+            *error = "truncated snapshot " + snapshot_path_;
+            return false;
+        }
+        for (uint64_t i = 0; i < waitlist_count; ++i)
+        {
+            WaitlistEntry entry;
+            if (!decodeWaitlistEntry(&reader, &entry))
+            {
+                *error = "truncated snapshot " + snapshot_path_;
+                return false;
+            }
+            core_->restoreWaitlistEntry(entry);
+        }
+        core_->setNextWaitlistId(next_waitlist_id);
+    }
+
+    if (version >= 5)
+    {
+        // Archived bookings are gone from the snapshot, but their seats are still taken
+        uint64_t archived_count;
+        if (!reader.get(&archived_count))
+        {
+            *error = "truncated snapshot " + snapshot_path_;
+            return false;
+        }
+        for (uint64_t i = 0; i < archived_count; ++i)
+        {
+            int32_t slot_id;
+            uint16_t seats;
+            if (!reader.get(&slot_id) || !reader.get(&seats))
+            {
+                *error = "truncated snapshot " + snapshot_path_;
+                return false;
+            }
+            core_->restoreArchivedSeats(slot_id, seats);
+        }
+    }
+
+    if (version >= 6)
+    {
+        // Last, so slots and waiting patients on expired dates come back first and keep their ids
+        int64_t retention_floor;
+        if (!reader.get(&retention_floor))
+        {
+            *error = "truncated snapshot " + snapshot_path_;
+            return false;
+        }
+        core_->setRetentionFloor(retention_floor);
+    }
+    sequence_ = snapshot_sequence_;
+    return true;
+}
+
+bool SchedulerJournal::writeSnapshot()
+{
+    std::lock_guard<std::mutex> io_lock(io_mutex_);
+    if (!isOpen() || !flushLocked())
+        return false;
+
+    std::string contents(kSnapshotMagic, 4);
+    put<uint32_t>(&contents, kSnapshotVersion);
+    put<uint64_t>(&contents, sequence_);
+    put<uint64_t>(&contents, core_->imageSlotCount());
+    put<uint64_t>(&contents, core_->image() ? core_->image()->checksum() : 0);
+    put<int32_t>(&contents, core_->nextBookingId());
+    put<uint64_t>(&contents, core_->slotCount() - core_->imageSlotCount());
+    for (size_t id = core_->imageSlotCount() + 1; id <= core_->slotCount(); ++id)
+    {
+        auto slot = core_->findSlot(static_cast<int>(id));
+        put<int64_t>(&contents, slot->getStartKey());
+        put<uint8_t>(&contents, static_cast<uint8_t>(slot->getLane()));
+        put<uint16_t>(&contents, static_cast<uint16_t>(slot->getCapacity()));
+    }
+    put<uint64_t>(&contents, core_->bookings().size());
+    for (const Patient &booking : core_->bookings())
+        encodeBooking(&contents, booking);
+    std::vector<WaitlistEntry> waitlist = core_->waitlist().entries();
+    put<int32_t>(&contents, core_->waitlist().nextId());
+    put<uint64_t>(&contents, waitlist.size());
+    for (const WaitlistEntry &entry : waitlist)
+        encodeWaitlistEntry(&contents, entry);
+    std::vector<std::pair<int, int>> archived_seats = core_->archivedSeats();
+    put<uint64_t>(&contents, archived_seats.size());
+    for (const auto &archived : archived_seats)
+    {
+        put<int32_t>(&contents, archived.first);
+        put<uint16_t>(&contents, static_cast<uint16_t>(archived.second));
+    }
+    put<int64_t>(&contents, core_->retentionFloor());
+    put<uint32_t>(&contents, crc32(contents.data(), contents.size()));
+
+    // Write beside the old snapshot and rename over it, so a crash leaves one intact copy
+    std::string temp_path = snapshot_path_ + ".tmp";
+    FILE *file = std::fopen(temp_path.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = std::fwrite(contents.data(), 1, contents.size(), file) == contents.size() && syncFile(file);
+    std::fclose(file);
+    std::error_code ec;
+    if (ok)
+        std::filesystem::rename(temp_path, snapshot_path_, ec);
+    if (!ok || ec)
+    {
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex_);
+        snapshot_sequence_ = sequence_;
+        records_since_snapshot_ = 0;
+    }
+
+    // Everything in the journal is now covered by the snapshot
+    FILE *truncated = std::freopen(journal_path_.c_str(), "wb", file_);
+    if (truncated)
+        truncated = std::freopen(journal_path_.c_str(), "ab", truncated);
+    file_ = truncated;
+    if (!file_)
+    {
+        // Stop journaling rather than silently buffering records that can never be written
+        core_->removeListener(this);
+        core_ = nullptr;
+        return false;
+    }
+    return true;
+}
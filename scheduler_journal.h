@@ -0,0 +1,115 @@
+#ifndef SCHEDULER_JOURNAL_H
+#define SCHEDULER_JOURNAL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "scheduler_core.h"
+
+/**
+ * @brief Tuning for SchedulerJournal durability and compaction
+ */
+struct JournalOptions
+{
+    size_t group_commit_records = 64;       // poll() syncs once this many records are pending
+    int group_commit_ms = 10;               // ... or once the oldest pending record is this old
+    size_t snapshot_every_records = 100000; // compact into a snapshot after this many journal records
+};
+
+/**
+ * @brief Append-only write-ahead journal of scheduler operations
+ *
+ * Records add-slot, recurring-block, slot-batch, book, cancel, archive, waitlist and retention floor operations in a binary
+ * log (length, CRC-32, sequence number, payload) and replays them in order on
+ * startup, which reproduces the same slot and booking ids. Records are
+ * buffered and written with one sync per group, so durability lags
+ * acknowledgement by at most one group unless the caller flushes before
+ * acknowledging, as BookingPipeline does. Records are appended by core events,
+ * under whatever lock guards the core; flush() and poll() may run on another
+ * thread without it. Periodic snapshots hold the whole state plus the last
+ * sequence number they cover, so replay only reads the journal tail. When the
+ * core has a ScheduleImage attached, only the overlay is journaled and the
+ * snapshot refuses to load against a different image.
+ */
+class SchedulerJournal : public SchedulerListener
+{
+public:
+    explicit SchedulerJournal(const JournalOptions &options = JournalOptions());
+    ~SchedulerJournal();
+
+    // Restores the snapshot and journal from directory into an empty core, then
+    // records every later change of that core
+    bool open(const std::string &directory, SchedulerCore *core, std::string *error = nullptr);
+    void close();
+    bool isOpen() const { return file_ != nullptr; }
+
+    // Writes and syncs pending records; after a failed write or sync every later flush fails
+    // too, since records after a lost group would replay against state that never existed
+    bool flush();
+    // Runs before each group is written, to sync files its records refer to (the BookingArchive
+    // behind archive records); when it fails, the group stays pending and flush() fails
+    void setSyncBefore(std::function<bool()> sync) { sync_before_ = std::move(sync); }
+    void poll(); // group commit by count and age; reads no core state, call regularly
+    // Snapshots read the whole core, so callers hold its lock while writing one
+    bool snapshotDue() const;
+    bool writeSnapshot(); // compact the current state and truncate the journal
+
+    size_t recoveredRecords() const { return recovered_records_; }
+    uint64_t lastSequence() const;
+
+    void slotAdded(const TimeSlot &slot) override;
+    void slotsAdded(const RecurringSlotSpec &spec) override;
+    void slotsImported(int first_slot_id, size_t count) override;
+    void slotBooked(const TimeSlot &slot, const Patient &booking) override;
+    void bookingRemoved(const Patient &booking, size_t position) override;
+    void bookingArchived(const Patient &booking, size_t position) override;
+    void waitlistAdded(const WaitlistEntry &entry) override;
+    void waitlistRemoved(const WaitlistEntry &entry, int booking_id) override;
+    void waitlistExpired(const WaitlistEntry &entry) override;
+    void retentionFloorRaised(int64_t day) override;
+
+private:
+    enum RecordType : uint8_t
+    {
+        AddSlotRecord = 1,
+        AddRecurringRecord = 2,
+        BookRecord = 3,
+        CancelRecord = 4,
+        AddSlotBatchRecord = 5,        // written before slot capacities; every slot seats one
+        AddSlotCapacityBatchRecord = 6, // per slot: start key, lane, capacity
+        WaitlistAddRecord = 7,
+        WaitlistRemoveRecord = 8,
+        ArchiveRecord = 9, // a booking on an expired date moved to the BookingArchive
+        RetentionFloorRecord = 10
+    };
+
+    void append(RecordType type, const std::string &payload);
+    bool flushLocked(); // caller holds io_mutex_
+    bool loadSnapshot(std::string *error);
+    bool replayJournal(std::string *error);
+    bool applyRecord(RecordType type, const char *data, size_t size);
+
+    JournalOptions options_;
+    SchedulerCore *core_;
+    std::string snapshot_path_;
+    std::string journal_path_;
+    FILE *file_;
+
+    std::function<bool()> sync_before_;
+    std::mutex io_mutex_; // file_ writes, syncs and snapshot rewrites, in order
+    bool failed_;         // guarded by io_mutex_
+
+    mutable std::mutex pending_mutex_; // the members below, touched by appends and flushes
+    std::string pending_;
+    size_t pending_records_;
+    int64_t oldest_pending_ms_;
+    uint64_t sequence_;
+    uint64_t snapshot_sequence_;
+    size_t records_since_snapshot_;
+    size_t recovered_records_;
+};
+
+#endif // SCHEDULER_JOURNAL_H
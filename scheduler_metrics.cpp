@@ -0,0 +1,183 @@
+#include "scheduler_metrics.h"
+#include <cstdio>
+
+namespace
+{
+// Percentile from a bucket walk; reports the lower bound of the bucket holding the rank
+uint64_t percentile(const LatencyHistogram &histogram, uint64_t count, double fraction)
+{
+    uint64_t rank = static_cast<uint64_t>(fraction * count);
+    if (rank >= count)
+        rank = count - 1;
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LatencyHistogram::kBucketCount; ++i)
+    {
+        seen += histogram.bucketCount(i);
+        if (seen > rank)
+            return LatencyHistogram::bucketLowerBound(i);
+    }
+    return 0;
+}
+
+std::string formatNs(uint64_t ns)
+{
+    char text[32];
+    if (ns < 10000)
+        std::snprintf(text, sizeof(text), "%lluns", static_cast<unsigned long long>(ns));
+    else if (ns < 10000000)
+        std::snprintf(text, sizeof(text), "%.1fus", ns / 1e3);
+    else
+        std::snprintf(text, sizeof(text), "%.1fms", ns / 1e6);
+    return text;
+}
+} // namespace
+
+LatencyHistogram::LatencyHistogram()
+{
+    reset();
+}
+
+size_t LatencyHistogram::bucketIndex(uint64_t ns)
+{
+    if (ns < 2 * kSubBuckets)
+        return static_cast<size_t>(ns);
+    int exponent = 63 - __builtin_clzll(ns);
+    int shift = exponent - kSubBucketBits;
+    return static_cast<size_t>(shift) * kSubBuckets + static_cast<size_t>(ns >> shift);
+}
+
+uint64_t LatencyHistogram::bucketLowerBound(size_t index)
+{
+    if (index < 2 * kSubBuckets)
+        return index;
+    size_t shift = index / kSubBuckets - 1;
+    return static_cast<uint64_t>(index - shift * kSubBuckets) << shift;
+}
+
+void LatencyHistogram::record(uint64_t ns)
+{
+    buckets_[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t max = max_ns_.load(std::memory_order_relaxed);
+    while (ns > max && !max_ns_.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+    {
+    }
+}
+
+void LatencyHistogram::reset()
+{
+    for (std::atomic<uint64_t> &bucket : buckets_)
+        bucket.store(0, std::memory_order_relaxed);
+    count_.store(0, std::memory_order_relaxed);
+    sum_ns_.store(0, std::memory_order_relaxed);
+    max_ns_.store(0, std::memory_order_relaxed);
+}
+
+LatencySummary LatencyHistogram::summary() const
+{
+    LatencySummary summary;
+    // Buckets are read one by one, so their total can run ahead of count_; walk what they hold
+    for (size_t i = 0; i < kBucketCount; ++i)
+        summary.count += bucketCount(i);
+    if (summary.count == 0)
+        return summary;
+    summary.mean_ns = static_cast<double>(sum_ns_.load(std::memory_order_relaxed)) / summary.count;
+    summary.p50_ns = percentile(*this, summary.count, 0.50);
+    summary.p90_ns = percentile(*this, summary.count, 0.90);
+    summary.p99_ns = percentile(*this, summary.count, 0.99);
+    summary.p999_ns = percentile(*this, summary.count, 0.999);
+    summary.max_ns = max_ns_.load(std::memory_order_relaxed);
+    return summary;
+}
+
+const char *schedulerOperationName(SchedulerOperation operation)
+{
+    switch (operation)
+    {
+    case SchedulerOperation::Add:
+        return "add";
+    case SchedulerOperation::Book:
+        return "book";
+    case SchedulerOperation::Cancel:
+        return "cancel";
+    case SchedulerOperation::Refresh:
+        return "refresh";
+    case SchedulerOperation::Import:
+        return "import";
+    case SchedulerOperation::Commit:
+        return "commit";
+    case SchedulerOperation::Prune:
+        return "prune";
+    case SchedulerOperation::Search:
+        return "search";
+    case SchedulerOperation::Count:
+        break;
+    }
+    return "?";
+}
+
+void SchedulerMetrics::reset()
+{
+    for (LatencyHistogram &histogram : histograms_)
+        histogram.reset();
+}
+
+std::string SchedulerMetrics::report(const SchedulerCounters &counters) const
+{
+    std::string text;
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-8s %9s %9s %9s %9s %9s %9s\n", "op", "count", "mean", "p50", "p99", "p99.9", "max");
+    text += line;
+    for (size_t i = 0; i < histograms_.size(); ++i)
+    {
+        LatencySummary summary = histograms_[i].summary();
+        std::snprintf(line, sizeof(line), "%-8s %9llu %9s %9s %9s %9s %9s\n",
+                      schedulerOperationName(static_cast<SchedulerOperation>(i)),
+                      static_cast<unsigned long long>(summary.count),
+                      formatNs(static_cast<uint64_t>(summary.mean_ns)).c_str(), formatNs(summary.p50_ns).c_str(),
+                      formatNs(summary.p99_ns).c_str(), formatNs(summary.p999_ns).c_str(),
+                      formatNs(summary.max_ns).c_str());
+        text += line;
+    }
+    std::snprintf(line, sizeof(line),
+                  "\nslots %zu  open %zu  seats %zu  bookings %zu  waitlisted %zu  archived %zu\n"
+                  "date heaps %zu  largest %zu  fully booked %zu\n",
+                  counters.slots, counters.open_slots, counters.seats, counters.bookings, counters.waitlisted,
+                  counters.archived, counters.day_heaps, counters.largest_day_heap, counters.empty_day_heaps);
+    text += line;
+    return text;
+}
+
+bool SchedulerMetrics::dump(const std::string &path, const SchedulerCounters &counters, std::string *error) const
+{
+    std::string ignored;
+    if (!error)
+        error = &ignored;
+    FILE *file = std::fopen(path.c_str(), "w");
+    if (!file)
+    {
+        *error = "cannot create " + path;
+        return false;
+    }
+
+    std::string text = report(counters);
+    text += "\n# op bucket_lower_bound_ns count\n";
+    for (size_t i = 0; i < histograms_.size(); ++i)
+    {
+        for (size_t bucket = 0; bucket < LatencyHistogram::kBucketCount; ++bucket)
+        {
+            uint64_t count = histograms_[i].bucketCount(bucket);
+            if (count == 0)
+                continue;
+            text += schedulerOperationName(static_cast<SchedulerOperation>(i));
+            text += " " + std::to_string(LatencyHistogram::bucketLowerBound(bucket)) + " " + std::to_string(count) + "\n";
+        }
+    }
+
+    bool ok = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok)
+        *error = "write error in " + path;
+    return ok;
+}
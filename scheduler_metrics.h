@@ -0,0 +1,121 @@
+#ifndef SCHEDULER_METRICS_H
+#define SCHEDULER_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "scheduler_core.h"
+
+/**
+ * @brief Percentiles read from a LatencyHistogram at one point in time
+ */
+struct LatencySummary
+{
+    uint64_t count = 0;
+    double mean_ns = 0.0;
+    uint64_t p50_ns = 0;
+    uint64_t p90_ns = 0;
+    uint64_t p99_ns = 0;
+    uint64_t p999_ns = 0;
+    uint64_t max_ns = 0;
+};
+
+/**
+ * @brief Lock-free latency histogram with log-linear buckets
+ *
+ * Values below 64 ns get a bucket each; above that every power of two is
+ * split into 32 buckets, so a bucket's width is at most about 3% of its
+ * value, as in HdrHistogram. record() is a few relaxed atomic increments and
+ * may be called from any thread; readers see a slightly stale but consistent
+ * enough view for monitoring.
+ */
+class LatencyHistogram
+{
+public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+    static constexpr size_t kBucketCount = (65 - kSubBucketBits) * kSubBuckets;
+
+    LatencyHistogram();
+
+    void record(uint64_t ns);
+    void reset();
+
+    LatencySummary summary() const;
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+    uint64_t bucketCount(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+    static size_t bucketIndex(uint64_t ns);
+    static uint64_t bucketLowerBound(size_t index);
+
+private:
+    std::array<std::atomic<uint64_t>, kBucketCount> buckets_;
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_ns_;
+    std::atomic<uint64_t> max_ns_;
+};
+
+enum class SchedulerOperation
+{
+    Add,
+    Book,
+    Cancel,
+    Refresh,
+    Import,
+    Commit, // journal flush of one pipeline batch
+    Prune,  // one pruneStep of expired dates
+    Search, // one query of the bookings search box
+    Count
+};
+
+const char *schedulerOperationName(SchedulerOperation operation);
+
+/**
+ * @brief Per-operation latency histograms for the scheduler
+ */
+class SchedulerMetrics
+{
+public:
+    LatencyHistogram &histogram(SchedulerOperation operation) { return histograms_[static_cast<size_t>(operation)]; }
+    const LatencyHistogram &histogram(SchedulerOperation operation) const { return histograms_[static_cast<size_t>(operation)]; }
+    void reset();
+
+    // One line per operation with count, mean and percentiles, followed by the counters
+    std::string report(const SchedulerCounters &counters) const;
+    // report() plus every non-empty bucket, for offline analysis
+    bool dump(const std::string &path, const SchedulerCounters &counters, std::string *error = nullptr) const;
+
+private:
+    std::array<LatencyHistogram, static_cast<size_t>(SchedulerOperation::Count)> histograms_;
+};
+
+/**
+ * @brief Records the lifetime of the enclosing scope; a null metrics pointer disables it
+ */
+class ScopedLatency
+{
+public:
+    ScopedLatency(SchedulerMetrics *metrics, SchedulerOperation operation)
+        : histogram_(metrics ? &metrics->histogram(operation) : nullptr),
+          start_(histogram_ ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point())
+    {
+    }
+    ~ScopedLatency()
+    {
+        if (histogram_)
+            histogram_->record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                         std::chrono::steady_clock::now() - start_)
+                                                         .count()));
+    }
+    // Drops the sample, for calls that turned out to do no work
+    void discard() { histogram_ = nullptr; }
+    ScopedLatency(const ScopedLatency &) = delete;
+    ScopedLatency &operator=(const ScopedLatency &) = delete;
+
+private:
+    LatencyHistogram *histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+#endif // SCHEDULER_METRICS_H
@@ -0,0 +1,314 @@
+#include "scheduler_models.h"
+#include <algorithm>
+
+// AvailableSlotsModel Implementation
+AvailableSlotsModel::AvailableSlotsModel(const SchedulerCore *core, QObject *parent)
+    : QAbstractListModel(parent), core_(core), core_lock_(nullptr), day_(0) {}
+
+std::shared_lock<std::shared_mutex> AvailableSlotsModel::lockCore() const
+{
+    return core_lock_ ? std::shared_lock<std::shared_mutex>(*core_lock_) : std::shared_lock<std::shared_mutex>();
+}
+
+void AvailableSlotsModel::setDay(int64_t day)
+{
+    // Read first, then reset: views call data() during the reset, which locks again
+    std::vector<int> slot_ids;
+    {
+        std::shared_lock<std::shared_mutex> lock = lockCore();
+        for (const TimeSlot &slot : core_->availableSlots(day))
+            slot_ids.push_back(slot.getId());
+    }
+
+    beginResetModel();
+    day_ = day;
+    slot_ids_.swap(slot_ids);
+    endResetModel();
+}
+
+int AvailableSlotsModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return slot_ids_.empty() ? 1 : static_cast<int>(slot_ids_.size());
+}
+
+QVariant AvailableSlotsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    if (slot_ids_.empty())
+        return role == Qt::DisplayRole ? QVariant(QString("No available slots")) : QVariant();
+
+    int slot_id = slot_ids_[index.row()];
+    if (role == Qt::UserRole)
+        return slot_id;
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    std::optional<TimeSlot> slot;
+    {
+        std::shared_lock<std::shared_mutex> lock = lockCore();
+        slot = core_->findSlot(slot_id);
+    }
+    if (!slot)
+        return QVariant();
+    QString text = QString("%1. %2 %3 Lane %4 (ID: %5)")
+                       .arg(index.row() + 1)
+                       .arg(QString::fromStdString(slot->getDate()))
+                       .arg(QString::fromStdString(slot->getTime()))
+                       .arg(slot->getLane())
+                       .arg(slot_id);
+    if (slot->getCapacity() > 1)
+        text += QString(" - %1 of %2 seats left").arg(slot->getSeatsLeft()).arg(slot->getCapacity());
+    return text;
+}
+
+void AvailableSlotsModel::slotAdded(const TimeSlot &slot)
+{
+    insertSlot(slot);
+}
+
+void AvailableSlotsModel::slotBooked(const TimeSlot &slot, const Patient &)
+{
+    // A slot with seats left keeps its row; only the seat count changes
+    if (slot.isBooked())
+        removeSlot(slot);
+    else
+        insertSlot(slot);
+}
+
+void AvailableSlotsModel::slotReleased(const TimeSlot &slot)
+{
+    insertSlot(slot);
+}
+
+void AvailableSlotsModel::slotsAdded(const RecurringSlotSpec &spec)
+{
+    // Bulk loads reset the day once rather than inserting row by row
+    if (day_ >= spec.first_day && day_ <= spec.last_day)
+        setDay(day_);
+}
+
+void AvailableSlotsModel::slotsImported(int first_slot_id, size_t count)
+{
+    bool affected = false;
+    {
+        std::shared_lock<std::shared_mutex> lock = lockCore();
+        for (size_t i = 0; i < count && !affected; ++i)
+            affected = core_->findSlot(first_slot_id + static_cast<int>(i))->getDay() == day_;
+    }
+    if (affected)
+        setDay(day_);
+}
+
+std::vector<int>::iterator AvailableSlotsModel::findPosition(const TimeSlot &slot)
+{
+    return std::lower_bound(slot_ids_.begin(), slot_ids_.end(), slot, [this](int slot_id, const TimeSlot &target)
+                            { return *core_->findSlot(slot_id) < target; });
+}
+
+void AvailableSlotsModel::insertSlot(const TimeSlot &slot)
+{
+    if (slot.getDay() != day_)
+        return;
+
+    std::vector<int>::iterator it;
+    {
+        std::shared_lock<std::shared_mutex> lock = lockCore();
+        it = findPosition(slot);
+    }
+    if (it != slot_ids_.end() && *it == slot.getId())
+    {
+        // Already listed; its seat count may have changed
+        int row = static_cast<int>(it - slot_ids_.begin());
+        emit dataChanged(index(row), index(row));
+        return;
+    }
+
+    if (slot_ids_.empty())
+    {
+        // The placeholder row turns into the first slot
+        slot_ids_.push_back(slot.getId());
+        emit dataChanged(index(0), index(0));
+        return;
+    }
+
+    int row = static_cast<int>(it - slot_ids_.begin());
+    beginInsertRows(QModelIndex(), row, row);
+    slot_ids_.insert(it, slot.getId());
+    endInsertRows();
+    // Rows below shifted their position number
+    emit dataChanged(index(row), index(static_cast<int>(slot_ids_.size()) - 1));
+}
+
+void AvailableSlotsModel::removeSlot(const TimeSlot &slot)
+{
+    if (slot.getDay() != day_)
+        return;
+
+    std::vector<int>::iterator it;
+    {
+        std::shared_lock<std::shared_mutex> lock = lockCore();
+        it = findPosition(slot);
+    }
+    if (it == slot_ids_.end() || *it != slot.getId())
+        return;
+
+    if (slot_ids_.size() == 1)
+    {
+        // Keep one row for the placeholder text
+        slot_ids_.clear();
+        emit dataChanged(index(0), index(0));
+        return;
+    }
+
+    int row = static_cast<int>(it - slot_ids_.begin());
+    beginRemoveRows(QModelIndex(), row, row);
+    slot_ids_.erase(it);
+    endRemoveRows();
+    if (row < static_cast<int>(slot_ids_.size()))
+        emit dataChanged(index(row), index(static_cast<int>(slot_ids_.size()) - 1));
+}
+
+// BookingsTableModel Implementation
+BookingsTableModel::BookingsTableModel(const SchedulerCore *core, QObject *parent)
+    : QAbstractTableModel(parent), core_(core), core_lock_(nullptr), filtered_(false) {}
+
+std::shared_lock<std::shared_mutex> BookingsTableModel::lockCore() const
+{
+    return core_lock_ ? std::shared_lock<std::shared_mutex>(*core_lock_) : std::shared_lock<std::shared_mutex>();
+}
+
+void BookingsTableModel::reload()
+{
+    std::vector<int> booking_ids;
+    {
+        std::shared_lock<std::shared_mutex> lock = lockCore();
+        booking_ids.reserve(core_->bookings().size());
+        for (const Patient &patient : core_->bookings())
+            booking_ids.push_back(patient.getBookingId());
+    }
+
+    resetRows(std::move(booking_ids), false);
+}
+
+void BookingsTableModel::setFilter(std::vector<int> booking_ids)
+{
+    resetRows(std::move(booking_ids), true);
+}
+
+void BookingsTableModel::resetRows(std::vector<int> booking_ids, bool filtered)
+{
+    beginResetModel();
+    booking_ids_.swap(booking_ids);
+    rows_.clear();
+    rows_.reserve(booking_ids_.size());
+    for (size_t row = 0; row < booking_ids_.size(); ++row)
+        rows_.emplace(booking_ids_[row], static_cast<int>(row));
+    filtered_ = filtered;
+    endResetModel();
+}
+
+int BookingsTableModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : static_cast<int>(booking_ids_.size());
+}
+
+int BookingsTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 4;
+}
+
+QVariant BookingsTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount())
+        return QVariant();
+
+    int booking_id = booking_ids_[index.row()];
+    if (role == Qt::UserRole)
+        return booking_id;
+    if (role != Qt::DisplayRole)
+        return QVariant();
+
+    std::shared_lock<std::shared_mutex> lock = lockCore();
+    const Patient *patient = core_->findBooking(booking_id);
+    if (!patient)
+        return QVariant();
+
+    auto slot = core_->findSlot(patient->getSlotId());
+    switch (index.column())
+    {
+    case 0:
+        return QString::fromStdString(patient->getName());
+    case 1:
+        return patient->getAge();
+    case 2:
+        return slot ? QString::fromStdString(slot->getDate()) : QString();
+    case 3:
+        return slot ? QString::fromStdString(slot->getTime()) : QString();
+    }
+    return QVariant();
+}
+
+QVariant BookingsTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole)
+        return QVariant();
+    if (orientation == Qt::Vertical)
+        return section + 1;
+
+    static const char *kHeaders[] = {"Patient Name", "Age", "Slot Date", "Slot Time"};
+    return (section >= 0 && section < 4) ? QVariant(QString(kHeaders[section])) : QVariant();
+}
+
+void BookingsTableModel::slotBooked(const TimeSlot &, const Patient &booking)
+{
+    if (filtered_ || rows_.count(booking.getBookingId()))
+        return;
+
+    int row = static_cast<int>(booking_ids_.size());
+    beginInsertRows(QModelIndex(), row, row);
+    booking_ids_.push_back(booking.getBookingId());
+    rows_.emplace(booking.getBookingId(), row);
+    endInsertRows();
+}
+
+void BookingsTableModel::bookingArchived(const Patient &booking, size_t position)
+{
+    // Archived bookings leave the live table the same way as cancelled ones
+    bookingRemoved(booking, position);
+}
+
+void BookingsTableModel::bookingRemoved(const Patient &booking, size_t)
+{
+    auto row_it = rows_.find(booking.getBookingId());
+    if (row_it == rows_.end())
+        return;
+    int row = row_it->second;
+    int last = static_cast<int>(booking_ids_.size()) - 1;
+    rows_.erase(row_it);
+
+    if (filtered_)
+    {
+        // Search results stay in rank order; there are few enough to shift
+        beginRemoveRows(QModelIndex(), row, row);
+        booking_ids_.erase(booking_ids_.begin() + row);
+        for (int later = row; later < last; ++later)
+            rows_[booking_ids_[later]] = later;
+        endRemoveRows();
+        return;
+    }
+
+    // Same swap-remove as the core: the last row takes the removed row's place
+    if (row != last)
+    {
+        booking_ids_[row] = booking_ids_[last];
+        rows_[booking_ids_[row]] = row;
+        emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+    }
+    beginRemoveRows(QModelIndex(), last, last);
+    booking_ids_.pop_back();
+    endRemoveRows();
+}
@@ -0,0 +1,99 @@
+#ifndef SCHEDULER_MODELS_H
+#define SCHEDULER_MODELS_H
+
+#include <QtCore/QAbstractListModel>
+#include <QtCore/QAbstractTableModel>
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+#include "scheduler_core.h"
+
+/**
+ * @brief List model of the open slots for one day, earliest first
+ *
+ * Stores only slot ids; display text is formatted on demand for the rows a
+ * view actually paints. Qt::UserRole carries the slot id. An empty day shows a
+ * single placeholder row without a slot id. As a SchedulerListener it applies
+ * slot events for its day as single-row inserts, removals and seat-count
+ * updates; a slot stays listed until its last seat is booked. The handlers
+ * are idempotent, so events that arrive after a reset which already reflects
+ * them are harmless.
+ */
+class AvailableSlotsModel : public QAbstractListModel, public SchedulerListener
+{
+    Q_OBJECT
+
+public:
+    explicit AvailableSlotsModel(const SchedulerCore *core, QObject *parent = nullptr);
+
+    // Shared lock taken around every core read, when the core is written from another thread
+    void setCoreLock(std::shared_mutex *lock) { core_lock_ = lock; }
+    void setDay(int64_t day);
+    int64_t day() const { return day_; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    void slotAdded(const TimeSlot &slot) override;
+    void slotBooked(const TimeSlot &slot, const Patient &booking) override;
+    void slotReleased(const TimeSlot &slot) override;
+    void slotsAdded(const RecurringSlotSpec &spec) override;
+    void slotsImported(int first_slot_id, size_t count) override;
+
+private:
+    void insertSlot(const TimeSlot &slot);
+    void removeSlot(const TimeSlot &slot);
+    std::vector<int>::iterator findPosition(const TimeSlot &slot);
+    std::shared_lock<std::shared_mutex> lockCore() const;
+
+    const SchedulerCore *core_;
+    std::shared_mutex *core_lock_;
+    int64_t day_;
+    std::vector<int> slot_ids_; // sorted like the heap pops: start key, then id
+};
+
+/**
+ * @brief Table model over SchedulerCore::bookings()
+ *
+ * Keeps the booking ids in the core's dense order at load time and formats
+ * only visible cells. Book and cancel events map to a row append and a
+ * swap-remove found by booking id, so late or repeated events cannot corrupt
+ * the rows. Qt::UserRole carries the booking id.
+ *
+ * setFilter shows a given list instead, such as search results, in its order
+ * until the next reload: removals keep that order and new bookings are left
+ * for the caller to search again.
+ */
+class BookingsTableModel : public QAbstractTableModel, public SchedulerListener
+{
+    Q_OBJECT
+
+public:
+    explicit BookingsTableModel(const SchedulerCore *core, QObject *parent = nullptr);
+
+    void setCoreLock(std::shared_mutex *lock) { core_lock_ = lock; }
+    void reload();
+    void setFilter(std::vector<int> booking_ids);
+    bool isFiltered() const { return filtered_; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    void slotBooked(const TimeSlot &slot, const Patient &booking) override;
+    void bookingRemoved(const Patient &booking, size_t position) override;
+    void bookingArchived(const Patient &booking, size_t position) override;
+
+private:
+    std::shared_lock<std::shared_mutex> lockCore() const;
+    void resetRows(std::vector<int> booking_ids, bool filtered);
+
+    const SchedulerCore *core_;
+    std::shared_mutex *core_lock_;
+    std::vector<int> booking_ids_;
+    std::unordered_map<int, int> rows_; // booking id -> row
+    bool filtered_;
+};
+
+#endif // SCHEDULER_MODELS_H
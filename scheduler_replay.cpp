@@ -0,0 +1,273 @@
+// Replays a trace recorded with --record-trace (see scheduler_trace.h) through SchedulerCore.
+//
+//   scheduler_replay trace.bin [--speed 0] [--repeat 1] [--show-mismatches 10]
+//
+// The trace's baseline is loaded untimed into an empty core, then every
+// recorded operation is applied in order: as fast as possible with --speed 0,
+// otherwise at the recorded pace divided by --speed (2 replays twice as
+// fast). Each operation is timed on its own, so latencies exclude the
+// waiting. Prints throughput, latency percentiles per operation kind, the
+// number of operations whose result or ids differ from the recording, and a
+// checksum of the final slots, bookings and waiting patients; two builds that
+// schedule alike print the same checksum. --repeat replays the whole trace
+// again on a fresh core and keeps the best run's throughput. Exits with 1 when
+// any outcome differs. No Qt.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "scheduler_metrics.h"
+#include "scheduler_trace.h"
+
+namespace
+{
+typedef std::chrono::steady_clock Clock;
+
+struct Options
+{
+    std::string path;
+    double speed = 0.0; // 0: as fast as possible
+    int repeat = 1;
+    int show_mismatches = 10;
+};
+
+enum Category
+{
+    AddCategory,
+    BookCategory,
+    CancelCategory,
+    WaitlistCategory,
+    PruneCategory,
+    CategoryCount
+};
+
+const char *const kCategoryNames[CategoryCount] = {"add", "book", "cancel", "waitlist", "prune"};
+
+Category categoryOf(TraceOperation::Kind kind)
+{
+    switch (kind)
+    {
+    case TraceOperation::Book:
+    case TraceOperation::BookEarliest:
+    case TraceOperation::BookNext:
+        return BookCategory;
+    case TraceOperation::Cancel:
+        return CancelCategory;
+    case TraceOperation::WaitlistAdd:
+    case TraceOperation::WaitlistRemove:
+        return WaitlistCategory;
+    case TraceOperation::Prune:
+        return PruneCategory;
+    default:
+        return AddCategory;
+    }
+}
+
+struct RunResult
+{
+    double seconds = 0.0;
+    size_t operations = 0;
+    size_t mismatches = 0;
+    uint64_t checksum = 0;
+    SchedulerCounters counters;
+};
+
+std::string formatNs(uint64_t ns)
+{
+    char text[32];
+    if (ns < 10000)
+        std::snprintf(text, sizeof(text), "%lluns", static_cast<unsigned long long>(ns));
+    else if (ns < 10000000)
+        std::snprintf(text, sizeof(text), "%.1fus", ns / 1e3);
+    else
+        std::snprintf(text, sizeof(text), "%.1fms", ns / 1e6);
+    return text;
+}
+
+const char *kindName(TraceOperation::Kind kind)
+{
+    switch (kind)
+    {
+    case TraceOperation::BaselineSlot:
+        return "baseline slot";
+    case TraceOperation::BaselineSeats:
+        return "baseline seats";
+    case TraceOperation::BaselineBooking:
+        return "baseline booking";
+    case TraceOperation::BaselineWaitlist:
+        return "baseline waitlist";
+    case TraceOperation::AddSlot:
+        return "add slot";
+    case TraceOperation::AddRecurring:
+        return "add recurring";
+    case TraceOperation::AddSlots:
+        return "add slots";
+    case TraceOperation::Book:
+        return "book";
+    case TraceOperation::BookEarliest:
+        return "book earliest";
+    case TraceOperation::BookNext:
+        return "book next";
+    case TraceOperation::Cancel:
+        return "cancel";
+    case TraceOperation::WaitlistAdd:
+        return "waitlist add";
+    case TraceOperation::WaitlistRemove:
+        return "waitlist remove";
+    default:
+        return "other";
+    }
+}
+
+void reportMismatch(size_t index, const TraceOperation &recorded, const TraceOperation &replayed)
+{
+    std::printf("  #%zu %s: recorded %s slot %d booking %d reassigned %d waitlist %d, "
+                "replayed %s slot %d booking %d reassigned %d waitlist %d\n",
+                index, kindName(recorded.kind), schedulerResultText(recorded.result), recorded.slot_id,
+                recorded.booking_id, recorded.reassigned_booking_id, recorded.waitlist.waitlist_id,
+                schedulerResultText(replayed.result), replayed.slot_id, replayed.booking_id,
+                replayed.reassigned_booking_id, replayed.waitlist.waitlist_id);
+}
+
+RunResult replay(const Options &options, const std::vector<TraceOperation> &operations,
+                 std::vector<LatencyHistogram> *histograms, bool report_mismatches)
+{
+    RunResult run;
+    SchedulerCore core;
+    TraceOperation outcome;
+    int shown = report_mismatches ? options.show_mismatches : 0;
+
+    size_t index = 0;
+    for (; index < operations.size() && operations[index].kind != TraceOperation::Begin; ++index)
+    {
+        SchedulerTrace::apply(&core, operations[index], &outcome);
+        if (!SchedulerTrace::sameOutcome(operations[index], outcome) && run.mismatches++ < static_cast<size_t>(shown))
+            reportMismatch(index, operations[index], outcome);
+    }
+    size_t first = std::min(index + 1, operations.size());
+    uint64_t first_us = first < operations.size() ? operations[first].at_us : 0;
+
+    Clock::time_point started = Clock::now();
+    for (index = first; index < operations.size(); ++index)
+    {
+        const TraceOperation &operation = operations[index];
+        if (options.speed > 0.0)
+            std::this_thread::sleep_until(started + std::chrono::microseconds(static_cast<int64_t>(
+                                                        (operation.at_us - first_us) / options.speed)));
+        Clock::time_point before = Clock::now();
+        SchedulerTrace::apply(&core, operation, &outcome);
+        uint64_t ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - before).count());
+        (*histograms)[categoryOf(operation.kind)].record(ns);
+        if (!SchedulerTrace::sameOutcome(operation, outcome) && run.mismatches++ < static_cast<size_t>(shown))
+            reportMismatch(index, operation, outcome);
+    }
+    run.seconds = std::chrono::duration<double>(Clock::now() - started).count();
+    run.operations = operations.size() - first;
+    run.checksum = SchedulerTrace::checksum(core);
+    run.counters = core.counters();
+    return run;
+}
+
+void usage()
+{
+    std::fprintf(stderr, "usage: scheduler_replay TRACE [--speed FACTOR] [--repeat N] [--show-mismatches N]\n"
+                         "       --speed 0 (the default) replays as fast as possible\n");
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (argc < 2 || argc % 2 != 0)
+    {
+        usage();
+        return 2;
+    }
+    options.path = argv[1];
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        std::string flag = argv[i];
+        const char *value = argv[i + 1];
+        if (flag == "--speed")
+            options.speed = std::max(0.0, std::atof(value));
+        else if (flag == "--repeat")
+            options.repeat = std::max(1, std::atoi(value));
+        else if (flag == "--show-mismatches")
+            options.show_mismatches = std::max(0, std::atoi(value));
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+
+    std::vector<TraceOperation> operations;
+    std::string error;
+    Clock::time_point read_started = Clock::now();
+    if (!SchedulerTrace::read(options.path, &operations, &error))
+    {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    double read_seconds = std::chrono::duration<double>(Clock::now() - read_started).count();
+    size_t baseline = 0;
+    while (baseline < operations.size() && operations[baseline].kind != TraceOperation::Begin)
+        ++baseline;
+    if (baseline == operations.size())
+    {
+        std::fprintf(stderr, "%s: trace has no baseline end marker\n", options.path.c_str());
+        return 1;
+    }
+    double span_seconds = (operations.back().at_us - operations[baseline].at_us) / 1e6;
+    std::printf("%s: %zu baseline records, %zu operations over %.1f s recorded (read in %.3f s)\n",
+                options.path.c_str(), baseline, operations.size() - baseline - 1, span_seconds, read_seconds);
+
+    // Latencies come from the fastest run, so one-off page faults in the first do not skew them;
+    // each run fills the histogram set the best run so far does not hold
+    std::vector<LatencyHistogram> histograms[2] = {std::vector<LatencyHistogram>(CategoryCount),
+                                                   std::vector<LatencyHistogram>(CategoryCount)};
+    size_t best_set = 0;
+    RunResult best;
+    uint64_t checksum = 0;
+    bool diverged = false;
+    for (int i = 0; i < options.repeat; ++i)
+    {
+        size_t set = i == 0 ? 0 : 1 - best_set;
+        for (LatencyHistogram &histogram : histograms[set])
+            histogram.reset();
+        RunResult run = replay(options, operations, &histograms[set], i == 0);
+        if (i == 0)
+            checksum = run.checksum;
+        diverged = diverged || run.checksum != checksum || run.mismatches > 0;
+        if (i == 0 || run.seconds < best.seconds)
+        {
+            best = run;
+            best_set = set;
+        }
+    }
+    const std::vector<LatencyHistogram> &best_histograms = histograms[best_set];
+
+    std::printf("replayed %zu operations in %.3f s: %.0f operations/s%s, %zu outcomes differ from the recording\n",
+                best.operations, best.seconds, best.seconds > 0 ? best.operations / best.seconds : 0.0,
+                options.speed > 0.0 ? " (time-scaled)" : "", best.mismatches);
+    std::printf("%-8s %9s %9s %9s %9s %9s %9s %9s\n", "op", "count", "mean", "p50", "p90", "p99", "p99.9", "max");
+    for (size_t c = 0; c < CategoryCount; ++c)
+    {
+        LatencySummary summary = best_histograms[c].summary();
+        if (summary.count == 0)
+            continue;
+        std::printf("%-8s %9llu %9s %9s %9s %9s %9s %9s\n", kCategoryNames[c],
+                    static_cast<unsigned long long>(summary.count),
+                    formatNs(static_cast<uint64_t>(summary.mean_ns)).c_str(), formatNs(summary.p50_ns).c_str(),
+                    formatNs(summary.p90_ns).c_str(), formatNs(summary.p99_ns).c_str(),
+                    formatNs(summary.p999_ns).c_str(), formatNs(summary.max_ns).c_str());
+    }
+    std::printf("final state: %zu slots, %zu bookings, %zu waiting, checksum %016llx\n", best.counters.slots,
+                best.counters.bookings, best.counters.waitlisted, static_cast<unsigned long long>(checksum));
+    return diverged ? 1 : 0;
+}
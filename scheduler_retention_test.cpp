@@ -0,0 +1,130 @@
+// Checks SchedulerCore retention between setRetentionFloor and the pruneStep
+// calls that catch up with it: bookings on expired dates cannot be cancelled,
+// replayed cancellations do not bring an evicted date back, and a booking the
+// archive refuses stays live, with its date's totals, until a later step.
+//
+//   scheduler_retention_test
+//
+// Prints one line per failed check and exits with 1 when any fails. No Qt.
+
+#include <cstdio>
+#include <vector>
+#include "scheduler_core.h"
+#include "slot_time.h"
+
+namespace
+{
+int failures = 0;
+
+void check(bool condition, const char *what)
+{
+    if (!condition)
+    {
+        std::fprintf(stderr, "FAILED: %s\n", what);
+        ++failures;
+    }
+}
+
+class ArchiveStub : public SchedulerListener
+{
+public:
+    bool storeArchived(const Patient &) override { return accept; }
+    void bookingArchived(const Patient &patient, size_t) override { archived.push_back(patient.getBookingId()); }
+
+    bool accept = true;
+    std::vector<int> archived;
+};
+
+constexpr int64_t kPastDay = 20000;
+constexpr int64_t kFloorDay = kPastDay + 1;
+
+// One two-seat slot on the past date, one booked seat, and a patient waiting for that date
+void bookPastSlot(SchedulerCore &core, int *booking_id)
+{
+    int slot_id = 0;
+    core.addSlot(makeStartKey(kPastDay, 9 * 60), 1, 2, &slot_id);
+    core.addSlot(makeStartKey(kFloorDay, 9 * 60), 1, 2, nullptr);
+    core.bookSlot(slot_id, "Ada Lovelace", 36, booking_id);
+    core.addToWaitlist("Alan Turing", 41, kPastDay, kPastDay);
+}
+
+void pruneAll(SchedulerCore &core)
+{
+    while (core.pruneStep(16))
+    {
+    }
+}
+
+void testCancelAfterFloor()
+{
+    SchedulerCore core;
+    ArchiveStub archive;
+    core.addListener(&archive);
+    int booking_id = 0;
+    bookPastSlot(core, &booking_id);
+    core.setRetentionFloor(kFloorDay);
+
+    int reassigned = 0;
+    check(core.cancelBooking(booking_id, &reassigned) == SchedulerResult::ExpiredDate,
+          "cancelling a booking below the floor is refused");
+    check(reassigned == 0, "a refused cancellation reassigns nobody");
+    check(core.findBooking(booking_id) != nullptr, "a refused cancellation keeps the booking");
+
+    pruneAll(core);
+    check(archive.archived == std::vector<int>{booking_id}, "the booking is archived by the sweep");
+    check(core.counters().day_heaps == 1, "only the date at the floor keeps a heap");
+    check(!core.earliestSlot(kPastDay), "the expired date has no open slot");
+    check(core.waitlist().size() == 0, "the waiting patient expired with the date");
+}
+
+void testReplayedCancelAfterFloor()
+{
+    SchedulerCore core;
+    int booking_id = 0;
+    bookPastSlot(core, &booking_id);
+    core.setRetentionFloor(kFloorDay);
+    // The heap sweep runs first, so the date's heap is gone before its bookings are reached
+    core.pruneStep(1);
+    check(core.counters().day_heaps == 1, "one unit evicts the expired heap");
+
+    check(core.restoreCancellation(booking_id) == SchedulerResult::Ok, "a replayed cancellation is applied");
+    check(core.findBooking(booking_id) == nullptr, "the replayed cancellation frees the booking");
+    check(core.counters().day_heaps == 1, "the replayed cancellation does not re-create the heap");
+    check(!core.earliestSlot(kPastDay), "the freed seat is not offered on the expired date");
+    check(core.availableCount(kPastDay, kPastDay) == 0, "the freed seat is not in the bitmap");
+    pruneAll(core);
+    check(core.counters().day_heaps == 1, "pruning leaves only the date at the floor");
+}
+
+void testRefusedArchive()
+{
+    SchedulerCore core;
+    ArchiveStub archive;
+    archive.accept = false;
+    core.addListener(&archive);
+    int booking_id = 0;
+    bookPastSlot(core, &booking_id);
+    core.setRetentionFloor(kFloorDay);
+
+    for (int step = 0; step < 200; ++step)
+        core.pruneStep(16);
+    check(core.findBooking(booking_id) != nullptr, "a booking the archive refused stays live");
+    check(core.aggregates().day(kPastDay).booked_seats == 1, "its date keeps its totals");
+
+    archive.accept = true;
+    pruneAll(core);
+    check(core.findBooking(booking_id) == nullptr, "the booking leaves once the archive stores it");
+    check(core.aggregates().day(kPastDay).slots == 0, "its date's totals are dropped afterwards");
+}
+} // namespace
+
+int main()
+{
+    testCancelAfterFloor();
+    testReplayedCancelAfterFloor();
+    testRefusedArchive();
+    if (failures > 0)
+        return 1;
+    std::printf("retention checks passed\n");
+    return 0;
+}
@@ -0,0 +1,691 @@
+#include "scheduler_trace.h"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+const char kTraceMagic[4] = {'C', 'T', 'T', 'R'};
+const uint32_t kTraceVersion = 1;
+const size_t kHeaderSize = 8;
+
+// LEB128 varints; signed values are zigzag-encoded first so small negatives stay short
+void putVarint(std::string *out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out->push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out->push_back(static_cast<char>(value));
+}
+
+void putSigned(std::string *out, int64_t value)
+{
+    putVarint(out, (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+}
+
+void putString(std::string *out, const std::string &value)
+{
+    putVarint(out, value.size());
+    out->append(value);
+}
+
+class Reader
+{
+public:
+    Reader(const char *data, size_t size) : data_(data), size_(size), offset_(0) {}
+
+    bool getVarint(uint64_t *value)
+    {
+        *value = 0;
+        for (int shift = 0; shift < 64 && offset_ < size_; shift += 7)
+        {
+            uint8_t byte = static_cast<uint8_t>(data_[offset_++]);
+            *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        return false;
+    }
+
+    template <typename T>
+    bool getSigned(T *value)
+    {
+        uint64_t encoded;
+        if (!getVarint(&encoded))
+            return false;
+        *value = static_cast<T>(static_cast<int64_t>(encoded >> 1) ^ -static_cast<int64_t>(encoded & 1));
+        return true;
+    }
+
+    bool getString(std::string *value)
+    {
+        uint64_t length;
+        if (!getVarint(&length) || size_ - offset_ < length)
+            return false;
+        value->assign(data_ + offset_, static_cast<size_t>(length));
+        offset_ += static_cast<size_t>(length);
+        return true;
+    }
+
+    bool atEnd() const { return offset_ == size_; }
+    size_t offset() const { return offset_; }
+
+private:
+    const char *data_;
+    size_t size_;
+    size_t offset_;
+};
+
+void encodeWaitlistEntry(std::string *out, const WaitlistEntry &entry)
+{
+    putSigned(out, entry.waitlist_id);
+    putString(out, entry.patient_name);
+    putSigned(out, entry.patient_age);
+    putSigned(out, entry.priority);
+    putSigned(out, entry.requested_at);
+    putSigned(out, entry.first_day);
+    putSigned(out, entry.last_day);
+}
+
+bool decodeWaitlistEntry(Reader *reader, WaitlistEntry *entry)
+{
+    return reader->getSigned(&entry->waitlist_id) && reader->getString(&entry->patient_name) &&
+           reader->getSigned(&entry->patient_age) && reader->getSigned(&entry->priority) &&
+           reader->getSigned(&entry->requested_at) && reader->getSigned(&entry->first_day) &&
+           reader->getSigned(&entry->last_day);
+}
+
+void encodeSlotKey(std::string *out, const SlotKey &slot)
+{
+    putSigned(out, slot.start_key);
+    putSigned(out, slot.lane);
+    putSigned(out, slot.capacity);
+}
+
+bool decodeSlotKey(Reader *reader, SlotKey *slot)
+{
+    return reader->getSigned(&slot->start_key) && reader->getSigned(&slot->lane) && reader->getSigned(&slot->capacity);
+}
+
+void encodeOperation(std::string *out, const TraceOperation &operation)
+{
+    switch (operation.kind)
+    {
+    case TraceOperation::BaselineSlot:
+    case TraceOperation::AddSlot:
+        putSigned(out, operation.slot_id);
+        encodeSlotKey(out, SlotKey{operation.when, operation.lane, operation.capacity});
+        break;
+    case TraceOperation::BaselineSeats:
+        putSigned(out, operation.slot_id);
+        putSigned(out, operation.capacity);
+        break;
+    case TraceOperation::BaselineBooking:
+        putSigned(out, operation.booking_id);
+        putSigned(out, operation.slot_id);
+        putSigned(out, operation.patient_age);
+        putSigned(out, operation.booked_at);
+        putString(out, operation.patient_name);
+        break;
+    case TraceOperation::BaselineWaitlist:
+    case TraceOperation::WaitlistAdd:
+        encodeWaitlistEntry(out, operation.waitlist);
+        break;
+    case TraceOperation::BaselineIds:
+        putSigned(out, operation.booking_id);
+        putSigned(out, operation.waitlist.waitlist_id);
+        break;
+    case TraceOperation::Begin:
+        break;
+    case TraceOperation::AddRecurring:
+        putSigned(out, operation.spec.first_day);
+        putSigned(out, operation.spec.last_day);
+        putVarint(out, operation.spec.weekday_mask);
+        putVarint(out, operation.spec.windows.size());
+        for (const SlotWindow &window : operation.spec.windows)
+        {
+            putSigned(out, window.start_minute);
+            putSigned(out, window.end_minute);
+        }
+        putSigned(out, operation.spec.interval_minutes);
+        putSigned(out, operation.spec.lanes);
+        putSigned(out, operation.spec.capacity);
+        break;
+    case TraceOperation::AddSlots:
+        putVarint(out, operation.slots.size());
+        for (const SlotKey &slot : operation.slots)
+            encodeSlotKey(out, slot);
+        break;
+    case TraceOperation::Book:
+    case TraceOperation::BookEarliest:
+    case TraceOperation::BookNext:
+        putSigned(out, operation.when);
+        putSigned(out, operation.slot_id);
+        putSigned(out, operation.booking_id);
+        putSigned(out, operation.patient_age);
+        putString(out, operation.patient_name);
+        break;
+    case TraceOperation::Cancel:
+        putSigned(out, operation.booking_id);
+        putSigned(out, operation.reassigned_booking_id);
+        break;
+    case TraceOperation::WaitlistRemove:
+        putSigned(out, operation.waitlist.waitlist_id);
+        break;
+    case TraceOperation::BaselineFloor:
+        putSigned(out, operation.when);
+        break;
+    case TraceOperation::Prune:
+        putSigned(out, operation.when);
+        putVarint(out, operation.budget);
+        break;
+    }
+}
+
+// False on a truncated record or an unknown kind
+bool decodeOperation(Reader *reader, TraceOperation *operation)
+{
+    SlotKey slot{0, 0, 0};
+    uint64_t count, mask;
+    switch (operation->kind)
+    {
+    case TraceOperation::BaselineSlot:
+    case TraceOperation::AddSlot:
+        if (!reader->getSigned(&operation->slot_id) || !decodeSlotKey(reader, &slot))
+            return false;
+        operation->when = slot.start_key;
+        operation->lane = slot.lane;
+        operation->capacity = slot.capacity;
+        return true;
+    case TraceOperation::BaselineSeats:
+        return reader->getSigned(&operation->slot_id) && reader->getSigned(&operation->capacity);
+    case TraceOperation::BaselineBooking:
+        return reader->getSigned(&operation->booking_id) && reader->getSigned(&operation->slot_id) &&
+               reader->getSigned(&operation->patient_age) && reader->getSigned(&operation->booked_at) &&
+               reader->getString(&operation->patient_name);
+    case TraceOperation::BaselineWaitlist:
+    case TraceOperation::WaitlistAdd:
+        return decodeWaitlistEntry(reader, &operation->waitlist);
+    case TraceOperation::BaselineIds:
+        return reader->getSigned(&operation->booking_id) && reader->getSigned(&operation->waitlist.waitlist_id);
+    case TraceOperation::Begin:
+        return true;
+    case TraceOperation::AddRecurring:
+        if (!reader->getSigned(&operation->spec.first_day) || !reader->getSigned(&operation->spec.last_day) ||
+            !reader->getVarint(&mask) || !reader->getVarint(&count))
+            return false;
+        operation->spec.weekday_mask = static_cast<unsigned>(mask);
+        operation->spec.windows.clear();
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            SlotWindow window;
+            if (!reader->getSigned(&window.start_minute) || !reader->getSigned(&window.end_minute))
+                return false;
+            operation->spec.windows.push_back(window);
+        }
+        return reader->getSigned(&operation->spec.interval_minutes) && reader->getSigned(&operation->spec.lanes) &&
+               reader->getSigned(&operation->spec.capacity);
+    case TraceOperation::AddSlots:
+        if (!reader->getVarint(&count))
+            return false;
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            if (!decodeSlotKey(reader, &slot))
+                return false;
+            operation->slots.push_back(slot);
+        }
+        return true;
+    case TraceOperation::Book:
+    case TraceOperation::BookEarliest:
+    case TraceOperation::BookNext:
+        return reader->getSigned(&operation->when) && reader->getSigned(&operation->slot_id) &&
+               reader->getSigned(&operation->booking_id) && reader->getSigned(&operation->patient_age) &&
+               reader->getString(&operation->patient_name);
+    case TraceOperation::Cancel:
+        return reader->getSigned(&operation->booking_id) && reader->getSigned(&operation->reassigned_booking_id);
+    case TraceOperation::WaitlistRemove:
+        return reader->getSigned(&operation->waitlist.waitlist_id);
+    case TraceOperation::BaselineFloor:
+        return reader->getSigned(&operation->when);
+    case TraceOperation::Prune:
+        if (!reader->getSigned(&operation->when) || !reader->getVarint(&count))
+            return false;
+        operation->budget = static_cast<size_t>(count);
+        return true;
+    }
+    return false;
+}
+
+const uint64_t kFnvOffset = 14695981039346656037ull;
+const uint64_t kFnvPrime = 1099511628211ull;
+
+void hashValue(uint64_t *hash, int64_t value)
+{
+    uint64_t bits = static_cast<uint64_t>(value);
+    for (int i = 0; i < 8; ++i)
+    {
+        *hash = (*hash ^ (bits & 0xff)) * kFnvPrime;
+        bits >>= 8;
+    }
+}
+
+void hashString(uint64_t *hash, const std::string &value)
+{
+    hashValue(hash, static_cast<int64_t>(value.size()));
+    for (char c : value)
+        *hash = (*hash ^ static_cast<uint8_t>(c)) * kFnvPrime;
+}
+} // namespace
+
+SchedulerTrace::SchedulerTrace(const SchedulerCore *core)
+    : core_(core), file_(nullptr), last_us_(0), recorded_(0)
+{
+}
+
+SchedulerTrace::~SchedulerTrace()
+{
+    close();
+}
+
+bool SchedulerTrace::open(const std::string &path, std::string *error)
+{
+    std::string ignored;
+    if (!error)
+        error = &ignored;
+    close();
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_)
+    {
+        *error = "cannot open " + path;
+        return false;
+    }
+    buffer_.assign(kTraceMagic, 4);
+    for (int i = 0; i < 4; ++i)
+        buffer_.push_back(static_cast<char>((kTraceVersion >> (8 * i)) & 0xff));
+    if (std::fwrite(buffer_.data(), 1, buffer_.size(), file_) != buffer_.size())
+    {
+        *error = "cannot write " + path;
+        std::fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+    started_ = std::chrono::steady_clock::now();
+    last_us_ = 0;
+    recorded_ = 0;
+
+    // Baseline: slots in id order re-create the same ids on an empty core
+    std::vector<std::pair<int, int>> archived_seats = core_->archivedSeats();
+    auto seats_it = archived_seats.begin();
+    for (size_t id = 1; id <= core_->slotCount(); ++id)
+    {
+        std::optional<TimeSlot> slot = core_->findSlot(static_cast<int>(id));
+        if (!slot)
+            continue;
+        TraceOperation operation;
+        operation.kind = TraceOperation::BaselineSlot;
+        operation.slot_id = slot->getId();
+        operation.when = slot->getStartKey();
+        operation.lane = slot->getLane();
+        operation.capacity = slot->getCapacity();
+        write(operation);
+        // Both run in slot id order
+        if (seats_it != archived_seats.end() && seats_it->first == slot->getId())
+        {
+            operation.kind = TraceOperation::BaselineSeats;
+            operation.capacity = seats_it->second;
+            write(operation);
+            ++seats_it;
+        }
+    }
+    for (const Patient &booking : core_->bookings())
+    {
+        TraceOperation operation;
+        operation.kind = TraceOperation::BaselineBooking;
+        operation.booking_id = booking.getBookingId();
+        operation.slot_id = booking.getSlotId();
+        operation.patient_age = booking.getAge();
+        operation.booked_at = booking.getBookedAt();
+        operation.patient_name = booking.getName();
+        write(operation);
+    }
+    for (const WaitlistEntry &entry : core_->waitlist().entries())
+    {
+        TraceOperation operation;
+        operation.kind = TraceOperation::BaselineWaitlist;
+        operation.waitlist = entry;
+        write(operation);
+    }
+    TraceOperation ids;
+    ids.kind = TraceOperation::BaselineIds;
+    ids.booking_id = core_->nextBookingId();
+    ids.waitlist.waitlist_id = core_->waitlist().nextId();
+    write(ids);
+    if (core_->retentionFloor() != std::numeric_limits<int64_t>::min())
+    {
+        TraceOperation floor;
+        floor.kind = TraceOperation::BaselineFloor;
+        floor.when = core_->retentionFloor();
+        write(floor);
+    }
+    TraceOperation begin;
+    begin.kind = TraceOperation::Begin;
+    write(begin);
+    return true;
+}
+
+void SchedulerTrace::close()
+{
+    if (!file_)
+        return;
+    std::fclose(file_);
+    file_ = nullptr;
+}
+
+void SchedulerTrace::record(TraceOperation operation)
+{
+    if (!file_)
+        return;
+    operation.at_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started_).count());
+    write(operation);
+    ++recorded_;
+}
+
+void SchedulerTrace::write(const TraceOperation &operation)
+{
+    // Timestamps only move forward, so each record holds a short delta
+    uint64_t at_us = std::max(operation.at_us, last_us_);
+    buffer_.clear();
+    buffer_.push_back(static_cast<char>(operation.kind));
+    putVarint(&buffer_, at_us - last_us_);
+    buffer_.push_back(static_cast<char>(operation.result));
+    encodeOperation(&buffer_, operation);
+    last_us_ = at_us;
+    std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+}
+
+void SchedulerTrace::recordPrune(int64_t retention_floor, size_t budget)
+{
+    TraceOperation operation;
+    operation.kind = TraceOperation::Prune;
+    operation.when = retention_floor;
+    operation.budget = budget;
+    record(std::move(operation));
+}
+
+void SchedulerTrace::slotAdded(const TimeSlot &slot)
+{
+    TraceOperation operation;
+    operation.kind = TraceOperation::AddSlot;
+    operation.slot_id = slot.getId();
+    operation.when = slot.getStartKey();
+    operation.lane = slot.getLane();
+    operation.capacity = slot.getCapacity();
+    record(std::move(operation));
+}
+
+void SchedulerTrace::slotsAdded(const RecurringSlotSpec &spec)
+{
+    TraceOperation operation;
+    operation.kind = TraceOperation::AddRecurring;
+    operation.spec = spec;
+    record(std::move(operation));
+}
+
+void SchedulerTrace::slotsImported(int first_slot_id, size_t count)
+{
+    if (!file_)
+        return;
+    TraceOperation operation;
+    operation.kind = TraceOperation::AddSlots;
+    operation.slot_id = first_slot_id;
+    operation.slots.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (std::optional<TimeSlot> slot = core_->findSlot(first_slot_id + static_cast<int>(i)))
+            operation.slots.push_back(SlotKey{slot->getStartKey(), slot->getLane(), slot->getCapacity()});
+    }
+    record(std::move(operation));
+}
+
+void SchedulerTrace::waitlistAdded(const WaitlistEntry &entry)
+{
+    TraceOperation operation;
+    operation.kind = TraceOperation::WaitlistAdd;
+    operation.waitlist = entry;
+    record(std::move(operation));
+}
+
+void SchedulerTrace::waitlistRemoved(const WaitlistEntry &entry, int booking_id)
+{
+    // A waiting patient who got a seat is part of the recorded cancellation
+    if (booking_id != 0)
+        return;
+    TraceOperation operation;
+    operation.kind = TraceOperation::WaitlistRemove;
+    operation.waitlist.waitlist_id = entry.waitlist_id;
+    record(std::move(operation));
+}
+
+bool SchedulerTrace::read(const std::string &path, std::vector<TraceOperation> *operations, std::string *error)
+{
+    std::string ignored;
+    if (!error)
+        error = &ignored;
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        *error = "cannot open " + path;
+        return false;
+    }
+    std::string contents;
+    char buffer[1 << 16];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+        contents.append(buffer, count);
+    std::fclose(file);
+
+    uint32_t version = 0;
+    if (contents.size() >= kHeaderSize)
+    {
+        for (int i = 0; i < 4; ++i)
+            version |= static_cast<uint32_t>(static_cast<uint8_t>(contents[4 + i])) << (8 * i);
+    }
+    if (contents.size() < kHeaderSize || std::memcmp(contents.data(), kTraceMagic, 4) != 0 ||
+        version != kTraceVersion)
+    {
+        *error = "unrecognised scheduler trace " + path;
+        return false;
+    }
+
+    Reader reader(contents.data() + kHeaderSize, contents.size() - kHeaderSize);
+    uint64_t at_us = 0;
+    while (!reader.atEnd())
+    {
+        size_t record_start = reader.offset();
+        uint64_t kind, delta_us, result;
+        TraceOperation operation;
+        if (!reader.getVarint(&kind) || !reader.getVarint(&delta_us) || !reader.getVarint(&result))
+            break; // torn write at the tail
+        if (kind < TraceOperation::BaselineSlot || kind > TraceOperation::Prune ||
+            result > static_cast<uint64_t>(SchedulerResult::ExpiredDate))
+        {
+            *error = "corrupt record at offset " + std::to_string(kHeaderSize + record_start) + " of " + path;
+            return false;
+        }
+        operation.kind = static_cast<TraceOperation::Kind>(kind);
+        operation.result = static_cast<SchedulerResult>(result);
+        if (!decodeOperation(&reader, &operation))
+            break;
+        at_us += delta_us;
+        operation.at_us = at_us;
+        operations->push_back(std::move(operation));
+    }
+    return true;
+}
+
+void SchedulerTrace::apply(SchedulerCore *core, const TraceOperation &operation, TraceOperation *outcome)
+{
+    outcome->kind = operation.kind;
+    outcome->slot_id = 0;
+    outcome->booking_id = 0;
+    outcome->reassigned_booking_id = 0;
+    outcome->waitlist.waitlist_id = 0;
+    SchedulerResult &result = outcome->result;
+    result = SchedulerResult::Ok;
+
+    switch (operation.kind)
+    {
+    case TraceOperation::BaselineSlot:
+    case TraceOperation::AddSlot:
+        result = core->addSlot(operation.when, operation.lane, operation.capacity, &outcome->slot_id);
+        break;
+    case TraceOperation::BaselineSeats:
+        outcome->slot_id = operation.slot_id;
+        result = core->restoreArchivedSeats(operation.slot_id, operation.capacity);
+        break;
+    case TraceOperation::BaselineBooking:
+        outcome->slot_id = operation.slot_id;
+        outcome->booking_id = operation.booking_id;
+        result = core->restoreBooking(Patient(operation.booking_id, operation.patient_name, operation.patient_age,
+                                              operation.slot_id, operation.booked_at));
+        break;
+    case TraceOperation::BaselineWaitlist:
+        outcome->waitlist.waitlist_id = operation.waitlist.waitlist_id;
+        result = core->restoreWaitlistEntry(operation.waitlist);
+        break;
+    case TraceOperation::BaselineIds:
+        core->setNextBookingId(operation.booking_id);
+        core->setNextWaitlistId(operation.waitlist.waitlist_id);
+        outcome->booking_id = core->nextBookingId();
+        outcome->waitlist.waitlist_id = core->waitlist().nextId();
+        break;
+    case TraceOperation::Begin:
+        break;
+    case TraceOperation::AddRecurring:
+        result = core->addRecurringSlots(operation.spec);
+        break;
+    case TraceOperation::AddSlots:
+        result = core->addSlots(operation.slots);
+        break;
+    case TraceOperation::Book:
+    case TraceOperation::BookEarliest:
+    case TraceOperation::BookNext:
+    {
+        // As BookingPipeline applies requests: earliest-slot kinds pick the slot at replay time
+        outcome->slot_id = operation.slot_id;
+        if (operation.kind != TraceOperation::Book)
+        {
+            std::optional<TimeSlot> earliest = operation.kind == TraceOperation::BookEarliest
+                                                   ? core->earliestSlot(operation.when)
+                                                   : core->earliestSlotAfter(operation.when);
+            if (!earliest)
+            {
+                outcome->slot_id = 0;
+                result = SchedulerResult::SlotUnavailable;
+                break;
+            }
+            outcome->slot_id = earliest->getId();
+        }
+        result = core->bookSlot(outcome->slot_id, operation.patient_name, operation.patient_age, &outcome->booking_id);
+        break;
+    }
+    case TraceOperation::Cancel:
+        outcome->booking_id = operation.booking_id;
+        result = core->cancelBooking(operation.booking_id, &outcome->reassigned_booking_id);
+        break;
+    case TraceOperation::WaitlistAdd:
+        // The recorded entry keeps its requested_at, which orders patients of equal priority, so
+        // replays do not depend on the clock; the id this build would hand out is what is compared
+        outcome->waitlist.waitlist_id = core->waitlist().nextId();
+        result = core->restoreWaitlistEntry(operation.waitlist);
+        break;
+    case TraceOperation::WaitlistRemove:
+        outcome->waitlist.waitlist_id = operation.waitlist.waitlist_id;
+        result = core->removeFromWaitlist(operation.waitlist.waitlist_id);
+        break;
+    case TraceOperation::BaselineFloor:
+        // The baseline re-created expired slots like any other; evict them as the recording core had.
+        // Should it have been mid-sweep, this archives ahead of it, but not anything it would not
+        core->setRetentionFloor(operation.when);
+        while (core->pruneStep(4096))
+        {
+        }
+        break;
+    case TraceOperation::Prune:
+        core->setRetentionFloor(operation.when);
+        core->pruneStep(operation.budget);
+        break;
+    }
+}
+
+bool SchedulerTrace::sameOutcome(const TraceOperation &recorded, const TraceOperation &replayed)
+{
+    if (recorded.result != replayed.result)
+        return false;
+    switch (recorded.kind)
+    {
+    case TraceOperation::BaselineSlot:
+    case TraceOperation::AddSlot:
+        return recorded.slot_id == replayed.slot_id;
+    case TraceOperation::Book:
+    case TraceOperation::BookEarliest:
+    case TraceOperation::BookNext:
+        return recorded.slot_id == replayed.slot_id && recorded.booking_id == replayed.booking_id;
+    case TraceOperation::Cancel:
+        return recorded.reassigned_booking_id == replayed.reassigned_booking_id;
+    case TraceOperation::WaitlistAdd:
+        return recorded.waitlist.waitlist_id == replayed.waitlist.waitlist_id;
+    default:
+        return true;
+    }
+}
+
+uint64_t SchedulerTrace::checksum(const SchedulerCore &core)
+{
+    uint64_t hash = kFnvOffset;
+    hashValue(&hash, static_cast<int64_t>(core.slotCount()));
+    for (size_t id = 1; id <= core.slotCount(); ++id)
+    {
+        std::optional<TimeSlot> slot = core.findSlot(static_cast<int>(id));
+        if (!slot)
+            continue;
+        hashValue(&hash, slot->getStartKey());
+        hashValue(&hash, slot->getLane());
+        hashValue(&hash, slot->getCapacity());
+        hashValue(&hash, slot->getBookedCount());
+    }
+
+    // bookings() order depends on the order of cancellations, so sort by id
+    std::vector<const Patient *> bookings;
+    bookings.reserve(core.bookings().size());
+    for (const Patient &booking : core.bookings())
+        bookings.push_back(&booking);
+    std::sort(bookings.begin(), bookings.end(), [](const Patient *a, const Patient *b)
+              { return a->getBookingId() < b->getBookingId(); });
+    hashValue(&hash, static_cast<int64_t>(bookings.size()));
+    for (const Patient *booking : bookings)
+    {
+        hashValue(&hash, booking->getBookingId());
+        hashValue(&hash, booking->getSlotId());
+        hashValue(&hash, booking->getAge());
+        hashString(&hash, booking->getName());
+    }
+
+    std::vector<WaitlistEntry> waiting = core.waitlist().entries();
+    hashValue(&hash, static_cast<int64_t>(waiting.size()));
+    for (const WaitlistEntry &entry : waiting)
+    {
+        hashValue(&hash, entry.waitlist_id);
+        hashString(&hash, entry.patient_name);
+        hashValue(&hash, entry.patient_age);
+        hashValue(&hash, entry.priority);
+        hashValue(&hash, entry.requested_at);
+        hashValue(&hash, entry.first_day);
+        hashValue(&hash, entry.last_day);
+    }
+    return hash;
+}
@@ -0,0 +1,122 @@
+#ifndef SCHEDULER_TRACE_H
+#define SCHEDULER_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "scheduler_core.h"
+
+/**
+ * @brief One recorded scheduler operation and the outcome it had
+ *
+ * Fields not used by a kind stay at their defaults.
+ */
+struct TraceOperation
+{
+    enum Kind : uint8_t
+    {
+        // The schedule as it stood when recording began, applied before Begin
+        BaselineSlot = 1, // a slot re-created with its original id
+        BaselineSeats,    // seats taken by archived bookings
+        BaselineBooking,
+        BaselineWaitlist,
+        BaselineIds,   // next booking and waitlist ids
+        BaselineFloor, // retention floor
+        Begin,
+        // Recorded operations
+        AddSlot,
+        AddRecurring,
+        AddSlots,
+        Book,
+        BookEarliest,
+        BookNext,
+        Cancel,
+        WaitlistAdd,
+        WaitlistRemove,
+        Prune // one SchedulerCore::pruneStep after moving the retention floor
+    };
+
+    Kind kind = Book;
+    uint64_t at_us = 0; // since recording began
+    SchedulerResult result = SchedulerResult::Ok;
+    int slot_id = 0;     // Book*, BaselineSlot, BaselineSeats, BaselineBooking
+    int booking_id = 0;  // booked, cancelled or restored; BaselineIds: next booking id
+    int reassigned_booking_id = 0; // Cancel: the waitlisted patient's booking for the freed seat
+    int64_t when = 0;    // start key for slots and BookNext; day for BookEarliest, BaselineFloor and Prune
+    int lane = 0;
+    int capacity = 0;    // BaselineSeats: seats
+    std::string patient_name;
+    int patient_age = 0;
+    int64_t booked_at = 0; // BaselineBooking
+    WaitlistEntry waitlist; // WaitlistAdd, BaselineWaitlist; WaitlistRemove uses the id; BaselineIds: next id
+    RecurringSlotSpec spec; // AddRecurring
+    size_t budget = 0;      // Prune
+    std::vector<SlotKey> slots; // AddSlots, in slot id order
+};
+
+/**
+ * @brief Compact binary recording of the operations a SchedulerCore applies
+ *
+ * open() writes the core's current slots, bookings and waitlist as a
+ * baseline, so a trace replays on an empty core; after that every add,
+ * booking, cancellation, waitlist change and prune step is one
+ * record of a kind byte, the microseconds since the previous record and the
+ * result, followed by varint fields. Slot additions and waitlist changes
+ * arrive as listener events; bookings and cancellations are recorded by
+ * BookingPipeline with the request that caused them, so earliest-slot
+ * requests replay as such and refused ones are kept too. Whoever prunes
+ * records each step that raised the floor or spent budget with
+ * recordPrune, since which bookings a step archives decides what later
+ * requests see; a step that did neither changed nothing. Records are buffered by stdio; close()
+ * flushes them and read() drops a torn tail.
+ *
+ * Not thread-safe: record() and the listener events must come from the one
+ * thread that mutates the core, e.g. under BookingPipeline's exclusive lock.
+ */
+class SchedulerTrace : public SchedulerListener
+{
+public:
+    explicit SchedulerTrace(const SchedulerCore *core);
+    ~SchedulerTrace();
+    SchedulerTrace(const SchedulerTrace &) = delete;
+    SchedulerTrace &operator=(const SchedulerTrace &) = delete;
+
+    bool open(const std::string &path, std::string *error = nullptr); // truncates, then writes the baseline
+    void close();
+    bool isOpen() const { return file_ != nullptr; }
+
+    void record(TraceOperation operation); // stamps at_us; ignored while closed
+    void recordPrune(int64_t retention_floor, size_t budget);
+    size_t recordedCount() const { return recorded_; }
+
+    void slotAdded(const TimeSlot &slot) override;
+    void slotsAdded(const RecurringSlotSpec &spec) override;
+    void slotsImported(int first_slot_id, size_t count) override;
+    void waitlistAdded(const WaitlistEntry &entry) override;
+    void waitlistRemoved(const WaitlistEntry &entry, int booking_id) override;
+
+    static bool read(const std::string &path, std::vector<TraceOperation> *operations, std::string *error = nullptr);
+
+    // Applies operation to core the way it was first applied; outcome gets the result and the ids
+    // it produced, for comparison with the recorded ones (see sameOutcome)
+    static void apply(SchedulerCore *core, const TraceOperation &operation, TraceOperation *outcome);
+    static bool sameOutcome(const TraceOperation &recorded, const TraceOperation &replayed);
+
+    // FNV-1a over slots, live bookings and waiting patients in id order, without booking times;
+    // a waiting patient's requested_at counts, since it decides who gets a freed seat
+    static uint64_t checksum(const SchedulerCore &core);
+
+private:
+    void write(const TraceOperation &operation);
+
+    const SchedulerCore *core_;
+    FILE *file_;
+    std::string buffer_;
+    std::chrono::steady_clock::time_point started_;
+    uint64_t last_us_;
+    size_t recorded_;
+};
+
+#endif // SCHEDULER_TRACE_H
@@ -0,0 +1,135 @@
+#include "scheduler_waitlist.h"
+#include <algorithm>
+#include <limits>
+
+SchedulerWaitlist::SchedulerWaitlist()
+    : heap_copies_(0), live_copies_(0), expired_before_(std::numeric_limits<int64_t>::min()), next_id_(1) {}
+
+bool SchedulerWaitlist::add(const WaitlistEntry &entry)
+{
+    if (!entries_.emplace(entry.waitlist_id, entry).second)
+        return false;
+    live_copies_ += copiesOf(entry);
+    setNextId(entry.waitlist_id + 1);
+    push(entry);
+    return true;
+}
+
+void SchedulerWaitlist::push(const WaitlistEntry &entry)
+{
+    HeapEntry heap_entry{entry.priority, entry.requested_at, entry.waitlist_id};
+    for (int64_t day = std::max(entry.first_day, expired_before_); day <= entry.last_day; ++day)
+    {
+        std::vector<HeapEntry> &heap = heaps_by_day_[day];
+        heap.push_back(heap_entry);
+        std::push_heap(heap.begin(), heap.end(), HeapEntryLess());
+        ++heap_copies_;
+    }
+}
+
+bool SchedulerWaitlist::remove(int waitlist_id, WaitlistEntry *removed)
+{
+    auto it = entries_.find(waitlist_id);
+    if (it == entries_.end())
+        return false;
+    live_copies_ -= copiesOf(it->second);
+    if (removed)
+        *removed = std::move(it->second);
+    entries_.erase(it);
+    // The heap copies stay behind; best() and compaction discard them
+    compactIfStale();
+    return true;
+}
+
+const WaitlistEntry *SchedulerWaitlist::find(int waitlist_id) const
+{
+    auto it = entries_.find(waitlist_id);
+    return it == entries_.end() ? nullptr : &it->second;
+}
+
+const WaitlistEntry *SchedulerWaitlist::best(int64_t day)
+{
+    auto day_it = heaps_by_day_.find(day);
+    if (day_it == heaps_by_day_.end())
+        return nullptr;
+
+    std::vector<HeapEntry> &heap = day_it->second;
+    while (!heap.empty())
+    {
+        auto entry_it = entries_.find(heap.front().waitlist_id);
+        if (entry_it != entries_.end())
+            return &entry_it->second;
+        std::pop_heap(heap.begin(), heap.end(), HeapEntryLess());
+        heap.pop_back();
+        --heap_copies_;
+    }
+    heaps_by_day_.erase(day_it);
+    return nullptr;
+}
+
+size_t SchedulerWaitlist::expireBefore(int64_t day, size_t budget, std::vector<WaitlistEntry> *expired)
+{
+    size_t spent = 0;
+    while (spent < budget && !heaps_by_day_.empty() && heaps_by_day_.begin()->first < day)
+    {
+        auto day_it = heaps_by_day_.begin();
+        // Live entries sit in every remaining date of their range, so one that ends before day
+        // is met first here, on its earliest remaining date
+        for (const HeapEntry &heap_entry : day_it->second)
+        {
+            auto entry_it = entries_.find(heap_entry.waitlist_id);
+            if (entry_it == entries_.end())
+                continue;
+            if (entry_it->second.last_day < day)
+            {
+                live_copies_ -= copiesOf(entry_it->second);
+                expired->push_back(std::move(entry_it->second));
+                entries_.erase(entry_it);
+            }
+            else
+            {
+                --live_copies_; // the copy on this date goes with its heap
+            }
+        }
+        spent += day_it->second.size() + 1;
+        heap_copies_ -= day_it->second.size();
+        expired_before_ = day_it->first + 1;
+        heaps_by_day_.erase(day_it);
+    }
+    if (heaps_by_day_.empty() || heaps_by_day_.begin()->first >= day)
+        expired_before_ = std::max(expired_before_, day);
+    return spent;
+}
+
+size_t SchedulerWaitlist::copiesOf(const WaitlistEntry &entry) const
+{
+    int64_t first_day = std::max(entry.first_day, expired_before_);
+    return entry.last_day < first_day ? 0 : static_cast<size_t>(entry.last_day - first_day + 1);
+}
+
+std::vector<WaitlistEntry> SchedulerWaitlist::entries() const
+{
+    std::vector<WaitlistEntry> entries;
+    entries.reserve(entries_.size());
+    for (const auto &entry : entries_)
+        entries.push_back(entry.second);
+    std::sort(entries.begin(), entries.end(), [](const WaitlistEntry &a, const WaitlistEntry &b)
+              { return a.waitlist_id < b.waitlist_id; });
+    return entries;
+}
+
+void SchedulerWaitlist::setNextId(int next_id)
+{
+    next_id_ = std::max(next_id_, next_id);
+}
+
+void SchedulerWaitlist::compactIfStale()
+{
+    // Rebuilding costs the live copies, and only happens once at least as many stale ones piled up
+    if (heap_copies_ <= 2 * live_copies_ + 1024)
+        return;
+    heaps_by_day_.clear();
+    heap_copies_ = 0;
+    for (const auto &entry : entries_)
+        push(entry.second);
+}
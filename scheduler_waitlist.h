@@ -0,0 +1,91 @@
+#ifndef SCHEDULER_WAITLIST_H
+#define SCHEDULER_WAITLIST_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @brief A patient waiting for a seat on any date in [first_day, last_day]
+ */
+struct WaitlistEntry
+{
+    int waitlist_id = 0;
+    std::string patient_name;
+    int patient_age = 0;
+    int priority = 0;         // higher is served first
+    int64_t requested_at = 0; // seconds since epoch; earlier is served first at equal priority
+    int64_t first_day = 0;    // day numbers, inclusive
+    int64_t last_day = 0;
+};
+
+/**
+ * @brief Waiting patients, indexed for matching against a released slot's date
+ *
+ * Every entry is pushed into a max-heap for each date it accepts, ordered by
+ * priority, then request time, then id. Removing an entry only drops it from
+ * the id map; its heap copies go stale and are discarded when they reach a
+ * heap top, so best() is O(log n) amortized however often entries come and
+ * go. When stale copies outnumber live ones the heaps are rebuilt from the
+ * live entries. Dates that have passed are dropped with expireBefore and
+ * never get heaps again.
+ */
+class SchedulerWaitlist
+{
+public:
+    static constexpr int64_t kMaxDays = 62; // longest accepted date range
+
+    SchedulerWaitlist();
+
+    // Takes entry.waitlist_id as given; false if that id is already waiting
+    bool add(const WaitlistEntry &entry);
+    bool remove(int waitlist_id, WaitlistEntry *removed = nullptr);
+    const WaitlistEntry *find(int waitlist_id) const;
+    // Best live entry accepting day, or nullptr; pops the stale heap tops it passes
+    const WaitlistEntry *best(int64_t day);
+    // Drops the heaps of dates before day, oldest first, and the entries whose whole range is
+    // before it, appending those to expired; stops once about budget heap copies are visited.
+    // Returns the units spent; expiredBefore() reaches day when nothing before it is left
+    size_t expireBefore(int64_t day, size_t budget, std::vector<WaitlistEntry> *expired);
+    int64_t expiredBefore() const { return expired_before_; }
+
+    size_t size() const { return entries_.size(); }
+    std::vector<WaitlistEntry> entries() const; // in id order
+    int nextId() const { return next_id_; }
+    void setNextId(int next_id);
+
+private:
+    struct HeapEntry
+    {
+        int priority;
+        int64_t requested_at;
+        int waitlist_id;
+    };
+
+    struct HeapEntryLess
+    {
+        bool operator()(const HeapEntry &a, const HeapEntry &b) const
+        {
+            if (a.priority != b.priority)
+                return a.priority < b.priority;
+            if (a.requested_at != b.requested_at)
+                return a.requested_at > b.requested_at;
+            return a.waitlist_id > b.waitlist_id;
+        }
+    };
+
+    void push(const WaitlistEntry &entry);
+    void compactIfStale();
+    size_t copiesOf(const WaitlistEntry &entry) const; // heap copies a live entry has
+
+    std::unordered_map<int, WaitlistEntry> entries_;
+    std::map<int64_t, std::vector<HeapEntry>> heaps_by_day_; // std::push_heap max-heaps
+    size_t heap_copies_;                                     // copies in all heaps, live or stale
+    size_t live_copies_;                                     // copiesOf summed over entries_
+    int64_t expired_before_;                                 // dates before this have no heaps
+    int next_id_;
+};
+
+#endif // SCHEDULER_WAITLIST_H
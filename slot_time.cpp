@@ -0,0 +1,90 @@
+#include "slot_time.h"
+#include <cstdio>
+
+// Civil calendar conversions after H. Hinnant's days_from_civil/civil_from_days
+int64_t daysFromCivil(int year, int month, int day)
+{
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t yoe = year - era * 400;
+    const int64_t doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+void civilFromDays(int64_t days, int *year, int *month, int *day)
+{
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const int64_t doe = days - era * 146097;
+    const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64_t mp = (5 * doy + 2) / 153;
+    const int d = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    const int m = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    *year = static_cast<int>(yoe + era * 400 + (m <= 2));
+    *month = m;
+    *day = d;
+}
+
+static bool parseDigits(const std::string &text, size_t pos, size_t count, int *value)
+{
+    int result = 0;
+    for (size_t i = pos; i < pos + count; ++i)
+    {
+        if (text[i] < '0' || text[i] > '9')
+            return false;
+        result = result * 10 + (text[i] - '0');
+    }
+    *value = result;
+    return true;
+}
+
+static int daysInMonth(int year, int month)
+{
+    static const int kDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+    return (month == 2 && leap) ? 29 : kDays[month - 1];
+}
+
+bool parseSlotDate(const std::string &text, int64_t *day)
+{
+    int year, month, dom;
+    if (text.size() != 10 || text[4] != '-' || text[7] != '-')
+        return false;
+    if (!parseDigits(text, 0, 4, &year) || !parseDigits(text, 5, 2, &month) || !parseDigits(text, 8, 2, &dom))
+        return false;
+    if (month < 1 || month > 12 || dom < 1 || dom > daysInMonth(year, month))
+        return false;
+    *day = daysFromCivil(year, month, dom);
+    return true;
+}
+
+bool parseSlotTime(const std::string &text, int *minute_of_day)
+{
+    int hour, minute;
+    if (text.size() != 5 || text[2] != ':')
+        return false;
+    if (!parseDigits(text, 0, 2, &hour) || !parseDigits(text, 3, 2, &minute))
+        return false;
+    if (hour > 23 || minute > 59)
+        return false;
+    *minute_of_day = hour * 60 + minute;
+    return true;
+}
+
+std::string formatSlotDate(int64_t day)
+{
+    int year, month, dom;
+    civilFromDays(day, &year, &month, &dom);
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", year, month, dom);
+    return buffer;
+}
+
+std::string formatSlotTime(int minute_of_day)
+{
+    char buffer[16];
+    std::snprintf(buffer, sizeof(buffer), "%02d:%02d", minute_of_day / 60, minute_of_day % 60);
+    return buffer;
+}
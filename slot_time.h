@@ -0,0 +1,44 @@
+#ifndef SLOT_TIME_H
+#define SLOT_TIME_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Helpers for packed slot start keys
+ *
+ * A start key is the number of minutes since 1970-01-01 00:00. Dates are
+ * bucketed by day number (days since the same epoch), so both orderings and
+ * per-date lookups are plain integer comparisons.
+ */
+const int64_t kMinutesPerDay = 24 * 60;
+
+inline int64_t makeStartKey(int64_t day, int minute_of_day) { return day * kMinutesPerDay + minute_of_day; }
+
+// Floor division so keys before the epoch still map to the right day
+inline int64_t dayOfKey(int64_t start_key)
+{
+    int64_t day = start_key / kMinutesPerDay;
+    return (start_key % kMinutesPerDay < 0) ? day - 1 : day;
+}
+
+inline int minuteOfKey(int64_t start_key) { return static_cast<int>(start_key - dayOfKey(start_key) * kMinutesPerDay); }
+
+// Days slots may be scheduled on: 1970-01-01 through 2199-12-31. Anything
+// outside is a typo and would only bloat the date-indexed structures
+const int64_t kFirstSlotDay = 0;
+const int64_t kLastSlotDay = 84005;
+
+inline bool isSlotDay(int64_t day) { return day >= kFirstSlotDay && day <= kLastSlotDay; }
+
+int64_t daysFromCivil(int year, int month, int day);
+void civilFromDays(int64_t days, int *year, int *month, int *day);
+
+// Strict "yyyy-MM-dd" / "hh:mm" parsers; return false on malformed or out-of-range input
+bool parseSlotDate(const std::string &text, int64_t *day);
+bool parseSlotTime(const std::string &text, int *minute_of_day);
+
+std::string formatSlotDate(int64_t day);
+std::string formatSlotTime(int minute_of_day);
+
+#endif // SLOT_TIME_H